@@ -28,7 +28,10 @@ static inline void dma_channel_set_irq3_enabled_compat(uint channel, bool enable
 }
 #endif
 
-#define ANALOG_RAW_BUFFER_COUNT 2
+// One buffer being filled by DMA, one completed and one held by the reader.
+// Only the DMA handler moves the write index and only the reader moves the
+// read index, so handing buffers over needs no locking.
+#define ANALOG_RAW_BUFFER_COUNT 3
 
 static int audio_dma_chan = -1;
 
@@ -38,6 +41,7 @@ static struct {
     uint16_t* raw_buffer[ANALOG_RAW_BUFFER_COUNT];
     volatile int raw_buffer_write_index;
     volatile int raw_buffer_read_index;
+    volatile uint32_t overruns;
     uint buffer_size;
     int16_t bias;
     int dma_irq;
@@ -204,8 +208,15 @@ static void __no_inline_not_in_flash_func(analog_dma_handler)(void)
 #endif
     }
 
-    // get the next capture index to send the dma to start
-    analog_mic.raw_buffer_write_index = (analog_mic.raw_buffer_write_index + 1) % ANALOG_RAW_BUFFER_COUNT;
+    // get the next capture index to send the dma to start. If the reader is
+    // still behind, refill the same buffer and drop the newest samples rather
+    // than overwrite a buffer the reader may be holding.
+    int next_write_index = (analog_mic.raw_buffer_write_index + 1) % ANALOG_RAW_BUFFER_COUNT;
+    if (next_write_index != analog_mic.raw_buffer_read_index) {
+        analog_mic.raw_buffer_write_index = next_write_index;
+    } else {
+        analog_mic.overruns++;
+    }
 
     // give the channel a new buffer to write to and re-trigger it
     dma_channel_transfer_to_buffer_now(
@@ -223,29 +234,46 @@ void analog_microphone_set_samples_ready_handler(analog_samples_ready_handler_t
     analog_mic.samples_ready_handler = handler;
 }
 
+void analog_microphone_set_sample_rate(uint sample_rate) {
+    analog_mic.config.sample_rate = sample_rate;
+    adc_set_clkdiv((clock_get_hz(clk_adc) / (1.0 * sample_rate)) - 1);
+}
+
+int analog_microphone_acquire(const uint16_t** buffer) {
+    // Use local copy to avoid race with ISR
+    int current_read_index = analog_mic.raw_buffer_read_index;
+
+    if (analog_mic.raw_buffer_write_index == current_read_index) {
+        return -1;
+    }
+
+    *buffer = analog_mic.raw_buffer[current_read_index];
+
+    return current_read_index;
+}
+
+void analog_microphone_release(int index) {
+    // Buffers are released in the order they were acquired
+    analog_mic.raw_buffer_read_index = (index + 1) % ANALOG_RAW_BUFFER_COUNT;
+}
+
+uint32_t analog_microphone_get_overruns(void) {
+    return analog_mic.overruns;
+}
+
 int analog_microphone_read(int16_t* buffer, size_t samples) {
     if (samples > analog_mic.config.sample_buffer_size) {
         samples = analog_mic.config.sample_buffer_size;
     }
 
-    // Use local copy to avoid race with ISR
-    int current_read_index = analog_mic.raw_buffer_read_index;
-    int current_write_index = analog_mic.raw_buffer_write_index;
-    
-    if (current_write_index == current_read_index) {
+    const uint16_t* in = NULL;
+    int index = analog_microphone_acquire(&in);
+    if (index < 0) {
         return 0;
     }
 
-    uint16_t* in = analog_mic.raw_buffer[current_read_index];
-    int16_t* out = buffer;
-
-    // Wrap the read index properly
-    analog_mic.raw_buffer_read_index = (current_read_index + 1) % ANALOG_RAW_BUFFER_COUNT;
-
-    // for (int i = 0; i < samples; i++) {
-    //     *out++ = *in++;
-    // }
-    memcpy(out, in, samples * sizeof(uint16_t));
+    memcpy(buffer, in, samples * sizeof(uint16_t));
+    analog_microphone_release(index);
 
     return samples;
 }
\ No newline at end of file
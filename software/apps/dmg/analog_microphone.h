@@ -26,6 +26,17 @@ void analog_microphone_stop();
 
 void analog_microphone_set_samples_ready_handler(analog_samples_ready_handler_t handler);
 
+// Retime the ADC; safe while capture is running, takes effect from the next conversion
+void analog_microphone_set_sample_rate(uint sample_rate);
+
+// Zero-copy access to the DMA buffers. acquire returns the index of the oldest
+// completed buffer (or -1 if none) and points *buffer at its raw 12-bit ADC
+// samples; the buffer stays valid until it is passed back to release.
+int analog_microphone_acquire(const uint16_t** buffer);
+void analog_microphone_release(int index);
+uint32_t analog_microphone_get_overruns(void);
+
+// Copying read, kept for callers that want their own buffer
 int analog_microphone_read(int16_t* buffer, size_t samples);
 
 #endif
\ No newline at end of file
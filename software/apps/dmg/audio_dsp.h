@@ -0,0 +1,158 @@
+#ifndef AUDIO_DSP_H
+#define AUDIO_DSP_H
+
+// Per-sample microphone DSP used by emusound.c: the CIC decimator behind the
+// oversampled ADC, then DC removal, gain and low-pass. Integer only and free
+// of SDK includes so the host tests in software/tests can run the exact same
+// code. The decimator needs ADC_OVERSAMPLE (see emusound.h) defined first.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// RP2040 has no FPU, so the per-sample path is all integer; the float
+// conversions below run once, when a setting changes.
+#define GAIN_Q              12       // gain multiplier, Q12 (16.0 => 65536)
+#define LP_ALPHA_Q          15       // low-pass coefficient, Q15 (1.0 => 32768)
+#define LP_STATE_Q          8        // low-pass memory keeps 8 fractional bits
+#define DC_STATE_Q          14       // DC estimate keeps 14 fractional bits
+#define DC_SHIFT            10       // DC tracker time constant: 1024 samples (~5 Hz @ 32 kHz)
+
+static inline int32_t clamp_s16(int32_t v)
+{
+    if (v > INT16_MAX) return INT16_MAX;
+    if (v < INT16_MIN) return INT16_MIN;
+    return v;
+}
+
+// gain is 0.0 - 16.0
+static inline int32_t audio_dsp_gain_q12(float gain)
+{
+    return (int32_t)(gain * (float)(1 << GAIN_Q) + 0.5f);
+}
+
+// Single-pole LPF: alpha = dt / (RC + dt), RC = 1/(2*pi*fc). cutoff_hz <= 0
+// gives 1.0, which bypasses the filter.
+static inline int32_t audio_dsp_lowpass_alpha_q15(float cutoff_hz, uint32_t sample_rate)
+{
+    if (cutoff_hz <= 0.0f) {
+        return 1 << LP_ALPHA_Q;
+    }
+    const float dt = 1.0f / (float)sample_rate;
+    const float rc = 1.0f / (6.2831853f * cutoff_hz);
+    float alpha = dt / (rc + dt);
+    if (alpha < 0.0f) alpha = 0.0f;
+    if (alpha > 1.0f) alpha = 1.0f;
+    // Keep alpha below 1.0 in Q15 so the filter multiply cannot overflow
+    int32_t alpha_q15 = (int32_t)(alpha * (float)(1 << LP_ALPHA_Q) + 0.5f);
+    if (alpha_q15 >= (1 << LP_ALPHA_Q)) alpha_q15 = (1 << LP_ALPHA_Q) - 1;
+    return alpha_q15;
+}
+
+// (delta * alpha) >> 15 without a 64-bit multiply. delta is Q8 and spans
+// the full 17-bit sample difference, so split it into high and low parts.
+static inline int32_t lp_step(int32_t delta, int32_t alpha_q15)
+{
+    return ((delta >> 8) * alpha_q15 >> (LP_ALPHA_Q - 8)) + ((delta & 0xff) * alpha_q15 >> LP_ALPHA_Q);
+}
+
+// One sample through DC removal, gain and the optional low-pass. The caller
+// keeps the state in locals for a whole chunk so it stays in registers.
+static inline int32_t audio_dsp_sample(int32_t x, int32_t gain_q12, int32_t alpha_q15,
+                                       bool lowpass, int32_t *dc, int32_t *lp)
+{
+    // Track and remove the ADC mid-point error so gain does not amplify a DC
+    // offset. The update truncates, so the estimate needs enough fractional
+    // bits for that to stay well below 1 LSB; x << 14 still fits in int32.
+    *dc += ((x << DC_STATE_Q) - *dc) >> DC_SHIFT;
+    x = clamp_s16(x - ((*dc + (1 << (DC_STATE_Q - 1))) >> DC_STATE_Q));
+
+    // Apply software gain with saturation (|x| <= 2^15, gain <= 2^16 fits in
+    // int32, with room for the rounding term)
+    int32_t scaled = clamp_s16((x * gain_q12 + (1 << (GAIN_Q - 1))) >> GAIN_Q);
+
+    // Optional single-pole low-pass to reduce hiss; alpha==1.0 => bypass
+    if (!lowpass) {
+        return scaled;
+    }
+    *lp += lp_step((scaled << LP_STATE_Q) - *lp, alpha_q15);
+    return clamp_s16((*lp + (1 << (LP_STATE_Q - 1))) >> LP_STATE_Q);
+}
+
+#ifdef ADC_OVERSAMPLE
+// CIC decimator (3 stages, differential delay 1) from the oversampled ADC
+// rate down to the audio rate, followed by a 5-tap FIR at the audio rate that
+// flattens the CIC passband droop. Only wrap-around adds and subtracts in the
+// CIC, three multiplies per output sample in the FIR.
+#if ADC_OVERSAMPLE > 1
+// CIC gain is ADC_OVERSAMPLE^3. The FIR is a least-squares fit of 1 / CIC
+// response over 0 - 0.35 fs in Q14 with a DC gain of exactly 1; passband
+// ripple is within 0.3 dB.
+#define CIC_FIR_Q           14
+#if ADC_OVERSAMPLE == 2
+#define CIC_SHIFT           3
+static const int32_t cic_fir[3] = { 22094, -3512, 657 };
+#elif ADC_OVERSAMPLE == 4
+#define CIC_SHIFT           6
+static const int32_t cic_fir[3] = { 23856, -4652, 916 };
+#elif ADC_OVERSAMPLE == 8
+#define CIC_SHIFT           9
+static const int32_t cic_fir[3] = { 24320, -4956, 988 };
+#else
+#error "ADC_OVERSAMPLE must be 1, 2, 4 or 8"
+#endif
+#endif
+
+typedef struct {
+    uint32_t integrator[3];
+    uint32_t comb[3];
+    int32_t fir_history[4];
+} audio_cic_t;
+
+// count output samples from count * ADC_OVERSAMPLE 12-bit conversions
+static inline void audio_cic_decimate(audio_cic_t *cic, const uint16_t *raw, int16_t *out, int count)
+{
+#if ADC_OVERSAMPLE == 1
+    (void)cic;
+    for (int c = 0; c < count; c++)
+    {
+        out[c] = (int16_t)(((int32_t)raw[c] << 4) - 32768);
+    }
+#else
+    // The integrators wrap freely; the combs undo it since the true output,
+    // at most 4095 * ADC_OVERSAMPLE^3, fits in 32 bits
+    uint32_t i0 = cic->integrator[0], i1 = cic->integrator[1], i2 = cic->integrator[2];
+    uint32_t d0 = cic->comb[0], d1 = cic->comb[1], d2 = cic->comb[2];
+    int32_t z1 = cic->fir_history[0], z2 = cic->fir_history[1];
+    int32_t z3 = cic->fir_history[2], z4 = cic->fir_history[3];
+    const int32_t k0 = cic_fir[0], k1 = cic_fir[1], k2 = cic_fir[2];
+
+    for (int c = 0; c < count; c++)
+    {
+        for (int k = 0; k < ADC_OVERSAMPLE; k++)
+        {
+            i0 += *raw++;
+            i1 += i0;
+            i2 += i1;
+        }
+        uint32_t c0 = i2 - d0; d0 = i2;
+        uint32_t c1 = c0 - d1; d1 = c0;
+        uint32_t c2 = c1 - d2; d2 = c1;
+
+        // Scale back to 16 bits, keeping the resolution gained by averaging
+        const int32_t x = (int32_t)((c2 << 4) >> CIC_SHIFT) - 32768;
+
+        // Symmetric droop compensation, two samples of group delay
+        const int32_t y = (k0 * z2 + k1 * (z1 + z3) + k2 * (x + z4)) >> CIC_FIR_Q;
+        z4 = z3; z3 = z2; z2 = z1; z1 = x;
+        out[c] = (int16_t)clamp_s16(y);
+    }
+
+    cic->integrator[0] = i0; cic->integrator[1] = i1; cic->integrator[2] = i2;
+    cic->comb[0] = d0; cic->comb[1] = d1; cic->comb[2] = d2;
+    cic->fir_history[0] = z1; cic->fir_history[1] = z2;
+    cic->fir_history[2] = z3; cic->fir_history[3] = z4;
+#endif
+}
+#endif
+
+#endif
@@ -1,4 +1,5 @@
 #include "colors.h"
+#include "dmg_tables.h"
 
 #define PIXEL_RSHIFT 5
 #define PIXEL_GSHIFT 2
@@ -8,6 +9,8 @@
 static bool rgb_bits_reversed = false;
 
 // Store color schemes in flash to save RAM (608 bytes!)
+// gen_tables.py reads this table at build time to pre-encode the schemes;
+// keep one "[SCHEME_X] = { c1, c2, c3, c4 }" entry per line
 static const color_scheme_t color_schemes[NUMBER_OF_SCHEMES] = 
 {
     [SCHEME_BLACK_AND_WHITE] =  { 0xF7F3F7, 0x4E4C4E, 0xB5B2B5, 0x000000 },
@@ -107,6 +110,11 @@ const color_scheme_t* get_scheme(void)
     return &color_schemes[color_scheme_index];
 }
 
+const scheme_tmds_t* get_scheme_tmds(void)
+{
+    return &scheme_tmds_palettes[color_scheme_index];
+}
+
 int get_scheme_index(void)
 {
     return color_scheme_index;
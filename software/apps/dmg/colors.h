@@ -58,6 +58,28 @@ typedef struct color_scheme_t
     uint32_t c4;
 } color_scheme_t;
 
+// A colour scheme as pixel-doubled TMDS symbol pairs, ready for the encoder
+typedef struct scheme_tmds_t
+{
+    uint32_t red[4];
+    uint32_t green[4];
+    uint32_t blue[4];
+    // Words whose two pixels differ, for fractional scaling: [(left << 2) | right].
+    // Each is DC balanced, so colours may be off by up to one 6-bit level.
+    uint32_t red_split[16];
+    uint32_t green_split[16];
+    uint32_t blue_split[16];
+    // LCD grid: each colour with the grid colour as its right-hand pixel, and
+    // the grid colour on its own for the gap lines. The grid colour is the
+    // background (colour 0) a quarter of the way to colour 3.
+    uint32_t red_gap[4];
+    uint32_t green_gap[4];
+    uint32_t blue_gap[4];
+    uint32_t red_grid;
+    uint32_t green_grid;
+    uint32_t blue_grid;
+} scheme_tmds_t;
+
 typedef enum
 {
     COLOR_BLACK = 0,
@@ -79,6 +101,7 @@ void set_border_color_index(int index);
 void increase_border_color_index(int direction);
 void increase_color_scheme_index(int direction);
 const color_scheme_t* get_scheme(void);  // Returns const pointer to flash data
+const scheme_tmds_t* get_scheme_tmds(void);  // Same scheme, pre-encoded (flash)
 int get_scheme_index(void);
 void set_scheme_index(int index);
 uint16_t rgb888_to_rgb222(uint32_t color);
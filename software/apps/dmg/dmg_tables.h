@@ -0,0 +1,21 @@
+#ifndef DMG_TABLES_H
+#define DMG_TABLES_H
+
+#include "colors.h"
+
+// Constant tables generated at build time by gen_tables.py (see CMakeLists.txt)
+
+// Every colour scheme pre-encoded as TMDS symbol pairs, one word per 2bpp
+// pixel value and lane
+extern const scheme_tmds_t scheme_tmds_palettes[NUMBER_OF_SCHEMES];
+
+// Frame blending: what to keep of each packed 2bpp byte for the next frame's
+// ghost. Non-white pixels become grey (2), white stays white (0).
+extern const uint8_t frame_blend_store_lut[256];
+
+// Scale2x (EPX) output pixel pair for the top [0] or bottom [1] half of a
+// pixel, by neighbourhood key: left, centre and right pixels in bits 9-4,
+// above in 3-2 and below in 1-0. The left output pixel is in bits 3-2.
+extern const uint8_t scale2x_lut[2][1024];
+
+#endif // DMG_TABLES_H
@@ -33,17 +33,51 @@
 
 #define FLAG_VALID_EEPROM           (0xA5)
 
-// Reserve the last flash sector for settings. 
+// Settings are kept as a journal of records in the last JOURNAL_SECTORS
+// flash sectors. Each commit appends a full snapshot to the next blank slot,
+// so a save is a single short page program. A sector is only erased when the
+// journal wraps around into it, once every RECORDS_PER_SECTOR saves, and
+// the erases rotate over all the sectors.
+//
+// Power loss is safe at any point: a record only counts once its CRC matches,
+// the newest valid record wins, and the sector being erased never holds the
+// newest record.
+//
 // PICO_FLASH_SIZE_BYTES should be set in CMakeLists.txt (0x200000 for 2MB)
 // otherwise it may default to 0x400000 (4MB) using the default linker script.
-#define FLASH_OFFSET_SECTOR  (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
-#define FLASH_OFFSET_PAGE    (FLASH_OFFSET_SECTOR + FLASH_SECTOR_SIZE - FLASH_PAGE_SIZE) // last page in that sector
-const uint8_t *flash_target_contents = (const uint8_t *)(XIP_BASE + FLASH_OFFSET_PAGE);
+#define JOURNAL_SECTORS      4
+#define JOURNAL_OFFSET       (PICO_FLASH_SIZE_BYTES - JOURNAL_SECTORS * FLASH_SECTOR_SIZE)
+#define RECORD_SIZE          64
+#define RECORDS_PER_SECTOR   (FLASH_SECTOR_SIZE / RECORD_SIZE)
+#define RECORD_COUNT         (JOURNAL_SECTORS * RECORDS_PER_SECTOR)
+#define RECORD_MAGIC         0x4A53  // "SJ"
+
+// The original single-page store, in the last page of the last sector. Read
+// once to migrate old settings; the journal reclaims it when it wraps.
+#define LEGACY_OFFSET_PAGE   (PICO_FLASH_SIZE_BYTES - FLASH_PAGE_SIZE)
+
+typedef struct
+{
+    uint16_t magic;
+    uint16_t length;             // EEPROM_SIZE when written
+    uint32_t seq;                // increments with every commit
+    uint8_t data[EEPROM_SIZE];
+    uint32_t crc;                // CRC-32 of everything above
+} journal_record_t;
+
+static_assert(sizeof(journal_record_t) == RECORD_SIZE, "journal record must fill its slot exactly");
+static_assert(FLASH_PAGE_SIZE % RECORD_SIZE == 0, "records must not straddle a flash page");
 
-static uint8_t _data[FLASH_PAGE_SIZE] = {0};
+static const uint8_t *const flash_journal = (const uint8_t *)(XIP_BASE + JOURNAL_OFFSET);
+static const uint8_t *const flash_legacy = (const uint8_t *)(XIP_BASE + LEGACY_OFFSET_PAGE);
+
+static uint8_t _data[EEPROM_SIZE] = {0};
+static uint32_t _seq = 0;            // sequence number of the newest record
+static uint32_t _next_slot = 0;      // where the next record goes
 
 static bool _dirty = false;
 static bool init = false;
+static eeprom_flash_hook_t _flash_hook = NULL;
 
 // **************************************************************
 // PRIVATE FUNCTION PROTOTYPES
@@ -55,39 +89,137 @@ static void print_buf(const uint8_t *buf, size_t len);
 // **************************************************************
 // PRIVATE FUNCTIONS
 // **************************************************************
+// Nibble-table CRC-32 (IEEE); settings records are small and rare
+static uint32_t _crc32(const uint8_t *buf, size_t len)
+{
+    static const uint32_t table[16] = {
+        0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+        0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c,
+    };
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < len; i++)
+    {
+        crc = table[(crc ^ buf[i]) & 0x0f] ^ (crc >> 4);
+        crc = table[(crc ^ (buf[i] >> 4)) & 0x0f] ^ (crc >> 4);
+    }
+    return ~crc;
+}
+
+static const journal_record_t *_slot(uint32_t slot)
+{
+    return (const journal_record_t *)(flash_journal + slot * RECORD_SIZE);
+}
+
+static bool _record_is_valid(const journal_record_t *record)
+{
+    return record->magic == RECORD_MAGIC
+        && record->length == EEPROM_SIZE
+        && record->crc == _crc32((const uint8_t *)record, offsetof(journal_record_t, crc));
+}
+
+static bool _is_blank(const uint8_t *p, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        if (p[i] != 0xff)
+            return false;
+    }
+    return true;
+}
+
 static void _load(void)
 {
     init = true;
 
-    uint32_t i;
-
-    if (flash_target_contents[FLASH_PAGE_SIZE-1] != FLAG_VALID_EEPROM)
+    bool found = false;
+    for (uint32_t i = 0; i < RECORD_COUNT; i++)
     {
-        // If uninitialized, seed the in-RAM buffer but defer flash writes until first commit.
-        for (i = 0; i < FLASH_PAGE_SIZE; i++)
+        const journal_record_t *record = _slot(i);
+        if (_record_is_valid(record) && (!found || (int32_t)(record->seq - _seq) > 0))
         {
-            _data[i] = 0;
+            found = true;
+            _seq = record->seq;
+            _next_slot = (i + 1) % RECORD_COUNT;
         }
-        _data[FLASH_PAGE_SIZE-1] = FLAG_VALID_EEPROM;
+    }
+
+    if (found)
+    {
+        memcpy(_data, _slot((_next_slot + RECORD_COUNT - 1) % RECORD_COUNT)->data, EEPROM_SIZE);
         _dirty = false;
         return;
     }
 
-    for (i = 0; i < FLASH_PAGE_SIZE; i++)
+    // No journal yet. Carry over settings from the old single-page store, if
+    // there are any; they are written to the journal by the next commit.
+    _seq = 0;
+    _next_slot = 0;
+    if (flash_legacy[FLASH_PAGE_SIZE-1] == FLAG_VALID_EEPROM)
     {
-       _data[i] = flash_target_contents[i];
+        memcpy(_data, flash_legacy, EEPROM_SIZE);
+        _dirty = true;
+    }
+    else
+    {
+        memset(_data, 0, EEPROM_SIZE);
+        _dirty = false;
     }
-    
 }
 
-static void __no_inline_not_in_flash_func(_clear_flash)()
+// Runs from RAM: flash is not readable until it returns. In an XIP build
+// this core's interrupt handlers may be in flash, so they are held off. A
+// PICO_COPY_TO_RAM build runs them from RAM and leaves them on, so a sector
+// erase doesn't hold up VSYNC handling for tens of ms.
+static void __no_inline_not_in_flash_func(_flash_erase)(uint32_t offset)
 {
-    uint32_t i;
-    for (i = 0; i < FLASH_PAGE_SIZE; i++)
-    {
-        _data[i] = 0;
-    }
-    _data[FLASH_PAGE_SIZE-1] = FLAG_VALID_EEPROM;
+#if !PICO_COPY_TO_RAM
+    uint32_t ints = save_and_disable_interrupts();
+#endif
+    flash_range_erase(offset, FLASH_SECTOR_SIZE);
+#if !PICO_COPY_TO_RAM
+    restore_interrupts(ints);
+#endif
+}
+
+static void __no_inline_not_in_flash_func(_flash_program)(uint32_t offset, const uint8_t *page)
+{
+#if !PICO_COPY_TO_RAM
+    uint32_t ints = save_and_disable_interrupts();
+#endif
+    flash_range_program(offset, page, FLASH_PAGE_SIZE);
+#if !PICO_COPY_TO_RAM
+    restore_interrupts(ints);
+#endif
+}
+
+static void _erase_sector(uint32_t sector)
+{
+    if (_flash_hook)
+        _flash_hook(true, true);
+    _flash_erase(JOURNAL_OFFSET + sector * FLASH_SECTOR_SIZE);
+    if (_flash_hook)
+        _flash_hook(false, true);
+}
+
+static void _program_slot(uint32_t slot, const journal_record_t *record)
+{
+    // Erased flash reads 0xFF and programming 0xFF leaves a byte alone, so
+    // the rest of the page, written or not, is untouched
+    static uint8_t page[FLASH_PAGE_SIZE];
+    const uint32_t offset = slot * RECORD_SIZE;
+    memset(page, 0xff, sizeof(page));
+    memcpy(&page[offset % FLASH_PAGE_SIZE], record, RECORD_SIZE);
+
+    if (_flash_hook)
+        _flash_hook(true, false);
+    _flash_program(JOURNAL_OFFSET + offset - (offset % FLASH_PAGE_SIZE), page);
+    if (_flash_hook)
+        _flash_hook(false, false);
+}
+
+static void _clear_flash()
+{
+    memset(_data, 0, EEPROM_SIZE);
     _dirty = true;
     (void)EEPROM_commit();
 }
@@ -100,7 +232,7 @@ eeprom_result_t EEPROM_read(uint8_t address, uint8_t *value)
     if (!init)
         _load();
 
-    if (address >= FLASH_PAGE_SIZE) {
+    if (address >= EEPROM_SIZE) {
         return EEPROM_FAILURE;
     }
 
@@ -113,7 +245,7 @@ eeprom_result_t EEPROM_write(uint8_t address, uint8_t const value)
     if (!init)
         _load();
 
-    if (address >= FLASH_PAGE_SIZE)
+    if (address >= EEPROM_SIZE)
         return EEPROM_FAILURE;
 
     // Optimise _dirty. Only flagged if data written is different.
@@ -125,8 +257,7 @@ eeprom_result_t EEPROM_write(uint8_t address, uint8_t const value)
     return EEPROM_SUCCESS;
 }
 
-// Must run from RAM while flash is busy
-eeprom_result_t __no_inline_not_in_flash_func(EEPROM_commit)(void) 
+eeprom_result_t EEPROM_commit(void) 
 {
     if (!init)
         _load();
@@ -134,20 +265,48 @@ eeprom_result_t __no_inline_not_in_flash_func(EEPROM_commit)(void)
     if (!_dirty)
         return EEPROM_SUCCESS;
 
-    // Not really necessary in this implementation, but keeping around
-    if (!_data)
-        return EEPROM_FAILURE;
+    journal_record_t record;
+    record.magic = RECORD_MAGIC;
+    record.length = EEPROM_SIZE;
+    record.seq = _seq + 1;
+    memcpy(record.data, _data, EEPROM_SIZE);
+    record.crc = _crc32((const uint8_t *)&record, offsetof(journal_record_t, crc));
+
+    // Normally the first slot tried is blank and takes the record. Slots
+    // left half-written by a power cut, or holding the legacy page, are
+    // skipped; a slot that fails to verify is given up on as well.
+    for (uint32_t attempt = 0; attempt < RECORD_COUNT; attempt++)
+    {
+        const uint32_t slot = _next_slot;
+        _next_slot = (slot + 1) % RECORD_COUNT;
 
-    uint32_t ints = save_and_disable_interrupts();
-    flash_range_erase(FLASH_OFFSET_SECTOR, FLASH_SECTOR_SIZE);
-    flash_range_program(FLASH_OFFSET_PAGE, _data, FLASH_PAGE_SIZE);
-    restore_interrupts(ints);
+        // Entering a sector: wipe whatever older records it still holds. The
+        // newest record is in the previous sector, so nothing current is lost.
+        if (slot % RECORDS_PER_SECTOR == 0)
+        {
+            const uint32_t sector = slot / RECORDS_PER_SECTOR;
+            if (!_is_blank(flash_journal + sector * FLASH_SECTOR_SIZE, FLASH_SECTOR_SIZE))
+                _erase_sector(sector);
+        }
 
-    _dirty = false;
+        if (!_is_blank((const uint8_t *)_slot(slot), RECORD_SIZE))
+            continue;
 
-    // EEPROM_print_buffer();
+        _program_slot(slot, &record);
+        if (memcmp(_slot(slot), &record, RECORD_SIZE) == 0)
+        {
+            _seq = record.seq;
+            _dirty = false;
+            return EEPROM_SUCCESS;
+        }
+    }
 
-    return EEPROM_SUCCESS;
+    return EEPROM_FAILURE;
+}
+
+void EEPROM_set_flash_hook(eeprom_flash_hook_t hook)
+{
+    _flash_hook = hook;
 }
 
 static void print_buf(const uint8_t *buf, size_t len) 
@@ -163,10 +322,15 @@ static void print_buf(const uint8_t *buf, size_t len)
 
 void EEPROM_print_buffer(void)
 {
-    print_buf(flash_target_contents, FLASH_PAGE_SIZE);
+    if (!init)
+        _load();
+
+    printf("Settings record %u, next slot %u\n", (unsigned)_seq, (unsigned)_next_slot);
+    print_buf(_data, EEPROM_SIZE);
+    printf("\n");
 }
 
 void EEPROM_clear_all(void)
 {
     _clear_flash();
-}
\ No newline at end of file
+}
@@ -9,6 +9,8 @@
 #include <string.h>
 #include <stdbool.h>
 
+#define EEPROM_SIZE 52   // bytes of settings, addresses 0 to EEPROM_SIZE-1
+
 typedef enum
 {
     EEPROM_SUCCESS = 0,
@@ -21,4 +23,11 @@ eeprom_result_t EEPROM_commit(void);
 void EEPROM_print_buffer(void);
 void EEPROM_clear_all(void);
 
+// Called before (begin = true) and after each flash operation, which can
+// take the flash offline for ~1 ms to program a page or tens of ms to erase
+// a sector (erase = true). Lets the application keep other code off flash
+// for that long; with no hook the operation just runs.
+typedef void (*eeprom_flash_hook_t)(bool begin, bool erase);
+void EEPROM_set_flash_hook(eeprom_flash_hook_t hook);
+
 #endif // EEPROM_H
\ No newline at end of file
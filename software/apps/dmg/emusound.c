@@ -3,36 +3,37 @@
 #include <limits.h>
 #include "pico/stdlib.h"
 #include <stdio.h>
-#include "hardware/irq.h"
 #include "hardware/timer.h"
-// Map timer IRQ across RP2040/RP2350 naming
-#if defined(TIMER_IRQ_0)
-#define AUDIO_TIMER_IRQ TIMER_IRQ_0
-#elif defined(TIMER0_IRQ_0)
-#define AUDIO_TIMER_IRQ TIMER0_IRQ_0
-#else
-#define AUDIO_TIMER_IRQ -1
-#endif
 #include "hardware/clocks.h"
 #include "pico/sync.h"
 
 #include "audio_ring.h"
 #include "emusound.h"
+#include "analog_microphone.h"
+#include "audio_dsp.h"
 
 // Set to 1 to test with sine wave, 0 for real microphone input
 #define TEST_WITH_SINE_WAVE 0
 
-static bool __time_critical_func(audio_timer_callback)(__unused repeating_timer_t* rt);
-static void __time_critical_func(audio_service_tick)(void);
-
 semaphore_t timer_sem;
 
 
 static volatile bool first = true;   // True if the first buffer is playing
 static bool genSound = false;
 static float audio_gain = 1.0f;
-static float lp_alpha = 1.0f;        // 1.0f => no filtering
-static float lp_state = 0.0f;        // filter memory
+
+// Fixed-point DSP state, see audio_dsp.h
+static int32_t gain_q12 = 1 << GAIN_Q;
+static int32_t lp_alpha_q15 = 1 << LP_ALPHA_Q;  // 1.0 => no filtering
+static int32_t lp_state = 0;                    // filter memory, Q8
+static int32_t dc_state = 0;                    // ADC mid-point error, Q14
+static volatile uint32_t tick_time_max_us = 0;
+static uint32_t sample_rate = SAMPLE_FREQ;
+static float lp_cutoff_hz = 0.0f;
+
+// CIC decimator state, see audio_dsp.h
+static_assert(48000 * ADC_OVERSAMPLE <= 500000, "ADC tops out at 500 ksps");
+static audio_cic_t cic;
 
 static void beginAudio(void);
 
@@ -49,12 +50,37 @@ static void beginAudio(void);
 // #define TICKCOUNT       (ONEHUNDRDHZMS/TICKMS)  // number of ring buffer ticks per 100Hz tick
 #define TICK_SAMPLES    (NUMSAMPLES / TICKCOUNT)
 
-repeating_timer_t audio_timer;
+// Adaptive resampler. The output position advances by RESAMPLE_ONE plus a
+// small trim per output sample; the trim comes from a PI controller on the
+// HDMI ring fill. RESAMPLE_ONE is 2^20, so one step unit is ~1 ppm.
+#define RESAMPLE_FRAC_BITS      20
+#define RESAMPLE_ONE            (1u << RESAMPLE_FRAC_BITS)
+#define RESAMPLE_MAX_STEP_DELTA ((int32_t)(RESAMPLE_ONE / 200))  // +/-0.5%
+#define RESAMPLE_KP             8        // step units per sample of fill error
+#define RESAMPLE_KI_SHIFT       7        // integral gain 1/128 step unit per sample per tick
+#define RESAMPLE_HISTORY        3        // cubic needs one sample before and two after
+#define RESAMPLE_MAX_OUT        (TICK_SAMPLES + 2)  // outputs per chunk at the lowest step
+static int16_t resample_buf[RESAMPLE_HISTORY + TICK_SAMPLES];
+static uint32_t resample_pos = 0;               // Q20 position in resample_buf
+static int32_t fill_integral = 0;
+static volatile int32_t resample_step_delta = 0;
+static volatile uint32_t resample_overruns = 0;
+
+// Latency control. The ring fill just before a chunk is written is what every
+// sample of that chunk waits behind, so ADC-to-HDMI latency is that fill plus
+// the chunk itself plus the filter delays (CIC ~1, FIR 2, resampler 2 samples).
+#define AUDIO_FILTER_DELAY      5
+#define LATENCY_TRIM_THRESHOLD  TICK_SAMPLES     // beyond this, drop or repeat a chunk
+#define LATENCY_MIN_FILL        32               // keep the ring from running dry between chunks
+#define LATENCY_FILL_AVG_SHIFT  3                // average the measured fill over ~8 chunks
+static uint32_t latency_target_ms = AUDIO_LATENCY_DEFAULT_MS;
+static volatile int32_t ring_target_fill = AUDIO_LATENCY_DEFAULT_MS * SAMPLE_FREQ / 1000;
+static volatile uint32_t latency_fill_q4 = (AUDIO_LATENCY_DEFAULT_MS * SAMPLE_FREQ / 1000) << 4;
+static volatile uint32_t latency_trims = 0;
+
 audio_ring_t* ring;
-int16_t* samples;
 audio_sample_t* hdmi_buffer;
 int hdmi_buffer_size;
-static bool audio_manual_mode = false;  // When true, caller drives ticks instead of repeating timer
 
 #ifdef TIME_SPARE
 int32_t sound_count = 0;
@@ -65,27 +91,56 @@ int64_t int_count = 0;
 
 uint16_t emu_SoundSampleRate(void)
 {
-  return SAMPLE_FREQ;
+  return sample_rate;
 }
 
-void emu_sndInit(bool playSound, bool reset, audio_ring_t* audio_ring, int16_t* sample_buff)  // JOE ADDED audio_ring
+void emu_audio_set_sample_rate(uint32_t rate)
 {
-  genSound = playSound;
+  sample_rate = rate;
+  // The filter coefficient and the ring target depend on the sample period
+  emu_audio_set_lowpass(lp_cutoff_hz);
+  emu_audio_set_latency_target_ms(latency_target_ms);
+}
 
-  ring = audio_ring;
-  samples = sample_buff;
+void emu_audio_set_latency_target_ms(uint32_t ms)
+{
+  if (ms < 1) ms = 1;
+  if (ms > AUDIO_LATENCY_MAX_MS) ms = AUDIO_LATENCY_MAX_MS;
+  latency_target_ms = ms;
 
-  beginAudio();
+  int32_t fill = (int32_t)(ms * sample_rate / 1000);
+  if (fill < LATENCY_MIN_FILL) fill = LATENCY_MIN_FILL;
+  ring_target_fill = fill;
+}
+
+uint32_t emu_audio_get_latency_target_ms(void)
+{
+  return latency_target_ms;
+}
+
+uint32_t emu_audio_get_ring_target_fill(void)
+{
+  return ring_target_fill;
 }
 
-void emu_audio_set_manual_tick(bool manual_mode)
+uint32_t emu_audio_get_latency_us(void)
 {
-    audio_manual_mode = manual_mode;
+  const uint32_t samples = (latency_fill_q4 >> 4) + TICK_SAMPLES + AUDIO_FILTER_DELAY;
+  return (uint32_t)((uint64_t)samples * 1000000u / sample_rate);
 }
 
-void emu_audio_manual_tick(void)
+uint32_t emu_audio_get_latency_trim_count(void)
 {
-    audio_service_tick();
+  return latency_trims;
+}
+
+void emu_sndInit(bool playSound, bool reset, audio_ring_t* audio_ring)  // JOE ADDED audio_ring
+{
+  genSound = playSound;
+
+  ring = audio_ring;
+
+  beginAudio();
 }
 
 void emu_audio_set_gain(float gain)
@@ -98,6 +153,7 @@ void emu_audio_set_gain(float gain)
     gain = 16.0f;
   }
   audio_gain = gain;
+  gain_q12 = audio_dsp_gain_q12(gain);
 }
 
 float emu_audio_get_gain(void)
@@ -107,17 +163,25 @@ float emu_audio_get_gain(void)
 
 void emu_audio_set_lowpass(float cutoff_hz)
 {
-  if (cutoff_hz <= 0.0f) {
-    lp_alpha = 1.0f; // disable filtering
-    return;
-  }
-  // Single-pole LPF: alpha = dt / (RC + dt), RC = 1/(2*pi*fc)
-  const float dt = 1.0f / (float)SAMPLE_FREQ;
-  const float rc = 1.0f / (6.2831853f * cutoff_hz);
-  float alpha = dt / (rc + dt);
-  if (alpha < 0.0f) alpha = 0.0f;
-  if (alpha > 1.0f) alpha = 1.0f;
-  lp_alpha = alpha;
+  lp_cutoff_hz = cutoff_hz;
+  lp_alpha_q15 = audio_dsp_lowpass_alpha_q15(cutoff_hz, sample_rate);
+}
+
+int32_t emu_audio_get_resample_ppm(void)
+{
+  return (int32_t)(((int64_t)resample_step_delta * 1000000) >> RESAMPLE_FRAC_BITS);
+}
+
+uint32_t emu_audio_get_overrun_count(void)
+{
+  return resample_overruns;
+}
+
+uint32_t emu_audio_get_tick_time_max_us(void)
+{
+  uint32_t t = tick_time_max_us;
+  tick_time_max_us = 0;
+  return t;
 }
 
 const int16_t sine[32] = {
@@ -127,83 +191,169 @@ const int16_t sine[32] = {
     0x0,0x276,0x9be,0x1592,0x257d,0x38e3,0x4f04,0x6707
 };
 
-static bool __time_critical_func(audio_timer_callback)(__unused repeating_timer_t* rt)
+// Estimate how far the ring fill is from its target and adjust the
+// resampling step. The ring is sampled just before each chunk is written,
+// which is always the low point of the fill saw-tooth.
+static int32_t __time_critical_func(resample_update_step)(int32_t err)
 {
-  audio_service_tick();
-  return true;
+    fill_integral += err;
+    const int32_t integral_limit = RESAMPLE_MAX_STEP_DELTA << RESAMPLE_KI_SHIFT;
+    if (fill_integral > integral_limit) fill_integral = integral_limit;
+    if (fill_integral < -integral_limit) fill_integral = -integral_limit;
+
+    int32_t delta = err * RESAMPLE_KP + (fill_integral >> RESAMPLE_KI_SHIFT);
+    if (delta > RESAMPLE_MAX_STEP_DELTA) delta = RESAMPLE_MAX_STEP_DELTA;
+    if (delta < -RESAMPLE_MAX_STEP_DELTA) delta = -RESAMPLE_MAX_STEP_DELTA;
+    resample_step_delta = delta;
+    return delta;
 }
 
-static void __time_critical_func(audio_service_tick)(void)
+// Catmull-Rom interpolation between x1 and x2, t in Q10
+static inline int32_t resample_cubic(int32_t x0, int32_t x1, int32_t x2, int32_t x3, int32_t t)
+{
+    const int32_t a = 3 * (x1 - x2) + x3 - x0;
+    const int32_t b = 2 * x0 - 5 * x1 + 4 * x2 - x3 + ((a * t) >> 10);
+    const int32_t c = x2 - x0 + ((b * t) >> 10);
+    return x1 + ((c * t) >> 11);
+}
+
+// Decimate one raw ADC buffer (ADC_RAW_CHUNK_SIZE conversions) into
+// TICK_SAMPLES signed 16-bit samples centred on the ADC mid-point.
+static void __time_critical_func(adc_decimate_chunk)(const uint16_t *raw, int16_t *out)
+{
+    audio_cic_decimate(&cic, raw, out, TICK_SAMPLES);
+}
+
+// Convert one ADC chunk straight from the DMA buffer into the HDMI ring.
+// Each chunk is ADC_RAW_CHUNK_SIZE conversions, decimated to TICK_SAMPLES.
+static void __time_critical_func(audio_process_chunk)(const uint16_t *raw)
 {
-    static uint32_t call_count = 0;
-    static uint32_t debug_counter = 0;
-    
-    // Process chunk of samples from ADC double-buffer
-    // ADC fills one buffer while we read from the other
-    // IMPORTANT: Always process exactly TICK_SAMPLES (128), never more!
-    // The ADC buffer is only TICK_SAMPLES, so we can't read beyond that.
-    
     int size = get_write_size(ring, true);
-    if (size >= TICK_SAMPLES)
+    if (size >= RESAMPLE_MAX_OUT)
     {
         int audio_offset = get_write_offset(ring);
         
-        // ALWAYS process exactly TICK_SAMPLES - no doubling!
-        // Our ADC buffer is only TICK_SAMPLES deep, reading more would be garbage data
-        size = TICK_SAMPLES;
-          // DEBUG: Print detailed audio info every 1000 callbacks
-        int32_t debug_capture_value = 0;
-        // if (++debug_counter % 1000 == 0) {
-        //     int32_t adc_0 = (int32_t)((uint16_t)samples[0]);
-        //     int32_t adc_32 = (int32_t)((uint16_t)samples[32]);
-        //     printf("Audio: ADC[0]=%d, ADC[32]=%d | ", adc_0, adc_32);
-        // }
-        
+        // Snapshot coefficients so a setter running on the other core
+        // cannot change them halfway through a chunk
+        const int32_t gain = gain_q12;
+        const int32_t alpha = lp_alpha_q15;
+        const bool lowpass = alpha < (1 << LP_ALPHA_Q);
+        int32_t dc = dc_state;
+        int32_t lp = lp_state;
+        int16_t *chunk = &resample_buf[RESAMPLE_HISTORY];
+
+        // Decimate in place; the loop below rewrites each sample after use
+        adc_decimate_chunk(raw, chunk);
+
         // Process chunk of samples (exactly TICK_SAMPLES)
-        for (int c = 0; c < size; c++)
+        for (int c = 0; c < TICK_SAMPLES; c++)
         {
 #if TEST_WITH_SINE_WAVE
             // Test with sine wave for debugging
-            int32_t capture_value = sine[c % 32];
+            int32_t filtered = sine[c % 32];
+            (void)raw;
 #else
-            // ADC is 12-bit (0-4095), convert to 16-bit signed (-32768 to 32767)
-            int32_t capture_value = ((int32_t)((uint16_t)samples[c]) << 4) - 32768;
-            // Apply software gain with saturation
-            int32_t scaled = (int32_t)(capture_value * audio_gain);
-            if (scaled > INT16_MAX) scaled = INT16_MAX;
-            if (scaled < INT16_MIN) scaled = INT16_MIN;
-
-            // Optional single-pole low-pass to reduce hiss; lp_alpha==1 => bypass
-            float filtered_f = (lp_state + lp_alpha * ((float)scaled - lp_state));
-            lp_state = filtered_f;
-            int32_t filtered = (int32_t)filtered_f;
-            if (filtered > INT16_MAX) filtered = INT16_MAX;
-            if (filtered < INT16_MIN) filtered = INT16_MIN;
-            
-            if (debug_counter % 1000 == 0 && c == 0) {
-              debug_capture_value = filtered;
-            }
+            // Decimated ADC sample, 16-bit signed (-32768 to 32767)
+            int32_t filtered = audio_dsp_sample(chunk[c], gain, alpha, lowpass, &dc, &lp);
 #endif
-            
-            hdmi_buffer[audio_offset].channels[0] = (int16_t)filtered;
-            hdmi_buffer[audio_offset].channels[1] = (int16_t)filtered;
-            audio_offset = (audio_offset + 1) & (hdmi_buffer_size-1);
-        }          
-        
-        // if (debug_counter % 1000 == 0) {
-        //     printf("HDMI[0]=%d (original formula, no extra gain)\n", (int16_t)debug_capture_value);
-        // }
+            chunk[c] = (int16_t)filtered;
+        }
+
+        dc_state = dc;
+        lp_state = lp;
+
+        const uint32_t fill = get_read_size(ring, true);
+        const int32_t err = (int32_t)fill - ring_target_fill;
+        latency_fill_q4 += (int32_t)((fill << 4) - latency_fill_q4) >> LATENCY_FILL_AVG_SHIFT;
+
+        if (err > LATENCY_TRIM_THRESHOLD)
+        {
+            // Far more queued than the target (it was just lowered): drop
+            // the chunk rather than wait seconds for the resampler
+            latency_trims++;
+            fill_integral = 0;
+        }
+        else
+        {
+            // Resample the chunk into the HDMI ring. The ADC and the HDMI sample
+            // pacing come from different clocks, so the step is trimmed to keep
+            // the ring fill centred on its target instead of slowly drifting
+            // into an underrun or overrun.
+            const uint32_t step = RESAMPLE_ONE + resample_update_step(err);
+            const uint32_t end = (uint32_t)TICK_SAMPLES << RESAMPLE_FRAC_BITS;
+            const int chunk_offset = audio_offset;
+            uint32_t pos = resample_pos;
+            while (pos < end)
+            {
+                const int16_t *x = &resample_buf[pos >> RESAMPLE_FRAC_BITS];
+                const int32_t t = (int32_t)((pos >> (RESAMPLE_FRAC_BITS - 10)) & 0x3ff);
+                const int16_t out = (int16_t)clamp_s16(resample_cubic(x[0], x[1], x[2], x[3], t));
+
+                hdmi_buffer[audio_offset].channels[0] = out;
+                hdmi_buffer[audio_offset].channels[1] = out;
+                audio_offset = (audio_offset + 1) & (hdmi_buffer_size-1);
+                pos += step;
+            }
+            resample_pos = pos - end;
+
+            if (err < -LATENCY_TRIM_THRESHOLD && size >= 2 * RESAMPLE_MAX_OUT)
+            {
+                // Far less queued than the target (it was just raised): play
+                // the chunk twice
+                const int count = (audio_offset - chunk_offset) & (hdmi_buffer_size-1);
+                for (int i = 0; i < count; i++)
+                {
+                    hdmi_buffer[audio_offset] = hdmi_buffer[(chunk_offset + i) & (hdmi_buffer_size-1)];
+                    audio_offset = (audio_offset + 1) & (hdmi_buffer_size-1);
+                }
+                latency_trims++;
+                fill_integral = 0;
+            }
+        }
+
+        // Carry the chunk tail over as history for the next interpolation
+        for (int i = 0; i < RESAMPLE_HISTORY; i++)
+        {
+            resample_buf[i] = chunk[TICK_SAMPLES - RESAMPLE_HISTORY + i];
+        }
+
         set_write_offset(ring, audio_offset);
     }
-    
-    // 50Hz semaphore for compatibility with existing code
-    if (++call_count >= TICKCOUNT)
+    else
     {
-        call_count = 0;
-        first = !first;
-        sem_release(&timer_sem);
+        resample_overruns++;
     }
+}
+
+// Runs from the ADC DMA completion callback (or the core 1 loop), so every
+// completed chunk is consumed exactly once, in capture order.
+void __time_critical_func(emu_audio_service)(void)
+{
+    static uint32_t call_count = 0;
+    const uint32_t tick_start_us = time_us_32();
 
+    // Process every chunk the ADC DMA has completed since the last call,
+    // reading the raw samples in place and handing the buffer back after
+    const uint16_t *raw;
+    int index;
+    while ((index = analog_microphone_acquire(&raw)) >= 0)
+    {
+        audio_process_chunk(raw);
+        analog_microphone_release(index);
+
+        // 50Hz semaphore for compatibility with existing code
+        if (++call_count >= TICKCOUNT)
+        {
+            call_count = 0;
+            first = !first;
+            sem_release(&timer_sem);
+        }
+    }
+
+    const uint32_t tick_us = time_us_32() - tick_start_us;
+    if (tick_us > tick_time_max_us) {
+        tick_time_max_us = tick_us;
+    }
 }
 
 static void beginAudio(void)
@@ -217,23 +367,6 @@ static void beginAudio(void)
     emu_silenceSound();    hdmi_buffer = ring->buffer;
     hdmi_buffer_size = ring->size;
 
-    // Use CPU timer for audio chunking
-    if (!audio_manual_mode) 
-    {
-        printf("Initializing CPU timer for audio chunking at %d ms intervals...\n", TICKMS);
-        add_repeating_timer_ms(-TICKMS, audio_timer_callback, NULL, &audio_timer);
-
-        // Lower timer IRQ priority so VSYNC GPIO (IO_IRQ_BANK0) wins
-        if (AUDIO_TIMER_IRQ >= 0) 
-        {
-          irq_set_priority(AUDIO_TIMER_IRQ, 0xC0);
-        }
-    } 
-    else 
-    {
-        printf("Audio manual-tick mode enabled; no repeating timer started\n");
-    }
-
     printf("sound initialized\n");
   }
   else
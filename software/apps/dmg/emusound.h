@@ -2,6 +2,7 @@
 #define EMUSOUND_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #define SAMPLE_FREQ         32000
 // Use power of 2 for efficient modulo operations
@@ -9,27 +10,54 @@
 #define NUMSAMPLES          (SAMPLE_FREQ / 50)   // 640 samples per frame at 50Hz @ 32000
 #define ZEROSOUND 0                     // Zero point for sound
 
-// Audio processing cadence in milliseconds (matches ADC chunk size)
-#define AUDIO_TICK_MS       4
-
 // ADC buffer size MUST match PIO chunk size for synchronization!
 // 128 samples @ 32000 Hz = 4ms (matches PIO callback interval)
 // Balanced to limit IRQ load while avoiding long-latency audio buzz
 #define ADC_CHUNK_SIZE      (128)       // Must match TICK_SAMPLES
+// The ADC runs ADC_OVERSAMPLE times faster than the audio rate and a CIC
+// decimator brings it back down, so each DMA buffer holds ADC_RAW_CHUNK_SIZE
+// conversions for ADC_CHUNK_SIZE output samples. 1, 2, 4 or 8; 1 disables it.
+#ifndef ADC_OVERSAMPLE
+#define ADC_OVERSAMPLE      4
+#endif
+#define ADC_RAW_CHUNK_SIZE  (ADC_CHUNK_SIZE * ADC_OVERSAMPLE)
 #define AUDIO_BUFFER_SIZE   (2048)      // HDMI ring buffer (separate from ADC)
+// Audio latency is set by how much the HDMI ring holds just before each new
+// chunk arrives. The resampler keeps it at the target, and whole chunks are
+// dropped or repeated when the target moves by more than a chunk.
+#define AUDIO_LATENCY_DEFAULT_MS  16    // 512 samples at 32 kHz, ~20 ms end to end
+#define AUDIO_LATENCY_MAX_MS      32    // still leaves room for a repeated chunk at 48 kHz
 
-void emu_sndInit(bool playSound, bool reset, audio_ring_t* audio_ring, int16_t* sample_buff);  // JOE ADDED audio_ring, sample buffer
+void emu_sndInit(bool playSound, bool reset, audio_ring_t* audio_ring);  // JOE ADDED audio_ring; samples come straight from the mic DMA buffers
 // void emu_generateSoundSamples(void);
 void emu_silenceSound(void);
 uint16_t emu_SoundSampleRate(void);
-// Enable manual ticking (skip repeating timer) when true; call emu_audio_manual_tick() periodically
-void emu_audio_set_manual_tick(bool manual_mode);
-void emu_audio_manual_tick(void);
+// Change the input/output sample rate (default SAMPLE_FREQ). Chunks stay
+// ADC_CHUNK_SIZE samples, so the chunk period follows the rate.
+void emu_audio_set_sample_rate(uint32_t rate);
+// Convert every ADC chunk completed since the last call into the HDMI ring.
+// Register it as the mic samples-ready handler, or call it from a polling loop.
+void emu_audio_service(void);
 // Apply software gain multiplier to captured audio (default 1.0f)
 void emu_audio_set_gain(float gain);
 float emu_audio_get_gain(void);
 // Enable single-pole low-pass filter; pass cutoff_hz<=0 to disable (no filtering)
 void emu_audio_set_lowpass(float cutoff_hz);
+// Worst audio tick processing time since the last call, in microseconds
+uint32_t emu_audio_get_tick_time_max_us(void);
+// Current resampling correction in ppm (positive => consuming input faster)
+int32_t emu_audio_get_resample_ppm(void);
+// Chunks dropped because the HDMI ring had no room
+uint32_t emu_audio_get_overrun_count(void);
+// Ring fill target in ms (1 to AUDIO_LATENCY_MAX_MS); takes effect within a few chunks
+void emu_audio_set_latency_target_ms(uint32_t ms);
+uint32_t emu_audio_get_latency_target_ms(void);
+// The target as a sample count at the current rate, e.g. for pre-filling the ring
+uint32_t emu_audio_get_ring_target_fill(void);
+// Measured ADC-to-HDMI latency in microseconds, excluding the sink's own delay
+uint32_t emu_audio_get_latency_us(void);
+// Chunks dropped or repeated to move the ring fill onto a new target
+uint32_t emu_audio_get_latency_trim_count(void);
 
 
 
@@ -55,6 +55,7 @@ const glyph_5x7_t font5x7_default[] = {
     GLYPH(']', 0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E),
     GLYPH('!', 0x04, 0x04, 0x04, 0x04, 0x00, 0x00, 0x04),
     GLYPH(':', 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00),
+    GLYPH('%', 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03),
     GLYPH('\'', 0x06, 0x06, 0x02, 0x00, 0x00, 0x00, 0x00)
 };
 
@@ -0,0 +1,242 @@
+#!/usr/bin/env python3
+
+# Build-time generator for the constant tables used by the DMG app, so that
+# nothing is computed at boot or per scanline:
+#
+# - scheme_tmds_palettes: every colour scheme in colors.c, pre-encoded as
+#   pixel-doubled TMDS symbol pairs for each of the red, green and blue lanes,
+#   plus split pairs (two different colours in one word) for fractional scaling
+#   and the LCD grid pairs and grid colour
+# - frame_blend_store_lut: what frame blending keeps of each packed 2bpp byte
+#   for the next frame's ghost
+# - scale2x_lut: the Scale2x (EPX) decision for every 2bpp neighbourhood. The
+#   table-driven row algorithm main.c uses is run here against a direct
+#   Scale2x / Scale4x (AdvMAME4x) reference on test images, so a table or
+#   indexing mistake fails the build
+#
+# The TMDS symbols come from the encoder model in libdvi/tmds_table_gen.py and
+# are checked against libdvi/tmds_table.h, which the scanline code also uses.
+#
+# Usage: gen_tables.py <colors.c> <tmds_table.h> <output.c>
+
+import os
+import random
+import re
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "libdvi"))
+from tmds_table_gen import TMDSEncode
+
+def pixel_doubled_table():
+	# Same construction as the pixel-doubled table in tmds_table_gen.py: the
+	# second symbol's LSB is flipped so the pair has zero net DC balance
+	enc = TMDSEncode()
+	table = []
+	for i in range(0, 256, 4):
+		sym0 = enc.encode(i, 0, 1)
+		sym1 = enc.encode(i ^ 1, 0, 1)
+		assert(enc.imbalance == 0)
+		table.append(sym0 | (sym1 << 10))
+	return table
+
+def split_word(left, right):
+	# One word showing two different colours. The pair must still end at zero
+	# balance, which exact levels rarely give, so search within one 6-bit level
+	# of each colour for the closest pair that does. Every pair of levels has
+	# one in that range.
+	base_l = left & 0xfc
+	base_r = right & 0xfc
+	candidates = []
+	for dl in range(-4, 8):
+		for dr in range(-4, 8):
+			l = base_l + dl
+			r = base_r + dr
+			if not (0 <= l <= 255 and 0 <= r <= 255):
+				continue
+			enc = TMDSEncode()
+			sym0 = enc.encode(l, 0, 1)
+			sym1 = enc.encode(r, 0, 1)
+			if enc.imbalance == 0:
+				candidates.append((abs(2 * dl - 3) + abs(2 * dr - 3), sym0 | (sym1 << 10)))
+	if not candidates:
+		sys.exit(f"no DC-balanced split pair for 0x{left:02x}, 0x{right:02x}")
+	return min(candidates)[1]
+
+def grid_level(colours, shift):
+	# Background shade darkened a quarter of the way towards colour 3
+	bg = colours[0] >> shift & 0xff
+	dark = colours[3] >> shift & 0xff
+	return (3 * bg + dark + 2) // 4
+
+def load_tmds_table_h(path):
+	return [int(x, 16) for x in re.findall(r"^(0x[0-9a-fA-F]+)u,", open(path).read(), re.MULTILINE)]
+
+def load_color_schemes(path):
+	src = open(path).read()
+	body = re.search(r"color_schemes\[NUMBER_OF_SCHEMES\]\s*=\s*\{(.*?)\n\};", src, re.DOTALL)
+	if not body:
+		sys.exit(f"{path}: color_schemes[] not found")
+	schemes = re.findall(r"\[(SCHEME_\w+)\]\s*=\s*\{\s*" + r",\s*".join([r"(0x[0-9a-fA-F]+)"] * 4) + r"\s*\}", body.group(1))
+	if not schemes:
+		sys.exit(f"{path}: no entries in color_schemes[]")
+	return [(name, [int(c, 16) for c in colours]) for name, *colours in schemes]
+
+def store_lut():
+	# Non-white pixels (1, 2, 3) become grey (2), white (0) stays white
+	lut = []
+	for byte in range(256):
+		result = 0
+		for pixel in range(4):
+			shift = (3 - pixel) * 2
+			if (byte >> shift) & 0x03:
+				result |= 2 << shift
+		lut.append(result)
+	return lut
+
+# Scale2x on one pixel with neighbours above, right, left and below: the
+# top-left, top-right, bottom-left and bottom-right output pixels
+def epx(p, a, b, c, d):
+	e0 = a if c == a and c != d and a != b else p
+	e1 = b if a == b and a != c and b != d else p
+	e2 = c if d == c and d != b and c != a else p
+	e3 = d if b == d and b != a and d != c else p
+	return e0, e1, e2, e3
+
+# Key layout matches main.c: the left, centre and right pixels are adjacent
+# in the packed line, so they come out of one shift
+#   bits 9-8 left, 7-6 centre, 5-4 right, 3-2 above, 1-0 below
+# Each entry is the output pixel pair for that half, left pixel in bits 3-2.
+def scale2x_lut():
+	lut = [[0] * 1024, [0] * 1024]
+	for key in range(1024):
+		c, p, b, a, d = (key >> 8) & 3, (key >> 6) & 3, (key >> 4) & 3, (key >> 2) & 3, key & 3
+		e0, e1, e2, e3 = epx(p, a, b, c, d)
+		lut[0][key] = (e0 << 2) | e1
+		lut[1][key] = (e2 << 2) | e3
+	return lut
+
+# Direct reference: Scale2x with edge pixels repeated outwards
+def scale2x_reference(img):
+	h, w = len(img), len(img[0])
+	out = [[0] * (2 * w) for _ in range(2 * h)]
+	for y in range(h):
+		for x in range(w):
+			p = img[y][x]
+			a = img[max(y - 1, 0)][x]
+			d = img[min(y + 1, h - 1)][x]
+			c = img[y][max(x - 1, 0)]
+			b = img[y][min(x + 1, w - 1)]
+			e0, e1, e2, e3 = epx(p, a, b, c, d)
+			out[2 * y][2 * x], out[2 * y][2 * x + 1] = e0, e1
+			out[2 * y + 1][2 * x], out[2 * y + 1][2 * x + 1] = e2, e3
+	return out
+
+def pack_row(pixels):
+	return [(pixels[i] << 6) | (pixels[i + 1] << 4) | (pixels[i + 2] << 2) | pixels[i + 3] for i in range(0, len(pixels), 4)]
+
+def unpack_row(packed):
+	return [(byte >> (6 - 2 * k)) & 3 for byte in packed for k in range(4)]
+
+# Model of scale2x_row() in main.c: packed rows in, output pixels out
+def scale2x_row_model(lut, above, cur, below, half):
+	out = []
+	n = len(cur)
+	for i in range(n):
+		prev = cur[i - 1] if i > 0 else cur[0] >> 6
+		nxt = cur[i + 1] if i + 1 < n else (cur[i] & 3) << 6
+		window = (prev << 16) | (cur[i] << 8) | nxt
+		for k in range(4):
+			key = (((window >> (12 - 2 * k)) & 0x3f) << 4) | (((above[i] >> (6 - 2 * k)) & 3) << 2) | ((below[i] >> (6 - 2 * k)) & 3)
+			pair = lut[half][key]
+			out += [pair >> 2, pair & 3]
+	return out
+
+def check_scalers(lut):
+	rng = random.Random(1989)
+	for trial in range(24):
+		w, h = 4 * rng.randint(1, 6), rng.randint(1, 7)
+		colours = rng.sample(range(4), rng.randint(1, 4))
+		img = [[rng.choice(colours) for _ in range(w)] for _ in range(h)]
+		packed = [pack_row(row) for row in img]
+		rows = lambda r: packed[min(max(r, 0), h - 1)]
+
+		# Scale2x: one output row per (line, half)
+		ref2 = scale2x_reference(img)
+		got2 = [scale2x_row_model(lut, rows(y - 1), rows(y), rows(y + 1), half) for y in range(h) for half in (0, 1)]
+		if got2 != ref2:
+			sys.exit(f"scale2x table mismatch on a {w}x{h} test image")
+
+		# Scale4x: Scale2x rows first, then Scale2x again on those with the
+		# 2x image's own edges repeated
+		ref4 = scale2x_reference(ref2)
+		rows2 = [pack_row(r) for r in got2]
+		rows2x = lambda r: rows2[min(max(r, 0), 2 * h - 1)]
+		got4 = [scale2x_row_model(lut, rows2x(r - 1), rows2x(r), rows2x(r + 1), half) for r in range(2 * h) for half in (0, 1)]
+		if got4 != ref4:
+			sys.exit(f"scale4x mismatch on a {w}x{h} test image")
+
+def words(values, fmt):
+	return ", ".join(fmt.format(v) for v in values)
+
+def main():
+	if len(sys.argv) != 4:
+		sys.exit(f"usage: {sys.argv[0]} <colors.c> <tmds_table.h> <output.c>")
+	colors_c, tmds_table_h, output = sys.argv[1:]
+
+	table = pixel_doubled_table()
+	if load_tmds_table_h(tmds_table_h) != table:
+		sys.exit(f"{tmds_table_h} does not match the encoder in tmds_table_gen.py")
+
+	def split_lane(left, right):
+		# Equal levels use the same word as an unsplit pixel, so runs of one
+		# colour across a split don't show a seam
+		return table[left >> 2] if left == right else split_word(left, right)
+
+	out = []
+	out.append("// Generated by gen_tables.py from colors.c at build time. Do not edit.")
+	out.append("")
+	out.append('#include "colors.h"')
+	out.append("")
+	out.append("// Indexed by scheme, then by 2bpp pixel value within each lane; the split")
+	out.append("// pairs by (left << 2) | right, then the grid pairs and grid colour")
+	out.append("const scheme_tmds_t scheme_tmds_palettes[NUMBER_OF_SCHEMES] = {")
+	for name, colours in load_color_schemes(colors_c):
+		lanes = []
+		for shift in (16, 8, 0):
+			lanes.append("{ " + words((table[(c >> shift & 0xff) >> 2] for c in colours), "0x{:05x}u") + " }")
+		for shift in (16, 8, 0):
+			lanes.append("{ " + words((split_lane(l >> shift & 0xff, r >> shift & 0xff) for l in colours for r in colours), "0x{:05x}u") + " }")
+		for shift in (16, 8, 0):
+			grid = grid_level(colours, shift)
+			lanes.append("{ " + words((split_lane(c >> shift & 0xff, grid) for c in colours), "0x{:05x}u") + " }")
+		for shift in (16, 8, 0):
+			lanes.append("0x{:05x}u".format(table[grid_level(colours, shift) >> 2]))
+		out.append(f"    [{name}] = {{")
+		for lane in lanes:
+			out.append(f"        {lane},")
+		out.append("    },")
+	out.append("};")
+	out.append("")
+	out.append("const uint8_t frame_blend_store_lut[256] = {")
+	lut = store_lut()
+	for i in range(0, 256, 16):
+		out.append("    " + words(lut[i:i + 16], "0x{:02x}") + ",")
+	out.append("};")
+
+	lut2x = scale2x_lut()
+	check_scalers(lut2x)
+	out.append("")
+	out.append("// Kept in RAM: looked up for every pixel of every smoothed scanline")
+	out.append('const uint8_t __not_in_flash("dmg_tables") scale2x_lut[2][1024] = {')
+	for half in lut2x:
+		out.append("    {")
+		for i in range(0, 1024, 32):
+			out.append("        " + words(half[i:i + 32], "{:d}") + ",")
+		out.append("    },")
+	out.append("};")
+
+	with open(output, "w") as f:
+		f.write("\n".join(out) + "\n")
+
+if __name__ == "__main__":
+	main()
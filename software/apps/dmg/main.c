@@ -55,6 +55,12 @@ make improved OSD
 #include "hardware/sync.h"
 #include "hardware/clocks.h"
 #include "hardware/regs/intctrl.h"
+#if PICO_RP2040
+#include "hardware/structs/ssi.h"
+#include "hardware/structs/bus_ctrl.h"
+#else
+#include "hardware/structs/qmi.h"
+#endif
 #include "pico/multicore.h"
 #include "pico/stdlib.h"
 #include "pico/stdio.h"
@@ -77,8 +83,10 @@ make improved OSD
 #include "analog_microphone.h"
 #include "emusound.h"
 #include "colors.h"
+#include "dmg_tables.h"
 #include "mario.h"
 #include "video_defs.h"
+#include "scale2x.h"
 #include "osd.h"
 
 #include "video_capture.pio.h"  // PIO-based video capture
@@ -89,13 +97,23 @@ make improved OSD
 #define ENABLE_AUDIO                1  // Set to 1 to enable audio, 0 to disable all audio code
 #define ENABLE_VIDEO_CAPTURE        1
 #define ENABLE_OSD                  1  // Set to 1 to enable OSD code, 0 to disable
-#define AUDIO_ON_CORE1              0  // Set to 1 to run audio processing on Core 1 (alongside DVI) to reduce contention with VSYNC GPIO handling on Core 0; set to 0 to run audio on Core 0 with timer IRQ (default)
+#define FAST_BOOT                   1  // Set to 1 to skip the serial console delays, banners and splash screen; set to 0 when debugging boot over UART
+#define ENABLE_EXPERIMENTAL_MODES   0  // Set to 1 to put the video modes marked experimental in the OSD's mode cycle
+#define AUDIO_IN_CORE1_LOOP         0  // Set to 1 to process audio in the Core 1 scanline loop; set to 0 to process it from the ADC DMA completion IRQ (low priority, also on Core 1) (default)
 #define BIT_IS_CLEAR(value, bit)    (((value) & (1U << (bit))) == 0)
 
 
-#if ENABLE_AUDIO
-static const int hdmi_n[6] = {4096, 6272, 6144, 3136, 4096, 6144};  // 32k, 44.1k, 48k, 22.05k, 16k, 24k
+// Sample rates selectable from the OSD; the ADC, the audio pipeline and the
+// HDMI audio packets all follow the selected rate
+static const uint16_t audio_rates[] = {32000, 44100, 48000};
+#define AUDIO_RATE_COUNT (sizeof(audio_rates) / sizeof(audio_rates[0]))
 static uint16_t rate = SAMPLE_FREQ;
+// Audio latency targets selectable from the OSD, in ms of HDMI ring fill
+static const uint8_t audio_latencies_ms[] = {2, 4, 8, 16, 32};
+#define AUDIO_LATENCY_COUNT (sizeof(audio_latencies_ms) / sizeof(audio_latencies_ms[0]))
+static uint8_t audio_latency_ms = AUDIO_LATENCY_DEFAULT_MS;
+
+#if ENABLE_AUDIO
 // #define AUDIO_BUFFER_SIZE   (0x1<<8) // Must be power of 2
 audio_sample_t audio_buffer[AUDIO_BUFFER_SIZE];
 
@@ -127,7 +145,27 @@ audio_sample_t audio_buffer[AUDIO_BUFFER_SIZE];
 #define I2C_ADDRESS                     0x52
 i2c_inst_t* i2cHandle = i2c1;
 
+#if FAST_BOOT
+#define SPLASH_DURATION_MS          0u
+#else
 #define SPLASH_DURATION_MS          3000u
+#endif
+
+// XIP flash clock ceiling. The stock 280 MHz mode runs the flash at clk_sys/2
+// = 140 MHz, so that is the limit faster modes are held to by raising the
+// divider
+#define FLASH_SCK_MAX_KHZ           140000u
+#ifdef PICO_FLASH_SPI_CLKDIV
+#define FLASH_BOOT_CLKDIV           PICO_FLASH_SPI_CLKDIV
+#else
+#define FLASH_BOOT_CLKDIV           2u
+#endif
+
+// Boot profiler: each boot_checkpoint() is timestamped and kept for a summary
+// line printed once the first Game Boy frame has been captured. The summary
+// also totals the waits FAST_BOOT removes, so one FAST_BOOT=0 boot gives the
+// time with and without them.
+#define BOOT_CHECKPOINT_MAX         16
 
 //********************************************************************************
 // TYPEDEFS AND STRUCTS
@@ -152,6 +190,11 @@ typedef enum
     // OSD_LINE_BORDER_COLOR,
     OSD_LINE_FRAME_BLENDING,
     OSD_LINE_AUDIO_GAIN,
+    OSD_LINE_AUDIO_RATE,
+    OSD_LINE_AUDIO_LATENCY,
+    OSD_LINE_VIDEO_MODE,
+    OSD_LINE_LCD_EFFECT,
+    OSD_LINE_PERF_HUD,
     OSD_LINE_RESET_DEVICE,
     OSD_LINE_SAVE_SETTINGS,
     OSD_LINE_EXIT,
@@ -168,9 +211,21 @@ typedef enum
 typedef enum
 {
     SAVE_INDEX_SCHEME = 0,
-    SAVE_INDEX_FRAME_BLENDING
+    SAVE_INDEX_FRAME_BLENDING,
+    SAVE_INDEX_AUDIO_RATE,
+    SAVE_INDEX_AUDIO_LATENCY,
+    SAVE_INDEX_VIDEO_MODE,
+    SAVE_INDEX_LCD_EFFECT
 } save_position_t;
 
+typedef enum
+{
+    LCD_EFFECT_OFF = 0,
+    LCD_EFFECT_GRID,        // gaps between pixels, pre-encoded (see update_lcd_grid())
+    LCD_EFFECT_SCANLINES,   // every odd output line blank (libdvi)
+    LCD_EFFECT_COUNT
+} lcd_effect_t;
+
 typedef enum
 {
     DISABLE_MASK_NONE = 0,
@@ -184,6 +239,21 @@ typedef enum
     RESTART_MASS_STORAGE,
 } restart_option_t;
 
+// Encodes one packed Game Boy line into TMDS symbols at a fixed horizontal scale
+typedef void (*scanline_encoder_t)(const uint8_t *packed_pixbuf, uint32_t *symbuf_r, uint32_t *symbuf_g, uint32_t *symbuf_b, size_t output_words, const scheme_tmds_t *palette_tmds);
+
+typedef struct video_mode_t
+{
+    const char *name;                   // OSD text, at most 10 chars
+    const struct dvi_timing *timing;    // bit_clk_khz is also the system clock
+    enum vreg_voltage vreg_voltage;
+    uint16_t scanline_count;            // scanline buffers per frame; DMG_PIXELS_Y fills the height
+    uint16_t game_width;                // output pixels across the Game Boy line, even and >= DMG_PIXELS_X
+    uint8_t smooth_shift;               // smoothing scalers: log2 of scanline buffers per Game Boy line, else 0
+    bool experimental;                  // core1 may not keep up: offered only with ENABLE_EXPERIMENTAL_MODES
+    scanline_encoder_t encoder;
+} video_mode_t;
+
 
 //********************************************************************************
 // PRIVATE VARIABLES
@@ -191,9 +261,12 @@ typedef enum
 // Packed DMA buffers - 4 pixels per byte (2 bits each)
 // This is the native format from the Game Boy (2 bits per pixel)
 // Used by BOTH 640x480 and 800x600 modes for DMA capture AND display
-static uint8_t packed_buffer_0[PACKED_FRAME_SIZE] = {0};
-static uint8_t packed_buffer_1[PACKED_FRAME_SIZE] = {0};
-static uint8_t packed_buffer_previous[PACKED_FRAME_SIZE] = {0};  // For frame blending
+// Word aligned so the scanline path can copy/composite a line 32 bits at a time.
+// Uninitialized (cleared in main) so that DMG_SRAM_BANKS can link them into a
+// bank of their own, away from the TMDS buffers the DVI DMA reads.
+static uint8_t __uninitialized_ram(packed_buffer_0)[PACKED_FRAME_SIZE] __attribute__((aligned(4)));
+static uint8_t __uninitialized_ram(packed_buffer_1)[PACKED_FRAME_SIZE] __attribute__((aligned(4)));
+static uint8_t __uninitialized_ram(packed_buffer_previous)[PACKED_FRAME_SIZE] __attribute__((aligned(4)));  // For frame blending
 
 // TMDS encoder handles palette conversion and horizontal scaling
 static volatile uint8_t* packed_display_ptr = packed_buffer_0;
@@ -202,10 +275,19 @@ static volatile uint8_t* packed_display_ptr = packed_buffer_0;
 // Frame blending - blends previous frame with current for sprite overlay effects
 static volatile bool frame_blending_enabled = false;
 
-// Frame blending lookup tables for ultra-fast processing
-// Precomputed lookup table for brightening effect (256 bytes)
-// Only store_lut is needed; blend calculation is done inline to save 64KB of RAM
-static uint8_t store_lut[256];             // What to store for next frame
+// Frame blending stores frame_blend_store_lut[] (dmg_tables.h) of each byte for
+// the next frame; blend calculation is done inline to save 64KB of RAM
+
+// LCD grid. Horizontal gaps come from the palette's gap words in the x4
+// encoder; vertical gaps are a line of grid colour, encoded once here and
+// shown by libdvi on the last line of each scanline buffer. Both are held off
+// while the OSD or HUD is up, as they would cut through the text.
+static const char *const lcd_effect_names[LCD_EFFECT_COUNT] = {"OFF", "GRID", "SCANLINES"};
+static lcd_effect_t lcd_effect = LCD_EFFECT_OFF;
+static volatile bool lcd_grid_enabled = false;   // read by the encoder
+static uint32_t *lcd_grid_line = NULL;           // TMDS scanline buffer of grid colour
+static const struct dvi_timing *lcd_grid_line_timing = NULL;
+static int lcd_grid_line_scheme = -1;
 
 // PIO video capture
 // PIO NOTES:
@@ -244,44 +326,86 @@ const uint32_t palette__gbp_nso[4] = {
 };
 
 const uint32_t* game_palette_rgb888 = palette__gbp_nso;
+// Pre-encoded TMDS symbols for the current scheme, read by the scanline encoder.
+// set_game_palette() copies the scheme into scratch Y, which only the core 0
+// stack shares, so core 1 lookups don't contend with the framebuffers. Two
+// copies: the one being filled is never the one core 1 was last given.
+static scheme_tmds_t __scratch_y("game_palette") game_palette_ram[2];
+static const scheme_tmds_t *volatile game_palette_tmds = &scheme_tmds_palettes[SCHEME_SGB_4H];
 
-uint8_t line_buffer[DMG_PIXELS_X / 4] = {0};  // 40 bytes for 160 pixels packed
+uint8_t line_buffer[DMG_PIXELS_X / 4] __attribute__((aligned(4))) = {0};  // 40 bytes for 160 pixels packed
 
 #if ENABLE_AUDIO
 // configuration
-const struct analog_microphone_config mic_config = {
+struct analog_microphone_config mic_config = {
     // GPIO to use for input, must be ADC compatible (GPIO 26 - 28)
     .gpio = PIN_AUDIO_IN,
 
     // bias voltage of microphone in volts
     .bias_voltage = 1.65f,
 
-    // sample rate in Hz - match HDMI audio
-    .sample_rate = SAMPLE_FREQ,
+    // ADC conversion rate in Hz - the HDMI audio rate times the oversampling
+    // factor; the CIC decimator in emusound.c brings it back down
+    .sample_rate = SAMPLE_FREQ * ADC_OVERSAMPLE,
 
-    // ADC fills 128 samples every 4ms, timer reads 128 samples every 4ms
+    // ADC fills one buffer per 128 output samples (4ms at 32 kHz)
     // Cuts DMA IRQ frequency vs the original 64-sample cadence without long-latency buzz
-    .sample_buffer_size = ADC_CHUNK_SIZE,
-#if PICO_RP2350 && AUDIO_ON_CORE1
+    .sample_buffer_size = ADC_RAW_CHUNK_SIZE,
+#if PICO_RP2350 && AUDIO_IN_CORE1_LOOP
     .dma_irq = DMA_IRQ_3    // POC - not really needed
 #else
     .dma_irq = -1  // Use default DMA IRQ
 #endif
 };
-// variables - use double buffering to avoid race conditions
-int16_t sample_buffer_a[ADC_CHUNK_SIZE];
-int16_t sample_buffer_b[ADC_CHUNK_SIZE];
-volatile int16_t* adc_write_buffer = sample_buffer_a;  // ADC writes here
-volatile int16_t* adc_read_buffer = sample_buffer_b;   // timer reads from here
-
-// Fixed buffer that audio always reads from (ADC copies to this)
-int16_t sample_buffer_for_audio[ADC_CHUNK_SIZE];
 #endif // ENABLE_AUDIO
 
 static volatile bool dma_irq_ready_core1 = false;
 
+// Settings are saved without stopping video. In the PICO_COPY_TO_RAM build
+// nothing but the settings store reads flash, so erases and programs simply
+// run with video live and none of the below is compiled.
+//
+// In an XIP build a flash page program is fitted into vertical blanking,
+// where the DVI IRQ runs from RAM, while core1 waits in RAM with its other
+// IRQs off. A sector erase takes tens of ms and can't hide anywhere, so video
+// is paused for that; the settings journal only erases once every 64 saves.
+//
+// The window is sized for a typical page program: the W25Q16JV on the Pico
+// takes 0.4 ms typ, 3 ms max. No mode's blanking (0.7 - 1.4 ms) fits the
+// maximum, so each program is timed instead, and once one runs past the
+// window every later save pauses video.
+#if !PICO_COPY_TO_RAM
+#define FLASH_PROGRAM_WINDOW_US     500     // page program plus SDK overhead
+#define FLASH_WINDOW_TIMEOUT_US     500000  // give up and pause video instead
+
+static volatile bool core1_park_request = false;
+static volatile bool core1_parked = false;
+static bool flash_paused_video = false;
+static bool flash_program_slow = false;  // a program overran the window
+static uint32_t flash_program_start_us;
+#endif
+
+// Pipeline counters for the performance HUD
+static volatile uint32_t vsync_count = 0;        // VSYNC edges seen from the Game Boy
+static volatile uint32_t frames_captured = 0;    // complete frames captured
+static volatile uint32_t core0_busy_us = 0;      // main loop time spent doing work
+static volatile uint32_t core1_busy_us = 0;      // scanline encode time (excludes queue waits)
+static volatile uint32_t core1_encode_max_us = 0; // longest single scanline encode, cleared by the HUD
+static volatile uint32_t osd_compose_cycles = 0;  // SysTick cycles in OSD_compose_tmds_line() (DVI_COLLECT_STATS)
+// HUD page on screen, 0 when it is off. Pages are OSD_HUD_LINES lines of
+// about 13 characters, as the compose cost goes with lines x widest line.
+#define PERF_HUD_PAGES 3
+static uint perf_hud_page = 0;
+static uint32_t osd_compose_per_frame = 0;        // last second's averages, from update_perf_hud()
+static uint32_t osd_compose_pct_x100 = 0;
+
 static restart_option_t restart_option = RESTART_NORMAL;
 
+static const char *boot_checkpoint_labels[BOOT_CHECKPOINT_MAX];
+static uint32_t boot_checkpoint_us[BOOT_CHECKPOINT_MAX];
+static uint boot_checkpoint_count = 0;
+static uint32_t boot_delay_us = 0;       // console and splash waits so far
+
 // Duplicated from tmds_encode.c
 static const __unused uint32_t __scratch_x("tmds_table") tmds_table[] = {
 #include "tmds_table.h"
@@ -292,16 +416,15 @@ static const __unused uint32_t __scratch_x("tmds_table") tmds_table[] = {
 //********************************************************************************
 static void core1_main(void);
 static void __no_inline_not_in_flash_func(prepare_scanline_2bpp_gameboy)(struct dvi_inst *inst, const uint8_t *packed_scanbuf);
-static void __not_in_flash_func(tmds_encode_2bpp_packed_gameboy)(const uint8_t *packed_pixbuf,
-                                    uint32_t *symbuf_r,
-                                    uint32_t *symbuf_g,
-                                    uint32_t *symbuf_b,
-                                    size_t output_words,
-                                    uint32_t horizontal_repeat,
-                                    size_t input_pixels,
-                                    const uint32_t *palette_rgb888);
+static void __not_in_flash_func(tmds_encode_2bpp_gameboy_x2)(const uint8_t *packed_pixbuf, uint32_t *symbuf_r, uint32_t *symbuf_g, uint32_t *symbuf_b, size_t output_words, const scheme_tmds_t *palette_tmds);
+static void __not_in_flash_func(tmds_encode_2bpp_gameboy_x4)(const uint8_t *packed_pixbuf, uint32_t *symbuf_r, uint32_t *symbuf_g, uint32_t *symbuf_b, size_t output_words, const scheme_tmds_t *palette_tmds);
+static void __not_in_flash_func(tmds_encode_2bpp_gameboy_x3)(const uint8_t *packed_pixbuf, uint32_t *symbuf_r, uint32_t *symbuf_g, uint32_t *symbuf_b, size_t output_words, const scheme_tmds_t *palette_tmds);
+static void __not_in_flash_func(tmds_encode_2bpp_gameboy_x5)(const uint8_t *packed_pixbuf, uint32_t *symbuf_r, uint32_t *symbuf_g, uint32_t *symbuf_b, size_t output_words, const scheme_tmds_t *palette_tmds);
+static void __not_in_flash_func(tmds_encode_2bpp_gameboy_spans)(const uint8_t *packed_pixbuf, uint32_t *symbuf_r, uint32_t *symbuf_g, uint32_t *symbuf_b, size_t output_words, const scheme_tmds_t *palette_tmds);
+static void __not_in_flash_func(tmds_encode_2bpp_gameboy_scale2x)(const uint8_t *packed_pixbuf, uint32_t *symbuf_r, uint32_t *symbuf_g, uint32_t *symbuf_b, size_t output_words, const scheme_tmds_t *palette_tmds);
+static void __not_in_flash_func(tmds_encode_2bpp_gameboy_scale4x)(const uint8_t *packed_pixbuf, uint32_t *symbuf_r, uint32_t *symbuf_g, uint32_t *symbuf_b, size_t output_words, const scheme_tmds_t *palette_tmds);
+static void build_game_spans(uint game_width);
 static void __no_inline_not_in_flash_func(core1_scanline_callback)(uint scanline);
-static void init_frame_blending_luts(void);
 static void set_game_palette(int index);
 static void initialize_gpio(void);
 // static bool nes_classic_controller(void);
@@ -315,15 +438,278 @@ static void save_settings(void);
 static void reset_pico(restart_option_t restart_option);
 static void load_settings(void);
 static void boot_checkpoint(const char *label);
-
-#if ENABLE_AUDIO
-static void on_analog_samples_ready(void);
-// static void __not_in_flash_func(on_analog_samples_ready)(void);
-#endif // ENABLE_AUDIO
+static void boot_summary(void);
+static void boot_delay_ms(uint32_t ms);
+#if !PICO_COPY_TO_RAM
+static void __no_inline_not_in_flash_func(core1_park)(void);
+static void core1_service_park_request(void);
+static bool settings_flash_window_begin(void);
+static void settings_flash_hook(bool begin, bool erase);
+#endif
+static void core1_set_flash_irqs_enabled(bool enabled);
+static void __no_inline_not_in_flash_func(core1_wait_video_restart)(void);
 
 static void __no_inline_not_in_flash_func(gpio_callback)(uint gpio, uint32_t events);
 static void update_osd(void);
+static void update_perf_hud(void);
+static void step_perf_hud(int step);
 static void change_audio_gain(float delta);
+static int get_audio_rate_index(void);
+static void set_audio_rate(int index);
+static int get_audio_latency_index(void);
+static void set_audio_latency(int index);
+static void apply_video_mode(const video_mode_t *mode);
+static void set_video_clocks(const video_mode_t *mode, const video_mode_t *previous);
+static uint flash_clkdiv_for_khz(uint32_t sys_khz);
+static void __no_inline_not_in_flash_func(set_flash_clkdiv)(uint div);
+static uint32_t scanline_budget_us(const video_mode_t *mode);
+static int get_video_mode_index(void);
+static int next_video_mode_index(int step);
+static void set_video_mode(int index);
+static void set_lcd_effect(int index);
+static void update_lcd_grid(void);
+static void core1_stop_video(void);
+
+//********************************************************************************
+// VIDEO MODES
+//********************************************************************************
+static const struct dvi_timing __not_in_flash_func(dvi_timing_800x600p_60hz_280K) = {
+    .h_sync_polarity   = false,
+    .h_front_porch     = 44,
+    .h_sync_width      = 128,
+    .h_back_porch      = 88,
+    .h_active_pixels   = 800,
+
+    .v_sync_polarity   = false,
+    .v_front_porch     = 2,        // increased from 1
+    .v_sync_width      = 4,
+    .v_back_porch      = 22,
+    .v_active_lines    = 600,
+
+    .bit_clk_khz       = 280000
+};
+
+// libdvi's 960x540p60 and reduced-blanking 720p30 have a 32 pixel hsync, too
+// short to carry the audio data island (W_DATA_ISLAND = 36). Same totals and
+// clocks, with the sync widened into the back porch.
+static const struct dvi_timing __not_in_flash_func(dvi_timing_960x540p_60hz_audio) = {
+    .h_sync_polarity   = true,
+    .h_front_porch     = 16,
+    .h_sync_width      = 40,
+    .h_back_porch      = 88,
+    .h_active_pixels   = 960,
+
+    .v_sync_polarity   = true,
+    .v_front_porch     = 2,
+    .v_sync_width      = 6,
+    .v_back_porch      = 15,
+    .v_active_lines    = 540,
+
+    .bit_clk_khz       = 372000
+};
+
+static const struct dvi_timing __not_in_flash_func(dvi_timing_1280x720p_reduced_30hz_audio) = {
+    .h_sync_polarity   = true,
+    .h_front_porch     = 48,
+    .h_sync_width      = 40,
+    .h_back_porch      = 72,
+    .h_active_pixels   = 1280,
+
+    .v_sync_polarity   = false,
+    .v_front_porch     = 3,
+    .v_sync_width      = 5,
+    .v_back_porch      = 13,
+    .v_active_lines    = 720,
+
+    .bit_clk_khz       = 319200
+};
+
+// Indexed by RESOLUTION_MODE_*. The encoder has the horizontal scale built in
+// and is picked once per mode change, not per scanline.
+//
+// Per-buffer budgets, from scanline_budget_us(), and core1 headroom as read
+// off the ENC line (HUD page 2) on hardware. No mode has been measured with
+// the current encoders yet; fill in the last column as they are.
+//                                   budget             ENC headroom
+//   640X480, 640 FULL               95 us (3 lines)    not measured
+//   640 ASPECT                      95 us (3 lines)    not measured   exp.
+//   640 SMALL                       63 us (2 lines)    not measured   exp.
+//   800X600, 800 FULL              151 us (4 lines)    not measured
+//   800 ASPECT, 800 FILL           151 us (4 lines)    not measured   exp.
+//   960X540 (1.30 V)                89 us (3 lines)    not measured   exp.
+//   1280X720                       225 us (5 lines)    not measured   exp.
+//   2X SMOOTH                       31 us (1 line)     not measured   exp.
+//   4X SMOOTH                       37 us (1 line)     not measured   exp.
+// 640X480 and 800X600 are the timings and scales the original single-mode
+// build shipped with. The FULL modes run the same encoder at the same clock,
+// and their shortest buffer has the same budget, so they stay in the OSD's
+// cycle too. Every other mode is experimental until measured: it is only
+// offered with ENABLE_EXPERIMENTAL_MODES, or when RESOLUTION_MODE picks it.
+// 960X540 also runs the core at 1.30 V, which has not been checked for
+// stability or heat on any board.
+// The SMOOTH modes have a single line per buffer, so nothing absorbs a slow
+// one, and DVI_REPEAT_LATE_SCANLINE hides an overrun (watch REP on HUD page
+// 3). Estimated, not measured, from scale2x.h's inner loop at ~20 cycles per
+// output word pair on the M0+: Scale2x ~4.5k of the 8.0k cycles a 2X SMOOTH
+// line has at 252 MHz; Scale4x's final pass ~7.6k plus one 2x row ~2.5k plus
+// borders, ~10.5k of 10.6k at 280 MHz, which leaves nothing for the DVI,
+// data island and audio IRQs.
+static const video_mode_t video_modes[RESOLUTION_MODE_COUNT] =
+{
+    [RESOLUTION_MODE_640x480_x4x3] = {
+        .name = "640X480",
+        .timing = &dvi_timing_640x480p_60hz,
+        .vreg_voltage = VREG_VOLTAGE_1_10,  // 252 MHz is comfortable at lower voltage
+        .scanline_count = 480 / 3,
+        .game_width = DMG_PIXELS_X * 4,
+        .encoder = tmds_encode_2bpp_gameboy_x4,
+    },
+    [RESOLUTION_MODE_800x600] = {
+        .name = "800X600",
+        .timing = &dvi_timing_800x600p_60hz_280K,
+        .vreg_voltage = VREG_VOLTAGE_1_20,
+        .scanline_count = 600 / 4,
+        .game_width = DMG_PIXELS_X * 4,
+        .encoder = tmds_encode_2bpp_gameboy_x4,
+    },
+    [RESOLUTION_MODE_640x480_x2x2] = {
+        .name = "640 SMALL",
+        .timing = &dvi_timing_640x480p_60hz,
+        .vreg_voltage = VREG_VOLTAGE_1_10,
+        .scanline_count = 480 / 2,
+        .game_width = DMG_PIXELS_X * 2,
+        .experimental = true,
+        .encoder = tmds_encode_2bpp_gameboy_x2,
+    },
+    // Full height: each Game Boy line is shown 3 or 4 times (x3.33)
+    [RESOLUTION_MODE_640x480_FULL] = {
+        .name = "640 FULL",
+        .timing = &dvi_timing_640x480p_60hz,
+        .vreg_voltage = VREG_VOLTAGE_1_10,
+        .scanline_count = DMG_PIXELS_Y,
+        .game_width = DMG_PIXELS_X * 4,
+        .encoder = tmds_encode_2bpp_gameboy_x4,
+    },
+    // Full height: 4 or 5 times (x4.17)
+    [RESOLUTION_MODE_800x600_FULL] = {
+        .name = "800 FULL",
+        .timing = &dvi_timing_800x600p_60hz_280K,
+        .vreg_voltage = VREG_VOLTAGE_1_20,
+        .scanline_count = DMG_PIXELS_Y,
+        .game_width = DMG_PIXELS_X * 4,
+        .encoder = tmds_encode_2bpp_gameboy_x4,
+    },
+    // Full height with square pixels: 160 * 480 / 144 = 533.3 wide
+    [RESOLUTION_MODE_640x480_ASPECT] = {
+        .name = "640 ASPECT",
+        .timing = &dvi_timing_640x480p_60hz,
+        .vreg_voltage = VREG_VOLTAGE_1_10,
+        .scanline_count = DMG_PIXELS_Y,
+        .game_width = 534,
+        .experimental = true,
+        .encoder = tmds_encode_2bpp_gameboy_spans,
+    },
+    // Full height with square pixels: 160 * 600 / 144 = 666.7 wide
+    [RESOLUTION_MODE_800x600_ASPECT] = {
+        .name = "800 ASPECT",
+        .timing = &dvi_timing_800x600p_60hz_280K,
+        .vreg_voltage = VREG_VOLTAGE_1_20,
+        .scanline_count = DMG_PIXELS_Y,
+        .game_width = 666,
+        .experimental = true,
+        .encoder = tmds_encode_2bpp_gameboy_spans,
+    },
+    // Whole screen, x5 by x4.17
+    [RESOLUTION_MODE_800x600_FILL] = {
+        .name = "800 FILL",
+        .timing = &dvi_timing_800x600p_60hz_280K,
+        .vreg_voltage = VREG_VOLTAGE_1_20,
+        .scanline_count = DMG_PIXELS_Y,
+        .game_width = 800,
+        .experimental = true,
+        .encoder = tmds_encode_2bpp_gameboy_spans,
+    },
+    // x3 both ways, window = 480x432. 372 MHz: needs the extra voltage
+    [RESOLUTION_MODE_960x540_x3] = {
+        .name = "960X540",
+        .timing = &dvi_timing_960x540p_60hz_audio,
+        .vreg_voltage = VREG_VOLTAGE_1_30,
+        .scanline_count = 540 / 3,
+        .game_width = DMG_PIXELS_X * 3,
+        .experimental = true,
+        .encoder = tmds_encode_2bpp_gameboy_x3,
+    },
+    // x5 both ways, window = 800x720, refreshed at 30 Hz
+    [RESOLUTION_MODE_1280x720_x5] = {
+        .name = "1280X720",
+        .timing = &dvi_timing_1280x720p_reduced_30hz_audio,
+        .vreg_voltage = VREG_VOLTAGE_1_25,
+        .scanline_count = 720 / 5,
+        .game_width = DMG_PIXELS_X * 5,
+        .experimental = true,
+        .encoder = tmds_encode_2bpp_gameboy_x5,
+    },
+    // Scale2x (EPX) smoothing, window = 320x288. One scanline buffer per
+    // output line, each Game Boy line gives two different ones.
+    [RESOLUTION_MODE_640x480_SCALE2X] = {
+        .name = "2X SMOOTH",
+        .timing = &dvi_timing_640x480p_60hz,
+        .vreg_voltage = VREG_VOLTAGE_1_10,
+        .scanline_count = 480,
+        .game_width = DMG_PIXELS_X * 2,
+        .smooth_shift = 1,
+        .experimental = true,
+        .encoder = tmds_encode_2bpp_gameboy_scale2x,
+    },
+    // Scale4x (AdvMAME4x, Scale2x twice) smoothing, window = 640x576
+    [RESOLUTION_MODE_800x600_SCALE4X] = {
+        .name = "4X SMOOTH",
+        .timing = &dvi_timing_800x600p_60hz_280K,
+        .vreg_voltage = VREG_VOLTAGE_1_20,
+        .scanline_count = 600,
+        .game_width = DMG_PIXELS_X * 4,
+        .smooth_shift = 2,
+        .experimental = true,
+        .encoder = tmds_encode_2bpp_gameboy_scale4x,
+    },
+};
+
+static_assert(RESOLUTION_MODE >= 0 && RESOLUTION_MODE < RESOLUTION_MODE_COUNT, "unknown RESOLUTION_MODE");
+
+static const video_mode_t *video_mode = &video_modes[RESOLUTION_MODE];
+
+// Experimental modes stay out of the OSD's cycle and the saved settings, but
+// one picked at build time with RESOLUTION_MODE is always available
+static inline bool video_mode_offered(const video_mode_t *mode)
+{
+    return ENABLE_EXPERIMENTAL_MODES || !mode->experimental || mode == &video_modes[RESOLUTION_MODE];
+}
+// Derived from video_mode by apply_video_mode(); only changed while DVI is stopped
+static uint scanline_count;              // scanline buffers per frame
+static uint vertical_offset;             // scanline buffer the callback fetches Game Boy line 0 for
+static scanline_encoder_t scanline_encoder;
+
+// Horizontal span table for tmds_encode_2bpp_gameboy_spans(), one entry per
+// Game Boy pixel: the number of whole TMDS words it fills, plus a flag for a
+// following word split with the next pixel
+#define GAME_SPAN_SPLIT 0x80
+#define GAME_SPAN_WORDS_MASK 0x7f
+static uint8_t __scratch_x("game_spans") game_spans[DMG_PIXELS_X];
+static uint game_span_words;             // words across the game area
+
+// Smoothing scalers (scale2x.h)
+#define SMOOTH_JOBS 8                    // more lines than q_colour_valid can hold
+static smooth_job_t smooth_jobs[SMOOTH_JOBS];
+static smooth_job_t *smooth_job = NULL;  // job for the line being queued
+static uint smooth_job_idx = 0;
+static uint smooth_shift;                // from the mode
+static uint game_rows;                   // scanline buffers covered by the Game Boy image
+static scale4x_cache_t scale4x_cache = {.row_index = {-1, -1, -1, -1}};  // Scale4x's recent 2x rows
+static uint encode_scanline_idx = 0;     // next scanline buffer core1 encodes
+
+// Set by core0 to have core1 stop DVI and wait while the mode is changed
+static volatile bool video_stop_request = false;
+static volatile bool core1_video_stopped = false;
 
 //********************************************************************************
 // PRIVATE FUNCTIONS
@@ -335,18 +721,29 @@ static void core1_main(void)
     SHARED_DMA_Init(mic_config.dma_irq);
     printf("Shared DMA IRQ handler installed on Core 1\n");
 
+    // Lets core0 pause this core while it erases flash for settings
+    multicore_lockout_victim_init();
+
     dma_irq_ready_core1 = true;
     // Notify core0 that DMA IRQ handler is armed
     multicore_fifo_push_blocking(0xDACEB00C);  // arbitrary value, just a signal
     dvi_register_irqs_this_core(&dvi0, DMA_IRQ_0);
     dvi_start(&dvi0);
-    
-#if ENABLE_AUDIO && AUDIO_ON_CORE1
-    absolute_time_t next_audio_tick = delayed_by_ms(get_absolute_time(), AUDIO_TICK_MS);
-#endif
+
 
     while (true)
     {
+#if !PICO_COPY_TO_RAM
+        if (core1_park_request)
+        {
+            core1_service_park_request();
+        }
+#endif
+        if (video_stop_request)
+        {
+            core1_stop_video();
+        }
+
         const uint8_t *scanbuf = NULL;
         if (queue_try_remove_u32(&dvi0.q_colour_valid, (uint32_t*)&scanbuf))
         {
@@ -354,40 +751,105 @@ static void core1_main(void)
             queue_add_blocking_u32(&dvi0.q_colour_free, (uint32_t*)&scanbuf);
         }
 
-#if ENABLE_AUDIO && AUDIO_ON_CORE1
-        // Run audio chunking on Core 1 to reduce contention with VSYNC GPIO handling on Core 0
-        if (time_reached(next_audio_tick)) 
-        {
-            emu_audio_manual_tick();
-            next_audio_tick = delayed_by_ms(next_audio_tick, AUDIO_TICK_MS);
-        }
+#if ENABLE_AUDIO && AUDIO_IN_CORE1_LOOP
+        // Convert completed ADC chunks in the gaps between scanlines
+        const uint32_t work_start_us = time_us_32();
+        emu_audio_service();
+        core1_busy_us += time_us_32() - work_start_us;
+#endif
+    }
+}
+
+#if !PICO_COPY_TO_RAM
+// Spins from RAM until core0 has finished programming flash
+static void __no_inline_not_in_flash_func(core1_park)(void)
+{
+    core1_parked = true;
+    while (core1_park_request)
+    {
+        tight_loop_contents();
+    }
+    core1_parked = false;
+}
+
+// Called from the core1 loop, never mid-scanline. Only the DVI IRQ stays
+// live while parked; the flash-resident IRQs are held off until core1 is
+// released.
+static void core1_service_park_request(void)
+{
+    core1_set_flash_irqs_enabled(false);
+    core1_park();
+    core1_set_flash_irqs_enabled(true);
+}
+#endif
+
+// Holds off core1's audio and data island IRQs. In an XIP build they run from
+// flash, so they must stay off while flash is offline or being reclocked; in
+// the PICO_COPY_TO_RAM build they are only kept quiet while DVI is rebuilt.
+static void core1_set_flash_irqs_enabled(bool enabled)
+{
+#if ENABLE_AUDIO
+    const uint audio_irq = (mic_config.dma_irq >= 0) ? (uint)mic_config.dma_irq : DMA_IRQ_1;
+    irq_set_enabled(audio_irq, enabled);
 #endif
+    if (dvi0.data_island_irq >= 0)
+    {
+        irq_set_enabled(dvi0.data_island_irq, enabled);
+    }
+}
+
+static void __no_inline_not_in_flash_func(core1_wait_video_restart)(void)
+{
+    core1_video_stopped = true;
+    while (video_stop_request)
+    {
+        tight_loop_contents();
     }
 }
 
+// Called from the core1 loop, which holds no TMDS buffer here. Core0 changes
+// clocks (including the flash clock, so core1 waits in RAM) and rebuilds the
+// DVI state, then clears the request.
+static void core1_stop_video(void)
+{
+    // With interrupts off the DMA IRQ can't be halfway through loading the
+    // next line's list when the channels are aborted
+    uint32_t ints = save_and_disable_interrupts();
+    dvi_stop(&dvi0);
+    irq_clear(DMA_IRQ_0);
+    restore_interrupts(ints);
+
+    core1_set_flash_irqs_enabled(false);
+    core1_wait_video_restart();
+    core1_set_flash_irqs_enabled(true);
+
+    dvi_start(&dvi0);
+    core1_video_stopped = false;
+}
+
+// Game Boy line for a scanline buffer, DMG_PIXELS_Y or more in the border.
+// Wraps, because a full-height mode fetches the top lines at the end of the
+// previous frame.
+static __force_inline uint dmg_line_for_scanline(uint scanline)
+{
+    return (scanline >= vertical_offset) ? scanline - vertical_offset : scanline + scanline_count - vertical_offset;
+}
+
 static void __no_inline_not_in_flash_func(prepare_scanline_2bpp_gameboy)(struct dvi_inst *inst, const uint8_t *packed_scanbuf)
 {
-    static uint scanline_idx = 0;
 
     uint32_t *tmdsbuf = NULL;
     queue_remove_blocking_u32(&inst->q_tmds_free, &tmdsbuf);
+    const uint32_t encode_start_us = time_us_32();
     uint pixwidth = inst->timing->h_active_pixels;             // e.g., 800
     uint words_per_channel = pixwidth / DVI_SYMBOLS_PER_WORD;  // e.g., 400 when SPW=2
 
-    static const uint32_t default_palette[4] = {
-        0xb5c69c, 0x8d9c7b, 0x6c7251, 0x303820
-    };
-    const uint32_t *palette = (const uint32_t*)inst->blank_settings.palette_rgb888;
-    if (palette == NULL) {
-        palette = default_palette;
-    }
+    const scheme_tmds_t *palette = game_palette_tmds;
 
-    const uint current_scanline = scanline_idx;
-    scanline_idx = (scanline_idx + 1) % SCANLINE_COUNT;
+    const uint current_scanline = encode_scanline_idx;
+    encode_scanline_idx = (encode_scanline_idx + 1 == scanline_count) ? 0 : encode_scanline_idx + 1;
 
-    const bool in_active_window =
-        (current_scanline >= VERTICAL_OFFSET) &&
-        (current_scanline < (DMG_PIXELS_Y + VERTICAL_OFFSET));
+    const bool in_active_window = dmg_line_for_scanline(current_scanline) < game_rows;
 
     if (!in_active_window || packed_scanbuf == NULL)
     {
@@ -401,17 +863,32 @@ static void __no_inline_not_in_flash_func(prepare_scanline_2bpp_gameboy)(struct
     } 
     else 
     {
-        tmds_encode_2bpp_packed_gameboy(
+        scanline_encoder(
             packed_scanbuf,
             tmdsbuf + 2 * words_per_channel,  // Red
             tmdsbuf + 1 * words_per_channel,  // Green
             tmdsbuf + 0 * words_per_channel,  // Blue
             words_per_channel,
-            HORIZONTAL_SCALE,
-            DMG_PIXELS_X,
             palette);
     }
 
+    // OSD is drawn at output resolution on top of the encoded line; it may
+    // also cover the border area and blank lines outside the game window
+#if DVI_COLLECT_STATS
+    const uint32_t compose_start = systick_hw->cvr;
+    OSD_compose_tmds_line(tmdsbuf, words_per_channel, (int)current_scanline);
+    // SysTick counts down, and dvi_register_irqs_this_core() started it on core1
+    osd_compose_cycles += (compose_start - systick_hw->cvr) & 0x00ffffffu;
+#else
+    OSD_compose_tmds_line(tmdsbuf, words_per_channel, (int)current_scanline);
+#endif
+
+    const uint32_t encode_us = time_us_32() - encode_start_us;
+    core1_busy_us += encode_us;
+    if (encode_us > core1_encode_max_us)
+    {
+        core1_encode_max_us = encode_us;
+    }
     queue_add_blocking_u32(&inst->q_tmds_valid, &tmdsbuf);
 }
                                      
@@ -426,7 +903,7 @@ static void __no_inline_not_in_flash_func(prepare_scanline_2bpp_gameboy)(struct
 // Input: 40 bytes (160 GB pixels packed as 2bpp)
 // Output: 800 pixels (80 black border + 640 game area + 80 black border)
 // With DVI_SYMBOLS_PER_WORD=2: 800 pixels = 400 words per channel
-static void __not_in_flash_func(tmds_encode_2bpp_packed_gameboy)(
+static __force_inline void tmds_encode_2bpp_packed_gameboy(
     const uint8_t *packed_pixbuf,    // Input: packed pixels (e.g., 40 bytes = 160 pixels)
     uint32_t *symbuf_r,              // Output: Red channel TMDS symbols
     uint32_t *symbuf_g,              // Output: Green channel TMDS symbols
@@ -434,34 +911,31 @@ static void __not_in_flash_func(tmds_encode_2bpp_packed_gameboy)(
     size_t output_words,             // Number of output words per channel (pixels = output_words × DVI_SYMBOLS_PER_WORD)
     uint32_t horizontal_repeat,      // Horizontal scale factor (e.g., 4 for x4, 2 for x2)
     size_t input_pixels,             // Number of source pixels in the line (e.g., 160)
-    const uint32_t *palette_rgb888   // Palette: 4 RGB888 colors (0xRRGGBB format)
+    const scheme_tmds_t *palette_tmds // Palette: 4 colors pre-encoded per lane (gen_tables.py)
 )
 {
-    // Build TMDS symbol lookup tables from RGB888 palette at runtime
-    // This happens once per scanline, but it's only 12 lookups total (4 colors × 3 channels)
-    uint32_t tmds_palette_red[4];
-    uint32_t tmds_palette_green[4];
-    uint32_t tmds_palette_blue[4];
-
-    for (int i = 0; i < 4; i++)
-    {
-        uint32_t color = palette_rgb888[i];
-        uint8_t r8 = (color >> 16) & 0xFF;
-        uint8_t g8 = (color >> 8) & 0xFF;
-        uint8_t b8 = color & 0xFF;
-        
-        // Convert 8-bit to 6-bit indices for tmds_table lookup
-        tmds_palette_red[i]   = tmds_table[r8 >> 2];
-        tmds_palette_green[i] = tmds_table[g8 >> 2];
-        tmds_palette_blue[i]  = tmds_table[b8 >> 2];
-    }
+    // The palette is encoded at build time; copy it into registers/stack once
+    // per scanline rather than reading flash for every pixel. Only the
+    // pixel-doubled words, integer scales never split a word.
+    uint32_t palette_r[4], palette_g[4], palette_b[4];
+    memcpy(palette_r, palette_tmds->red, sizeof(palette_r));
+    memcpy(palette_g, palette_tmds->green, sizeof(palette_g));
+    memcpy(palette_b, palette_tmds->blue, sizeof(palette_b));
+
+    // The last word of each pixel; for the LCD grid it ends in the grid colour.
+    // Not at x2, where that would be half the pixel.
+    const uint32_t words_per_pixel = horizontal_repeat / DVI_SYMBOLS_PER_WORD;  // each word = 2 pixels
+    const bool grid = lcd_grid_enabled && words_per_pixel > 1;
+    uint32_t last_r[4], last_g[4], last_b[4];
+    memcpy(last_r, grid ? palette_tmds->red_gap : palette_tmds->red, sizeof(last_r));
+    memcpy(last_g, grid ? palette_tmds->green_gap : palette_tmds->green, sizeof(last_g));
+    memcpy(last_b, grid ? palette_tmds->blue_gap : palette_tmds->blue, sizeof(last_b));
   
     // Get black color for borders (darkest color in palette)
     const uint32_t black_word = tmds_table[0];
   
     const uint8_t *src = packed_pixbuf;
     const size_t packed_bytes = input_pixels / 4;  // 4 pixels per packed byte
-    const uint32_t words_per_pixel = horizontal_repeat / DVI_SYMBOLS_PER_WORD;  // each word = 2 pixels
   
   // Calculate horizontal layout based on output_words
     // Compute active area from input pixel count and horizontal repeat factor
@@ -498,18 +972,22 @@ static void __not_in_flash_func(tmds_encode_2bpp_packed_gameboy)(
             uint8_t pixel_2bpp = (packed_byte >> shift) & 0x03;
             
             // Get TMDS symbol pair for this color
-            uint32_t word_r = tmds_palette_red[pixel_2bpp];
-            uint32_t word_g = tmds_palette_green[pixel_2bpp];
-            uint32_t word_b = tmds_palette_blue[pixel_2bpp];
+            uint32_t word_r = palette_r[pixel_2bpp];
+            uint32_t word_g = palette_g[pixel_2bpp];
+            uint32_t word_b = palette_b[pixel_2bpp];
             
             // Replicate this pixel horizontally: two TMDS symbols per word
-            for (uint32_t repeat = 0; repeat < words_per_pixel; repeat++)
+            for (uint32_t repeat = 1; repeat < words_per_pixel; repeat++)
             {
                 symbuf_r[word_idx] = word_r;
                 symbuf_g[word_idx] = word_g;
                 symbuf_b[word_idx] = word_b;
                 word_idx++;
             }
+            symbuf_r[word_idx] = last_r[pixel_2bpp];
+            symbuf_g[word_idx] = last_g[pixel_2bpp];
+            symbuf_b[word_idx] = last_b[pixel_2bpp];
+            word_idx++;
         }
     }
   
@@ -523,20 +1001,239 @@ static void __not_in_flash_func(tmds_encode_2bpp_packed_gameboy)(
     }
 }
 
+// Per-mode specialisations with the horizontal scale as a constant
+static void __not_in_flash_func(tmds_encode_2bpp_gameboy_x2)(const uint8_t *packed_pixbuf, uint32_t *symbuf_r, uint32_t *symbuf_g, uint32_t *symbuf_b, size_t output_words, const scheme_tmds_t *palette_tmds)
+{
+    tmds_encode_2bpp_packed_gameboy(packed_pixbuf, symbuf_r, symbuf_g, symbuf_b, output_words, 2, DMG_PIXELS_X, palette_tmds);
+}
+
+static void __not_in_flash_func(tmds_encode_2bpp_gameboy_x4)(const uint8_t *packed_pixbuf, uint32_t *symbuf_r, uint32_t *symbuf_g, uint32_t *symbuf_b, size_t output_words, const scheme_tmds_t *palette_tmds)
+{
+    tmds_encode_2bpp_packed_gameboy(packed_pixbuf, symbuf_r, symbuf_g, symbuf_b, output_words, 4, DMG_PIXELS_X, palette_tmds);
+}
+
+// Odd integer scales: a pair of Game Boy pixels makes horizontal_repeat words,
+// the middle one split between them
+static __force_inline void tmds_encode_2bpp_packed_gameboy_odd(
+    const uint8_t *packed_pixbuf,
+    uint32_t *symbuf_r,
+    uint32_t *symbuf_g,
+    uint32_t *symbuf_b,
+    size_t output_words,
+    uint32_t horizontal_repeat,
+    const scheme_tmds_t *palette_tmds)
+{
+    const scheme_tmds_t palette = *palette_tmds;
+    const uint32_t black_word = tmds_table[0];
+    const size_t packed_bytes = DMG_PIXELS_X / 4;
+    const uint32_t whole_words = (horizontal_repeat - 1) / 2;  // per pixel, either side of the split
+    const size_t game_words = DMG_PIXELS_X / 2 * horizontal_repeat;
+    const size_t border_words = (output_words > game_words) ? (output_words - game_words) / 2 : 0;
+    size_t word_idx = 0;
+
+    for (; word_idx < border_words; word_idx++)
+    {
+        symbuf_r[word_idx] = black_word;
+        symbuf_g[word_idx] = black_word;
+        symbuf_b[word_idx] = black_word;
+    }
+
+    for (size_t byte_idx = 0; byte_idx < packed_bytes; byte_idx++)
+    {
+        const uint packed_byte = packed_pixbuf[byte_idx];
+
+        for (int pair_in_byte = 0; pair_in_byte < 2; pair_in_byte++)
+        {
+            const uint shift = 4 - pair_in_byte * 4;
+            const uint left = (packed_byte >> (shift + 2)) & 0x03;
+            const uint right = (packed_byte >> shift) & 0x03;
+            const uint pair = (left << 2) | right;
+
+            for (uint32_t n = 0; n < whole_words; n++)
+            {
+                symbuf_r[word_idx] = palette.red[left];
+                symbuf_g[word_idx] = palette.green[left];
+                symbuf_b[word_idx] = palette.blue[left];
+                word_idx++;
+            }
+            symbuf_r[word_idx] = palette.red_split[pair];
+            symbuf_g[word_idx] = palette.green_split[pair];
+            symbuf_b[word_idx] = palette.blue_split[pair];
+            word_idx++;
+            for (uint32_t n = 0; n < whole_words; n++)
+            {
+                symbuf_r[word_idx] = palette.red[right];
+                symbuf_g[word_idx] = palette.green[right];
+                symbuf_b[word_idx] = palette.blue[right];
+                word_idx++;
+            }
+        }
+    }
+
+    while (word_idx < output_words)
+    {
+        symbuf_r[word_idx] = black_word;
+        symbuf_g[word_idx] = black_word;
+        symbuf_b[word_idx] = black_word;
+        word_idx++;
+    }
+}
+
+static void __not_in_flash_func(tmds_encode_2bpp_gameboy_x3)(const uint8_t *packed_pixbuf, uint32_t *symbuf_r, uint32_t *symbuf_g, uint32_t *symbuf_b, size_t output_words, const scheme_tmds_t *palette_tmds)
+{
+    tmds_encode_2bpp_packed_gameboy_odd(packed_pixbuf, symbuf_r, symbuf_g, symbuf_b, output_words, 3, palette_tmds);
+}
+
+static void __not_in_flash_func(tmds_encode_2bpp_gameboy_x5)(const uint8_t *packed_pixbuf, uint32_t *symbuf_r, uint32_t *symbuf_g, uint32_t *symbuf_b, size_t output_words, const scheme_tmds_t *palette_tmds)
+{
+    tmds_encode_2bpp_packed_gameboy_odd(packed_pixbuf, symbuf_r, symbuf_g, symbuf_b, output_words, 5, palette_tmds);
+}
+
+static __force_inline void tmds_fill_black(uint32_t *symbuf_r, uint32_t *symbuf_g, uint32_t *symbuf_b, size_t words)
+{
+    const uint32_t black_word = tmds_table[0];
+    for (size_t i = 0; i < words; i++)
+    {
+        symbuf_r[i] = black_word;
+        symbuf_g[i] = black_word;
+        symbuf_b[i] = black_word;
+    }
+}
+
+// Scale2x at 2 output pixels per Game Boy pixel, so one split word each
+static void __not_in_flash_func(tmds_encode_2bpp_gameboy_scale2x)(const uint8_t *packed_pixbuf, uint32_t *symbuf_r, uint32_t *symbuf_g, uint32_t *symbuf_b, size_t output_words, const scheme_tmds_t *palette_tmds)
+{
+    const smooth_job_t *job = (const smooth_job_t *)((uintptr_t)packed_pixbuf & ~(uintptr_t)SMOOTH_ROW_MASK);
+    const uint half = (uintptr_t)packed_pixbuf & SMOOTH_ROW_MASK;
+    uint32_t split_r[16], split_g[16], split_b[16];
+    memcpy(split_r, palette_tmds->red_split, sizeof(split_r));
+    memcpy(split_g, palette_tmds->green_split, sizeof(split_g));
+    memcpy(split_b, palette_tmds->blue_split, sizeof(split_b));
+
+    const size_t game_words = DMG_PIXELS_X;
+    const size_t border_words = (output_words > game_words) ? (output_words - game_words) / 2 : 0;
+    tmds_fill_black(symbuf_r, symbuf_g, symbuf_b, border_words);
+    scale2x_row(job->rows[1], job->rows[2], job->rows[3], DMG_PIXELS_X / 4, scale2x_lut[half], NULL,
+                symbuf_r + border_words, symbuf_g + border_words, symbuf_b + border_words,
+                split_r, split_g, split_b);
+    const size_t done = border_words + game_words;
+    tmds_fill_black(symbuf_r + done, symbuf_g + done, symbuf_b + done, output_words - done);
+}
+
+// Scale4x: Scale2x again on the 2x image. Consecutive lines share 2x rows, so
+// on average each output line makes half a 2x row plus its own pass.
+static void __not_in_flash_func(tmds_encode_2bpp_gameboy_scale4x)(const uint8_t *packed_pixbuf, uint32_t *symbuf_r, uint32_t *symbuf_g, uint32_t *symbuf_b, size_t output_words, const scheme_tmds_t *palette_tmds)
+{
+    const smooth_job_t *job = (const smooth_job_t *)((uintptr_t)packed_pixbuf & ~(uintptr_t)SMOOTH_ROW_MASK);
+    const uint sub_row = (uintptr_t)packed_pixbuf & SMOOTH_ROW_MASK;
+    uint32_t split_r[16], split_g[16], split_b[16];
+    memcpy(split_r, palette_tmds->red_split, sizeof(split_r));
+    memcpy(split_g, palette_tmds->green_split, sizeof(split_g));
+    memcpy(split_b, palette_tmds->blue_split, sizeof(split_b));
+
+    const uint8_t *rows[3];
+    scale4x_source_rows(&scale4x_cache, job, sub_row, scale2x_lut, rows);
+
+    const size_t game_words = DMG_PIXELS_X * 2;
+    const size_t border_words = (output_words > game_words) ? (output_words - game_words) / 2 : 0;
+    tmds_fill_black(symbuf_r, symbuf_g, symbuf_b, border_words);
+    scale2x_row(rows[0], rows[1], rows[2], DMG_PIXELS_X / 2, scale2x_lut[sub_row & 1], NULL,
+                symbuf_r + border_words, symbuf_g + border_words, symbuf_b + border_words,
+                split_r, split_g, split_b);
+    const size_t done = border_words + game_words;
+    tmds_fill_black(symbuf_r + done, symbuf_g + done, symbuf_b + done, output_words - done);
+}
+
+// Any even game width, driven by the span table built for the mode. A word
+// that straddles two Game Boy pixels comes from the palette's split words.
+static void __not_in_flash_func(tmds_encode_2bpp_gameboy_spans)(const uint8_t *packed_pixbuf, uint32_t *symbuf_r, uint32_t *symbuf_g, uint32_t *symbuf_b, size_t output_words, const scheme_tmds_t *palette_tmds)
+{
+    // Splits happen at most pixel boundaries, so take the whole palette
+    const scheme_tmds_t palette = *palette_tmds;
+    const uint32_t black_word = tmds_table[0];
+    const size_t packed_bytes = DMG_PIXELS_X / 4;
+    const size_t border_words = (output_words > game_span_words) ? (output_words - game_span_words) / 2 : 0;
+    const uint8_t *span = game_spans;
+    size_t word_idx = 0;
+
+    for (; word_idx < border_words; word_idx++)
+    {
+        symbuf_r[word_idx] = black_word;
+        symbuf_g[word_idx] = black_word;
+        symbuf_b[word_idx] = black_word;
+    }
+
+    for (size_t byte_idx = 0; byte_idx < packed_bytes; byte_idx++)
+    {
+        // The low byte supplies the right-hand pixel when this byte's last pixel splits
+        const uint next_byte = (byte_idx + 1 < packed_bytes) ? packed_pixbuf[byte_idx + 1] : 0;
+        const uint pixels = ((uint)packed_pixbuf[byte_idx] << 8) | next_byte;
+
+        for (int pixel_in_byte = 0; pixel_in_byte < 4; pixel_in_byte++)
+        {
+            const uint shift = 14 - pixel_in_byte * 2;
+            const uint pixel_2bpp = (pixels >> shift) & 0x03;
+            const uint span_entry = *span++;
+
+            const uint32_t word_r = palette.red[pixel_2bpp];
+            const uint32_t word_g = palette.green[pixel_2bpp];
+            const uint32_t word_b = palette.blue[pixel_2bpp];
+            for (uint n = span_entry & GAME_SPAN_WORDS_MASK; n > 0; n--)
+            {
+                symbuf_r[word_idx] = word_r;
+                symbuf_g[word_idx] = word_g;
+                symbuf_b[word_idx] = word_b;
+                word_idx++;
+            }
+
+            if (span_entry & GAME_SPAN_SPLIT)
+            {
+                const uint pair = (pixel_2bpp << 2) | ((pixels >> (shift - 2)) & 0x03);
+                symbuf_r[word_idx] = palette.red_split[pair];
+                symbuf_g[word_idx] = palette.green_split[pair];
+                symbuf_b[word_idx] = palette.blue_split[pair];
+                word_idx++;
+            }
+        }
+    }
+
+    while (word_idx < output_words)
+    {
+        symbuf_r[word_idx] = black_word;
+        symbuf_g[word_idx] = black_word;
+        symbuf_b[word_idx] = black_word;
+        word_idx++;
+    }
+}
+
 static void __no_inline_not_in_flash_func(core1_scanline_callback)(uint scanline)
 {
-    const bool in_active_window =
-        (scanline >= VERTICAL_OFFSET) && (scanline < (DMG_PIXELS_Y + VERTICAL_OFFSET));
+    const uint game_row = dmg_line_for_scanline(scanline);
 
     const uint8_t* packed_fb = (const uint8_t*)packed_display_ptr;
     const uint32_t *bufptr = NULL;
-    if (in_active_window && (packed_fb != NULL))
+    if (game_row < game_rows && (packed_fb != NULL) && smooth_shift == 0)
     {
-        uint dmg_line_idx = scanline - VERTICAL_OFFSET;
-        const uint8_t* packed_line = packed_fb + (dmg_line_idx * DMG_PIXELS_X / 4);  // 40 bytes per line
+        const uint8_t* packed_line = packed_fb + (game_row * DMG_PIXELS_X / 4);  // 40 bytes per line
         memcpy(line_buffer, packed_line, sizeof(line_buffer));  // Copy 40 bytes
         bufptr = (uint32_t*)line_buffer;
     }
+    else if (game_row < game_rows && (packed_fb != NULL))
+    {
+        // Smoothing: new job on the first output row of each line only
+        const uint sub_row = game_row & ((1u << smooth_shift) - 1);
+        if (sub_row == 0)
+        {
+            const int line = (int)(game_row >> smooth_shift);
+            smooth_job = &smooth_jobs[smooth_job_idx];
+            smooth_job_idx = (smooth_job_idx + 1) % SMOOTH_JOBS;
+            smooth_job_fill(smooth_job, packed_fb, line);
+        }
+        if (smooth_job != NULL)
+        {
+            bufptr = (const uint32_t*)((uintptr_t)smooth_job | sub_row);
+        }
+    }
 
     queue_add_blocking_u32(&dvi0.q_colour_valid, &bufptr);
     
@@ -544,43 +1241,23 @@ static void __no_inline_not_in_flash_func(core1_scanline_callback)(uint scanline
     ;
 }
 
-// Initialize frame blending lookup tables for ultra-fast processing
-// Called once at startup to precompute all 256×256 byte combinations
-// This implements the exact logic from old_code.c:
-//   Blend: new_value == 0 ? new_value|*pixel_old : new_value
-//   Store: new_value > 0 ? 2 : 0  (brightens ghosts by storing gray)
-// Used by BOTH 640x480 and 800x600 modes
-static void init_frame_blending_luts(void)
-{
-    // Build the store_lut first (what to save for next frame's ghost)
-    // This implements: *pixel_old++ = new_value > 0 ? 2 : 0;
-    // For each byte, convert: non-white pixels → gray (2), white → white (0)
-    // The "2" (gray) value creates the "brightened" ghost effect
-    for (int curr = 0; curr < 256; curr++) {
-        uint8_t result = 0;
-        for (int pixel = 0; pixel < 4; pixel++) {
-            int shift = (3 - pixel) * 2;
-            uint8_t p = (curr >> shift) & 0x03;
-            // Non-white (1,2,3) becomes gray (2), white (0) stays white (0)
-            // This is the "brighten up the previous frame" logic!
-            uint8_t store_p = (p > 0) ? 2 : 0;
-            result |= (store_p << shift);
-        }
-        store_lut[curr] = result;
-    }
-      // Note: blend_lut removed to save 64KB RAM (65,536 bytes)
-    // Blending is now calculated inline in the frame processing loop
-}
-
 // Palette support for both 640x480 and 800x600 modes
 static void set_game_palette(int index)
 {
     set_scheme_index(index);
     game_palette_rgb888 = (uint32_t*)get_scheme();
+    // Fill the copy core 1 isn't using and publish it once the stores are
+    // visible. Core 1 takes the pointer once per scanline; the copy it may
+    // still hold is only rewritten on the next change, a button press later.
+    scheme_tmds_t *next = (game_palette_tmds == &game_palette_ram[0]) ? &game_palette_ram[1] : &game_palette_ram[0];
+    *next = *get_scheme_tmds();
+    __dmb();
+    game_palette_tmds = next;
 
     // Set RGB888 palette pointer for 2bpp palette mode
     // Works for both 640x480 (no borders) and 800x600 (with borders)
     dvi_get_blank_settings(&dvi0)->palette_rgb888 = game_palette_rgb888;
+    update_lcd_grid();
 }
 
 static void initialize_gpio(void)
@@ -821,6 +1498,14 @@ static bool command_check(void)
             printf("Hotkey: SELECT+START\n");
             OSD_toggle();
         }
+        // SELECT + UP - toggle performance HUD
+        else if (button_was_released(BUTTON_UP))
+        {
+            result = true;
+            printf("Hotkey: SELECT+UP\n");
+            step_perf_hud(1);
+            update_osd();
+        }
     }
     else
     {
@@ -883,6 +1568,26 @@ static bool command_check(void)
                             }
                             update_osd();
                             break;
+                        case OSD_LINE_AUDIO_RATE:
+                            set_audio_rate(get_audio_rate_index() + (button == BUTTON_LEFT ? -1 : 1));
+                            update_osd();
+                            break;
+                        case OSD_LINE_AUDIO_LATENCY:
+                            set_audio_latency(get_audio_latency_index() + (button == BUTTON_LEFT ? -1 : 1));
+                            update_osd();
+                            break;
+                        case OSD_LINE_VIDEO_MODE:
+                            set_video_mode(next_video_mode_index(button == BUTTON_LEFT ? -1 : 1));
+                            update_osd();
+                            break;
+                        case OSD_LINE_LCD_EFFECT:
+                            set_lcd_effect((int)lcd_effect + (button == BUTTON_LEFT ? -1 : 1));
+                            update_osd();
+                            break;
+                        case OSD_LINE_PERF_HUD:
+                            step_perf_hud(button == BUTTON_LEFT ? -1 : 1);
+                            update_osd();
+                            break;
                         case OSD_LINE_RESET_DEVICE:
                             if (button == BUTTON_A)
                             {
@@ -939,10 +1644,24 @@ static void save_settings(void)
     result = EEPROM_write(SAVE_INDEX_SCHEME, get_scheme_index());
     if (result == EEPROM_SUCCESS)
     {
-        // We have to disable DVI to safely commit EEPROM changes
-        dvi_serialiser_enable(&dvi0.ser_cfg, false);
+        result = EEPROM_write(SAVE_INDEX_AUDIO_RATE, get_audio_rate_index());
+    }
+    if (result == EEPROM_SUCCESS)
+    {
+        result = EEPROM_write(SAVE_INDEX_AUDIO_LATENCY, get_audio_latency_index());
+    }
+    if (result == EEPROM_SUCCESS)
+    {
+        result = EEPROM_write(SAVE_INDEX_VIDEO_MODE, get_video_mode_index());
+    }
+    if (result == EEPROM_SUCCESS)
+    {
+        result = EEPROM_write(SAVE_INDEX_LCD_EFFECT, (uint8_t)lcd_effect);
+    }
+    if (result == EEPROM_SUCCESS)
+    {
+        // Video keeps running through the commit (see settings_flash_hook())
         result = EEPROM_commit();
-        dvi_serialiser_enable(&dvi0.ser_cfg, true);
 
         if (result == EEPROM_SUCCESS)
         {
@@ -959,31 +1678,109 @@ static void save_settings(void)
     }
 }
 
-static void reset_pico(restart_option_t restart_option)
+#if !PICO_COPY_TO_RAM
+// Waits for a vertical blanking interval with room for a page program and
+// parks core1 in it. Returns false if no window turned up in time.
+static bool settings_flash_window_begin(void)
 {
-    if (restart_option == RESTART_NORMAL)
-    {
-        // Reset the Pico
-        printf("Resetting Pico...\n");
-        watchdog_reboot(0, 0, 0);
-    }
-    else
-    {
-        // Reset into USB boot mode
-        printf("Resetting Pico into USB boot mode...\n");
-        reset_usb_boot(0, DISABLE_MASK_NONE);
-    }
+    const struct dvi_timing *t = dvi0.timing;
+    const uint h_total = t->h_front_porch + t->h_sync_width + t->h_back_porch + t->h_active_pixels;
+    const uint line_ns = (uint)((uint64_t)h_total * 10000000u / t->bit_clk_khz);
+    const uint lines_needed = (FLASH_PROGRAM_WINDOW_US * 1000u + line_ns - 1) / line_ns + 1;
 
-    while (1)
+    const uint32_t start_us = time_us_32();
+    while (time_us_32() - start_us < FLASH_WINDOW_TIMEOUT_US)
     {
-        tight_loop_contents();
-    }
-}
+        // Only start at the top of a blanking interval long enough for it
+        if (dvi_vblank_lines_remaining(&dvi0) < lines_needed + 1)
+        {
+            continue;
+        }
+
+        core1_park_request = true;
+        while (!core1_parked && dvi_vblank_lines_remaining(&dvi0) >= lines_needed)
+        {
+            tight_loop_contents();
+        }
+        if (core1_parked && dvi_vblank_lines_remaining(&dvi0) >= lines_needed)
+        {
+            return true;
+        }
+
+        // Core1 was busy for too long; try again next frame
+        core1_park_request = false;
+        while (core1_parked)
+        {
+            tight_loop_contents();
+        }
+    }
+    return false;
+}
+
+// Runs around each settings flash operation, see eeprom.h
+static void settings_flash_hook(bool begin, bool erase)
+{
+    if (begin)
+    {
+        flash_paused_video = erase || flash_program_slow || !settings_flash_window_begin();
+        if (flash_paused_video)
+        {
+            // Stop DVI and hold core1 in RAM for the whole operation
+            dvi_serialiser_enable(&dvi0.ser_cfg, false);
+            multicore_lockout_start_blocking();
+        }
+        flash_program_start_us = time_us_32();
+    }
+    else if (flash_paused_video)
+    {
+        multicore_lockout_end_blocking();
+        dvi_serialiser_enable(&dvi0.ser_cfg, true);
+    }
+    else
+    {
+        const uint32_t program_us = time_us_32() - flash_program_start_us;
+        core1_park_request = false;
+        while (core1_parked)
+        {
+            tight_loop_contents();
+        }
+
+        if (program_us > FLASH_PROGRAM_WINDOW_US)
+        {
+            // Slow flash part, or one wearing out: don't bet the next save
+            // on the blanking interval being long enough
+            flash_program_slow = true;
+            printf("Flash program took %lu us, pausing video for later saves\n", (unsigned long)program_us);
+        }
+    }
+}
+#endif
+
+static void reset_pico(restart_option_t restart_option)
+{
+    if (restart_option == RESTART_NORMAL)
+    {
+        // Reset the Pico
+        printf("Resetting Pico...\n");
+        watchdog_reboot(0, 0, 0);
+    }
+    else
+    {
+        // Reset into USB boot mode
+        printf("Resetting Pico into USB boot mode...\n");
+        reset_usb_boot(0, DISABLE_MASK_NONE);
+    }
+
+    while (1)
+    {
+        tight_loop_contents();
+    }
+}
 
 
 static void load_settings(void)
 {
-    boot_checkpoint("Loading settings...\n");
+    boot_checkpoint("Loading settings");
     uint8_t scheme = (uint8_t)SCHEME_SGB_4H;
     if (EEPROM_read(SAVE_INDEX_SCHEME, &scheme) == EEPROM_SUCCESS)
     {
@@ -995,6 +1792,36 @@ static void load_settings(void)
     }
     set_game_palette((int)scheme);
 
+    // Applied by the audio setup in main(), nothing is running yet
+    uint8_t rate_index;
+    if (EEPROM_read(SAVE_INDEX_AUDIO_RATE, &rate_index) == EEPROM_SUCCESS && rate_index < AUDIO_RATE_COUNT)
+    {
+        rate = audio_rates[rate_index];
+        printf("Loaded audio rate from EEPROM: %d Hz\n", rate);
+    }
+    uint8_t latency_index;
+    if (EEPROM_read(SAVE_INDEX_AUDIO_LATENCY, &latency_index) == EEPROM_SUCCESS && latency_index < AUDIO_LATENCY_COUNT)
+    {
+        audio_latency_ms = audio_latencies_ms[latency_index];
+        printf("Loaded audio latency from EEPROM: %d ms\n", audio_latency_ms);
+    }
+
+    // Applied by main() before DVI is set up
+    uint8_t mode_index;
+    if (EEPROM_read(SAVE_INDEX_VIDEO_MODE, &mode_index) == EEPROM_SUCCESS && mode_index < RESOLUTION_MODE_COUNT &&
+        video_mode_offered(&video_modes[mode_index]))
+    {
+        video_mode = &video_modes[mode_index];
+        printf("Loaded video mode from EEPROM: %s\n", video_mode->name);
+    }
+    // The gap line is built once DVI is up (update_lcd_grid())
+    uint8_t effect_index;
+    if (EEPROM_read(SAVE_INDEX_LCD_EFFECT, &effect_index) == EEPROM_SUCCESS && effect_index < LCD_EFFECT_COUNT)
+    {
+        lcd_effect = (lcd_effect_t)effect_index;
+        printf("Loaded LCD effect from EEPROM: %s\n", lcd_effect_names[lcd_effect]);
+    }
+
     boot_checkpoint("Settings loaded");
 
     // set_scheme_index((int)EEPROM_read(SAVE_INDEX_SCHEME));
@@ -1007,43 +1834,50 @@ static void boot_checkpoint(const char *label)
         return;
     }
 
-    //printf("[BOOT] %s\n", label);
-    uart_puts(uart1, "[BOOT] ");
+    // Time since reset; the timer starts counting with the boot ROM
+    const uint32_t now_us = time_us_32();
+    if (boot_checkpoint_count < BOOT_CHECKPOINT_MAX)
+    {
+        boot_checkpoint_labels[boot_checkpoint_count] = label;
+        boot_checkpoint_us[boot_checkpoint_count] = now_us;
+        boot_checkpoint_count++;
+    }
+
+    char stamp[24];
+    snprintf(stamp, sizeof(stamp), "[BOOT %5lu.%03lu ms] ", (unsigned long)(now_us / 1000), (unsigned long)(now_us % 1000));
+    uart_puts(uart1, stamp);
     uart_puts(uart1, label);
     uart_puts(uart1, "\n");
 }
 
-#if ENABLE_AUDIO
-// static void __not_in_flash_func(on_analog_samples_ready)(void)
-static void on_analog_samples_ready(void)
+// One line with the time spent getting to each checkpoint from the last
+static void boot_summary(void)
 {
-    
-    // ADC has filled the write buffer with fresh samples
-    // Read them into the current write buffer
-    int samples_read = analog_microphone_read((int16_t*)adc_write_buffer, ADC_CHUNK_SIZE);
+    char text[32];
+    uint32_t last_us = 0;
+    uart_puts(uart1, "[BOOT] summary:");
+    for (uint i = 0; i < boot_checkpoint_count; i++)
+    {
+        const uint32_t phase_us = boot_checkpoint_us[i] - last_us;
+        last_us = boot_checkpoint_us[i];
+        snprintf(text, sizeof(text), " %lu.%lu", (unsigned long)(phase_us / 1000), (unsigned long)(phase_us % 1000 / 100));
+        uart_puts(uart1, text);
+        uart_puts(uart1, " ms ");
+        uart_puts(uart1, boot_checkpoint_labels[i]);
+        uart_puts(uart1, ",");
+    }
+    snprintf(text, sizeof(text), " total %lu ms", (unsigned long)(last_us / 1000));
+    uart_puts(uart1, text);
+    snprintf(text, sizeof(text), ", %lu ms waiting\n", (unsigned long)(boot_delay_us / 1000));
+    uart_puts(uart1, text);
+}
 
-    #ifndef AUDIO_DEBUG
-    (void)samples_read;
-    #endif
-    
-    // Copy the just-read samples to the fixed audio buffer.
-    memcpy(sample_buffer_for_audio, (void*)adc_write_buffer, ADC_CHUNK_SIZE * sizeof(int16_t));
-    
-    // Atomically swap buffers - get ready for next ADC capture
-    volatile int16_t* temp = adc_write_buffer;
-    adc_write_buffer = adc_read_buffer;
-    adc_read_buffer = temp;
-    
-    // Debug output every 1000 callbacks (enable by defining AUDIO_DEBUG)
-    #ifdef AUDIO_DEBUG
-    static uint32_t callback_count = 0;
-    if (++callback_count % 1000 == 0) {
-        printf("ADC callback #%lu: read %d samples, sample[0]=%d, sample_buffer_for_audio[32]=%d\n",
-               callback_count, samples_read, sample_buffer_for_audio[0], sample_buffer_for_audio[32]);
-    }
-    #endif
+// A deliberate boot wait, counted separately by boot_summary()
+static void __unused boot_delay_ms(uint32_t ms)
+{
+    sleep_ms(ms);
+    boot_delay_us += ms * 1000u;
 }
-#endif
 
 static void __no_inline_not_in_flash_func(gpio_callback)(uint gpio, uint32_t events)
 {
@@ -1051,6 +1885,7 @@ static void __no_inline_not_in_flash_func(gpio_callback)(uint gpio, uint32_t eve
     // Handle VSYNC IRQ for video capture (GPIO 4) - ONLY IN IRQ MODE
     if (gpio == VSYNC_PIN) 
     {
+        vsync_count++;
         video_capture_handle_vsync_irq(events);
         return;  // VSYNC handled, done
     }
@@ -1128,6 +1963,24 @@ static void update_osd(void)
 
     sprintf(buff, "FRAME BLEND:%9s", frame_blending_enabled ? "ON" : "OFF");
     OSD_set_line_text(OSD_LINE_FRAME_BLENDING, buff);
+
+    sprintf(buff, "AUDIO RATE:%7d HZ", rate);
+    OSD_set_line_text(OSD_LINE_AUDIO_RATE, buff);
+
+    sprintf(buff, "AUDIO LATENCY:%5d MS", audio_latency_ms);
+    OSD_set_line_text(OSD_LINE_AUDIO_LATENCY, buff);
+
+    sprintf(buff, "VIDEO MODE:%10s", video_mode->name);
+    OSD_set_line_text(OSD_LINE_VIDEO_MODE, buff);
+
+    sprintf(buff, "LCD EFFECT:%10s", lcd_effect_names[lcd_effect]);
+    OSD_set_line_text(OSD_LINE_LCD_EFFECT, buff);
+
+    if (perf_hud_page == 0)
+        sprintf(buff, "PERF HUD:%12s", "OFF");
+    else
+        sprintf(buff, "PERF HUD:%8s %u/%u", "PAGE", perf_hud_page, PERF_HUD_PAGES);
+    OSD_set_line_text(OSD_LINE_PERF_HUD, buff);
     
     sprintf(buff, "RESET DEVICE:%8s", restart_option == RESTART_MASS_STORAGE ? "USB" : "NORM");
     OSD_set_line_text(OSD_LINE_RESET_DEVICE, buff);
@@ -1137,6 +1990,226 @@ static void update_osd(void)
     OSD_set_line_text(OSD_LINE_EXIT, "EXIT");
 }
 
+// Sample the pipeline counters once per second, and refresh the HUD page on
+// screen from them. The counters are cheap to maintain, and the OSD only
+// rebuilds its plan when a line changes. Sampling carries on with the HUD off
+// so that step_perf_hud() can report the OSD compose cost either way.
+static void update_perf_hud(void)
+{
+#if PICO_RP2040
+    // Contested accesses per SRAM bank, to compare the striped layout with
+    // DMG_SRAM_BANKS. The bus fabric has exactly four counters.
+    static const bus_ctrl_perf_counter_t sram_contested[4] = {
+        arbiter_sram0_perf_event_access_contested,
+        arbiter_sram1_perf_event_access_contested,
+        arbiter_sram2_perf_event_access_contested,
+        arbiter_sram3_perf_event_access_contested,
+    };
+#endif
+    static absolute_time_t next_update = {0};
+    static uint32_t last_us = 0;
+    static uint32_t last_vsync = 0;
+    static uint32_t last_captured = 0;
+    static uint32_t last_presented = 0;
+    static uint32_t last_late = 0;
+    static uint32_t last_late_frames = 0;
+    static uint32_t last_repeated = 0;
+    static uint32_t last_core0_busy = 0;
+    static uint32_t last_core1_busy = 0;
+    static uint32_t last_irq_cycles = 0;
+    static uint32_t last_irq_count = 0;
+    static uint32_t last_compose = 0;
+    static uint last_page = 0;
+
+    // A new page is drawn straight away, over a shorter window
+    const bool page_changed = perf_hud_page != last_page;
+    last_page = perf_hud_page;
+    if (!time_reached(next_update) && !page_changed)
+    {
+        return;
+    }
+    next_update = make_timeout_time_ms(1000);
+
+#if PICO_RP2040
+    // 24-bit saturating counters, cleared by any write
+    uint32_t contested[4];
+    for (uint i = 0; i < 4; i++)
+    {
+        contested[i] = bus_ctrl_hw->counter[i].value;
+        bus_ctrl_hw->counter[i].value = 0;
+        bus_ctrl_hw->counter[i].sel = sram_contested[i];
+    }
+#endif
+
+    const uint32_t now_us = time_us_32();
+    const uint32_t elapsed_us = now_us - last_us;
+    const uint32_t vsyncs = vsync_count;
+    const uint32_t captured = frames_captured;
+    const uint32_t presented = dvi0.dvi_frame_count;
+    const uint32_t core0_busy = core0_busy_us;
+    const uint32_t core1_busy = core1_busy_us;
+    const uint32_t compose = osd_compose_cycles;
+    const uint32_t encode_max_us = core1_encode_max_us;
+    core1_encode_max_us = 0;
+#if DVI_COLLECT_STATS
+    const uint32_t late = dvi0.late_scanline_total;
+    const uint32_t late_frames = dvi0.late_frame_total;
+    const uint32_t repeated = dvi0.repeated_line_total;
+    const uint32_t irq_max = dvi0.irq_cycles_max;
+    dvi0.irq_cycles_max = 0;
+    const uint32_t irq_cycles = dvi0.irq_cycles_total;
+    const uint32_t irq_count = dvi0.irq_count;
+    const uint32_t island_max = dvi0.data_island_cycles_max;
+    dvi0.data_island_cycles_max = 0;
+    const uint32_t list_max = dvi0.list_cycles_max;
+    dvi0.list_cycles_max = 0;
+    const uint32_t lane_waits = dvi0.lane_wait_total;
+#else
+    const uint32_t late = 0;
+    const uint32_t late_frames = 0;
+    const uint32_t repeated = 0;
+    const uint32_t irq_max = 0;
+    const uint32_t irq_cycles = 0;
+    const uint32_t irq_count = 0;
+    const uint32_t island_max = 0;
+    const uint32_t list_max = 0;
+    const uint32_t lane_waits = 0;
+#endif
+
+    if (last_us != 0 && elapsed_us > 0)
+    {
+        // OSD compose cycles per presented frame, and as a share of core1's
+        // cycles over the second
+        const uint32_t frames = presented - last_presented;
+        const uint32_t clk_mhz = clock_get_hz(clk_sys) / 1000000u;
+        osd_compose_per_frame = frames ? (compose - last_compose) / frames : 0;
+        osd_compose_pct_x100 = (uint32_t)((uint64_t)(compose - last_compose) * 10000u / ((uint64_t)elapsed_us * clk_mhz));
+    }
+
+    if (perf_hud_page != 0 && last_us != 0 && elapsed_us > 0)
+    {
+        // Per-second rates, rounded to the nearest integer
+        const uint32_t half = elapsed_us / 2;
+        const uint32_t new_captured = captured - last_captured;
+        const uint32_t new_vsyncs = vsyncs - last_vsync;
+        const uint32_t dropped = (new_vsyncs > new_captured) ? (new_vsyncs - new_captured) : 0;
+        const uint32_t cap_fps = (uint32_t)(((uint64_t)new_captured * 1000000u + half) / elapsed_us);
+        const uint32_t out_fps = (uint32_t)(((uint64_t)(presented - last_presented) * 1000000u + half) / elapsed_us);
+        const uint32_t drop_fps = (uint32_t)(((uint64_t)dropped * 1000000u + half) / elapsed_us);
+        const uint32_t busy0 = core0_busy - last_core0_busy;
+        const uint32_t busy1 = core1_busy - last_core1_busy;
+        const uint32_t idle0 = (busy0 < elapsed_us) ? 100u - (uint32_t)((uint64_t)busy0 * 100u / elapsed_us) : 0;
+        const uint32_t idle1 = (busy1 < elapsed_us) ? 100u - (uint32_t)((uint64_t)busy1 * 100u / elapsed_us) : 0;
+
+        char buff[32];
+        switch (perf_hud_page)
+        {
+        case 1:
+        {
+            // The essentials, kept narrow: frame rates (captured/presented/
+            // dropped), idle time per core, late scanlines and audio ring
+            // fill, worst DMA IRQ in cycles and shared DMA IRQs that found
+            // more than one channel pending, both IRQs together
+            uint32_t dma_multi0 = 0;
+            uint32_t dma_multi1 = 0;
+            SHARED_DMA_GetStats(&dma_multi0, &dma_multi1);
+#if ENABLE_AUDIO
+            const uint32_t ring_fill = get_read_size(&dvi0.audio_ring, true);
+#else
+            const uint32_t ring_fill = 0;
+#endif
+            snprintf(buff, sizeof(buff), "FPS %u/%u/%u", (unsigned)cap_fps, (unsigned)out_fps, (unsigned)drop_fps);
+            OSD_set_hud_line_text(0, buff);
+            snprintf(buff, sizeof(buff), "IDLE %u/%u%%", (unsigned)idle0, (unsigned)idle1);
+            OSD_set_hud_line_text(1, buff);
+            snprintf(buff, sizeof(buff), "LT %u RING %u", (unsigned)(late - last_late), (unsigned)ring_fill);
+            OSD_set_hud_line_text(2, buff);
+            snprintf(buff, sizeof(buff), "IRQ %u MP %u", (unsigned)irq_max, (unsigned)(dma_multi0 + dma_multi1));
+            OSD_set_hud_line_text(3, buff);
+            break;
+        }
+        case 2:
+        {
+            // Worst single encode against the mode's per-buffer budget
+            const uint32_t budget_us = scanline_budget_us(video_mode);
+            const uint32_t headroom = (encode_max_us < budget_us) ? 100u - encode_max_us * 100u / budget_us : 0;
+            snprintf(buff, sizeof(buff), "ENC %u/%uUS %u%%", (unsigned)encode_max_us, (unsigned)budget_us, (unsigned)headroom);
+            OSD_set_hud_line_text(0, buff);
+            // OSD compose, this HUD included, in thousands of cycles per frame
+            snprintf(buff, sizeof(buff), "OSD %uK %u.%02u%%", (unsigned)((osd_compose_per_frame + 500) / 1000),
+                     (unsigned)(osd_compose_pct_x100 / 100), (unsigned)(osd_compose_pct_x100 % 100));
+            OSD_set_hud_line_text(1, buff);
+#if ENABLE_AUDIO
+            snprintf(buff, sizeof(buff), "AUD %uUS %+dPPM", (unsigned)emu_audio_get_tick_time_max_us(),
+                     (int)emu_audio_get_resample_ppm());
+            OSD_set_hud_line_text(2, buff);
+            const uint32_t latency_us = emu_audio_get_latency_us();
+            snprintf(buff, sizeof(buff), "LAT %u.%u/%uMS", (unsigned)(latency_us / 1000),
+                     (unsigned)(latency_us % 1000 / 100), (unsigned)audio_latency_ms);
+            OSD_set_hud_line_text(3, buff);
+#else
+            OSD_set_hud_line_text(2, "");
+            OSD_set_hud_line_text(3, "");
+#endif
+            break;
+        }
+        default:
+        {
+            // Late scanlines are covered by repeating the line above
+            snprintf(buff, sizeof(buff), "REP %u FR %u", (unsigned)(repeated - last_repeated),
+                     (unsigned)(late_frames - last_late_frames));
+            OSD_set_hud_line_text(0, buff);
+            // Worst data island encode, which runs outside the scanline IRQ,
+            // and the average DMA IRQ
+            const uint32_t irqs = irq_count - last_irq_count;
+            const uint32_t irq_avg = irqs ? (irq_cycles - last_irq_cycles) / irqs : 0;
+            snprintf(buff, sizeof(buff), "DI %u IRQ %u", (unsigned)island_max, (unsigned)irq_avg);
+            OSD_set_hud_line_text(1, buff);
+            // Repointing the DMA lists inside the IRQ; WAIT should stay at 0
+            snprintf(buff, sizeof(buff), "LIST %u WAIT %u", (unsigned)list_max, (unsigned)lane_waits);
+            OSD_set_hud_line_text(2, buff);
+#if PICO_RP2040
+            // Thousands per second, clamped to fit the line
+            snprintf(buff, sizeof(buff), "SRAM %u %u %u %uK", (unsigned)MIN(contested[0] / 1000, 999u),
+                     (unsigned)MIN(contested[1] / 1000, 999u), (unsigned)MIN(contested[2] / 1000, 999u),
+                     (unsigned)MIN(contested[3] / 1000, 999u));
+            OSD_set_hud_line_text(3, buff);
+#else
+            OSD_set_hud_line_text(3, "");
+#endif
+            break;
+        }
+        }
+    }
+
+    last_us = now_us;
+    last_vsync = vsyncs;
+    last_captured = captured;
+    last_presented = presented;
+    last_late = late;
+    last_late_frames = late_frames;
+    last_repeated = repeated;
+    last_core0_busy = core0_busy;
+    last_core1_busy = core1_busy;
+    last_irq_cycles = irq_cycles;
+    last_irq_count = irq_count;
+    last_compose = compose;
+}
+
+// Off, then each HUD page in turn. The OSD compose cost of the second before
+// the change goes to the console, so switching the HUD on and off gives both
+// figures (DVI_COLLECT_STATS only).
+static void step_perf_hud(int step)
+{
+#if DVI_COLLECT_STATS
+    printf("OSD compose, HUD %s: %lu cycles/frame, %lu.%02lu%% of core1\n",
+           perf_hud_page ? "on" : "off", (unsigned long)osd_compose_per_frame,
+           (unsigned long)(osd_compose_pct_x100 / 100), (unsigned long)(osd_compose_pct_x100 % 100));
+#endif
+    perf_hud_page = (perf_hud_page + PERF_HUD_PAGES + 1 + step) % (PERF_HUD_PAGES + 1);
+    OSD_set_hud_enabled(perf_hud_page != 0);
+}
+
 static void change_audio_gain(float delta)
 {
     float gain = emu_audio_get_gain();
@@ -1150,14 +2223,308 @@ static void change_audio_gain(float delta)
     printf("Audio gain set to %.2f\n", gain);
 }
 
+// Geometry and encoder for a mode. DVI must not be running.
+static void apply_video_mode(const video_mode_t *mode)
+{
+    video_mode = mode;
+    scanline_count = mode->scanline_count;
+    smooth_shift = mode->smooth_shift;
+    game_rows = DMG_PIXELS_Y << smooth_shift;
+    // Centre vertically, adjusting for the two pre-pushed lines
+    vertical_offset = (scanline_count + (scanline_count - game_rows) / 2 - 2) % scanline_count;
+    scanline_encoder = mode->encoder;
+    smooth_job = NULL;
+    scale4x_cache_reset(&scale4x_cache);
+    build_game_spans(mode->game_width);
+    encode_scanline_idx = 0;
+}
+
+// Walk the output pixels with a 16.16 step back into the Game Boy line,
+// sampling at pixel centres. A word whose two pixels land on different Game
+// Boy pixels is a split word, so widths need only be even, not a multiple of
+// 2 * DMG_PIXELS_X.
+static void build_game_spans(uint game_width)
+{
+    const uint32_t step = ((uint32_t)DMG_PIXELS_X << 16) / game_width;
+
+    memset(game_spans, 0, sizeof(game_spans));
+    for (uint x = 0; x < game_width; x += 2)
+    {
+        const uint left = (x * step + step / 2) >> 16;
+        const uint right = ((x + 1) * step + step / 2) >> 16;
+        if (left == right)
+        {
+            game_spans[left]++;
+        }
+        else
+        {
+            game_spans[left] |= GAME_SPAN_SPLIT;
+        }
+    }
+    game_span_words = game_width / DVI_SYMBOLS_PER_WORD;
+}
+
+// Core voltage and system clock, which is also the TMDS bit clock. The
+// voltage goes up before speeding up and only comes down after slowing down.
+static void set_video_clocks(const video_mode_t *mode, const video_mode_t *previous)
+{
+    // The flash divider follows the same rule: slow the flash before
+    // speeding up, speed it up only after slowing down
+    const uint flash_div = flash_clkdiv_for_khz(mode->timing->bit_clk_khz);
+    const uint previous_flash_div = previous ? flash_clkdiv_for_khz(previous->timing->bit_clk_khz) : FLASH_BOOT_CLKDIV;
+
+    if (flash_div > previous_flash_div)
+    {
+        set_flash_clkdiv(flash_div);
+    }
+    if (previous == NULL || mode->vreg_voltage > previous->vreg_voltage)
+    {
+        vreg_set_voltage(mode->vreg_voltage);
+        sleep_ms(10);
+    }
+    set_sys_clock_khz(mode->timing->bit_clk_khz, true);
+    if (previous != NULL && mode->vreg_voltage < previous->vreg_voltage)
+    {
+        vreg_set_voltage(mode->vreg_voltage);
+    }
+    if (flash_div < previous_flash_div)
+    {
+        set_flash_clkdiv(flash_div);
+    }
+}
+
+// Smallest divider that keeps the flash at or under FLASH_SCK_MAX_KHZ, never
+// below the boot divider. The RP2040 SSI only divides by even numbers.
+static uint flash_clkdiv_for_khz(uint32_t sys_khz)
+{
+#if PICO_RP2040
+    const uint step = 2;
+#else
+    const uint step = 1;
+#endif
+    uint div = FLASH_BOOT_CLKDIV;
+    while (sys_khz / div > FLASH_SCK_MAX_KHZ)
+    {
+        div += step;
+    }
+    return div;
+}
+
+// Runs from RAM with interrupts off; the caller makes sure core1 and DMA are
+// not reading flash either (DVI stopped, core1 waiting in RAM)
+static void __no_inline_not_in_flash_func(set_flash_clkdiv)(uint div)
+{
+    uint32_t ints = save_and_disable_interrupts();
+#if PICO_RP2040
+    ssi_hw->ssienr = 0;
+    ssi_hw->baudr = div;
+    ssi_hw->ssienr = 1;
+#else
+    hw_write_masked(&qmi_hw->m[0].timing, div << QMI_M0_TIMING_CLKDIV_LSB, QMI_M0_TIMING_CLKDIV_BITS);
+#endif
+    restore_interrupts(ints);
+}
+
+// Time core1 has to encode one scanline buffer in a mode: the line period
+// times the fewest output lines any buffer is shown for
+static uint32_t scanline_budget_us(const video_mode_t *mode)
+{
+    const struct dvi_timing *t = mode->timing;
+    const uint32_t line_pixels = t->h_front_porch + t->h_sync_width + t->h_back_porch + t->h_active_pixels;
+    const uint32_t min_repeat = t->v_active_lines / mode->scanline_count;
+    // One pixel is 10 bit clocks
+    return (uint32_t)((uint64_t)line_pixels * 10u * 1000u * min_repeat / t->bit_clk_khz);
+}
+
+static int get_video_mode_index(void)
+{
+    return (int)(video_mode - video_modes);
+}
+
+// The next mode the OSD offers, stepping forwards or backwards from the current one
+static int next_video_mode_index(int step)
+{
+    int index = get_video_mode_index();
+    do
+    {
+        index = (index + step + RESOLUTION_MODE_COUNT) % RESOLUTION_MODE_COUNT;
+    } while (!video_mode_offered(&video_modes[index]));
+    return index;
+}
+
+// Stop DVI, retune clocks, rebuild the DVI state and restart in another mode.
+// The sink loses sync for as long as it takes to lock onto the new mode.
+static void set_video_mode(int index)
+{
+    index = (index + RESOLUTION_MODE_COUNT) % RESOLUTION_MODE_COUNT;
+    const video_mode_t *previous = video_mode;
+    const video_mode_t *mode = &video_modes[index];
+    if (mode == previous)
+        return;
+
+    video_stop_request = true;
+    while (!core1_video_stopped)
+    {
+        tight_loop_contents();
+    }
+
+    set_video_clocks(mode, previous);
+    // clk_peri follows clk_sys, so anything with a baud rate needs retiming
+    uart_set_baudrate(uart1, PICO_DEFAULT_UART_BAUD_RATE);
+    i2c_set_baudrate(i2cHandle, 400 * 1000);
+
+    apply_video_mode(mode);
+    dvi_set_timing(&dvi0, mode->timing, scanline_count);
+#if ENABLE_AUDIO
+    // N/CTS depend on the pixel clock
+    dvi_set_audio_rate(&dvi0, rate);
+#endif
+    OSD_set_frame_size(mode->timing->h_active_pixels / DVI_SYMBOLS_PER_WORD, scanline_count, mode->timing->v_active_lines);
+    // dvi_set_timing() dropped the gap line; it is rebuilt for the new width
+    lcd_grid_enabled = false;
+    update_lcd_grid();
+
+    // Restart the scanline pipeline the same way main() primes it
+    uint32_t *bufptr;
+    while (queue_try_remove_u32(&dvi0.q_colour_valid, &bufptr))
+        ;
+    while (queue_try_remove_u32(&dvi0.q_colour_free, &bufptr))
+        ;
+    bufptr = (uint32_t*)line_buffer;
+    queue_add_blocking_u32(&dvi0.q_colour_valid, &bufptr);
+    queue_add_blocking_u32(&dvi0.q_colour_valid, &bufptr);
+
+    video_stop_request = false;
+    while (core1_video_stopped)
+    {
+        tight_loop_contents();
+    }
+    printf("Video mode set to %s (%u MHz, %u us per scanline buffer)\n", mode->name,
+           (unsigned)(mode->timing->bit_clk_khz / 1000), (unsigned)scanline_budget_us(mode));
+}
+
+static void set_lcd_effect(int index)
+{
+    lcd_effect = (lcd_effect_t)((index + LCD_EFFECT_COUNT) % LCD_EFFECT_COUNT);
+    dvi_set_scanline(&dvi0, lcd_effect == LCD_EFFECT_SCANLINES);
+    update_lcd_grid();
+    printf("LCD effect: %s\n", lcd_effect_names[lcd_effect]);
+}
+
+// Turn the grid on or off to follow the effect and OSD state, (re)encoding the
+// gap line when the timing or palette has changed. Cheap when nothing has.
+static void update_lcd_grid(void)
+{
+    const bool want = lcd_effect == LCD_EFFECT_GRID && !OSD_is_enabled() && !OSD_is_hud_enabled();
+    if (!want)
+    {
+        if (lcd_grid_enabled)
+        {
+            lcd_grid_enabled = false;
+            dvi_set_gap_line(&dvi0, NULL, 0, 0);
+        }
+        return;
+    }
+
+    const scheme_tmds_t *palette = game_palette_tmds;
+    if (lcd_grid_line_timing != video_mode->timing)
+    {
+        // Not shown (dvi_set_timing() or never set), safe to reallocate
+        free(lcd_grid_line);
+        lcd_grid_line = malloc(3 * video_mode->timing->h_active_pixels / DVI_SYMBOLS_PER_WORD * sizeof(uint32_t));
+        if (lcd_grid_line == NULL)
+        {
+            printf("LCD grid: no memory for the gap line\n");
+            lcd_grid_line_timing = NULL;
+            lcd_effect = LCD_EFFECT_OFF;
+            return;
+        }
+        lcd_grid_line_timing = video_mode->timing;
+        lcd_grid_line_scheme = -1;
+    }
+    if (lcd_grid_line_scheme != get_scheme_index())
+    {
+        // Rewritten in place if already shown: at worst one line of the old colour
+        const uint words = video_mode->timing->h_active_pixels / DVI_SYMBOLS_PER_WORD;
+        const uint game_words = MIN(video_mode->game_width / DVI_SYMBOLS_PER_WORD, words);
+        const uint border_words = (words - game_words) / 2;
+        const uint32_t grid[3] = {palette->blue_grid, palette->green_grid, palette->red_grid};
+        for (uint lane = 0; lane < 3; lane++)
+        {
+            for (uint i = 0; i < words; i++)
+            {
+                const bool in_game = i >= border_words && i < border_words + game_words;
+                lcd_grid_line[lane * words + i] = in_game ? grid[lane] : tmds_table[0];
+            }
+        }
+        lcd_grid_line_scheme = get_scheme_index();
+    }
+    if (!lcd_grid_enabled)
+    {
+        dvi_set_gap_line(&dvi0, lcd_grid_line, (scanline_count - game_rows) / 2, game_rows);
+        lcd_grid_enabled = true;
+    }
+}
+
+static int get_audio_rate_index(void)
+{
+    for (int i = 0; i < (int)AUDIO_RATE_COUNT; i++)
+    {
+        if (audio_rates[i] == rate)
+            return i;
+    }
+    return 0;
+}
+
+static void set_audio_rate(int index)
+{
+    index = (index + AUDIO_RATE_COUNT) % AUDIO_RATE_COUNT;
+    if (audio_rates[index] == rate)
+        return;
+
+    rate = audio_rates[index];
+#if ENABLE_AUDIO
+    // Retime the ADC first; the resampler absorbs the chunk in flight
+    analog_microphone_set_sample_rate(rate * ADC_OVERSAMPLE);
+    emu_audio_set_sample_rate(rate);
+    bool exact = dvi_set_audio_rate(&dvi0, rate);
+    printf("Audio rate set to %d Hz%s\n", rate, exact ? "" : " (inexact CTS)");
+#endif
+}
+
+static int get_audio_latency_index(void)
+{
+    for (int i = 0; i < (int)AUDIO_LATENCY_COUNT; i++)
+    {
+        if (audio_latencies_ms[i] == audio_latency_ms)
+            return i;
+    }
+    return 0;
+}
+
+static void set_audio_latency(int index)
+{
+    // Clamp rather than wrap, so stepping past either end does not jump
+    // straight to the opposite extreme
+    if (index < 0)
+        index = 0;
+    if (index >= (int)AUDIO_LATENCY_COUNT)
+        index = AUDIO_LATENCY_COUNT - 1;
+
+    audio_latency_ms = audio_latencies_ms[index];
+#if ENABLE_AUDIO
+    // The audio path drops or repeats chunks until the ring is near the new target
+    emu_audio_set_latency_target_ms(audio_latency_ms);
+    printf("Audio latency target set to %d ms (%u samples)\n", audio_latency_ms, (unsigned)emu_audio_get_ring_target_fill());
+#endif
+}
+
 //********************************************************************************
 // PUBLIC FUNCTIONS
 //********************************************************************************
 int main(void)
 {
-    vreg_set_voltage(VREG_VSEL);
-    sleep_ms(10);
-    set_sys_clock_khz(DVI_TIMING.bit_clk_khz, true);
+    set_video_clocks(video_mode, NULL);
     reset_button_states();
 
     // Initialize stdio for serial debugging
@@ -1167,121 +2534,107 @@ int main(void)
     // stdio_init_all();
     stdio_uart_init_full(uart1, PICO_DEFAULT_UART_BAUD_RATE, PICO_DEFAULT_UART_TX_PIN, PICO_DEFAULT_UART_RX_PIN);  // TX=20, RX=21
     setvbuf(stdout, NULL, _IONBF, 0);
-    sleep_ms(3000);
+#if !FAST_BOOT
+    // Give a serial terminal time to attach before anything is printed
+    boot_delay_ms(3000);
+#endif
+    boot_checkpoint("Clocks and console up");
 
-    // Initialize frame blending lookup tables (one-time computation)
-    // Both modes use packed buffers for capture, so both need LUTs
-    init_frame_blending_luts();
-    
+#if !FAST_BOOT
     // Force flush and try multiple times
     for (int i = 0; i < 5; i++) {
         printf("\n\n=== PicoDVI-DMG Starting (attempt %d) ===\n", i+1);
         stdio_flush();
-        sleep_ms(100);
+        boot_delay_ms(100);
     }
+#else
+    printf("\n=== PicoDVI-DMG Starting ===\n");
+#endif
 
     // Mario image is now pre-packed in 2bpp format (saves 17KB RAM!)
     // Simply copy the packed data directly to the display buffers
     memcpy(packed_buffer_0, mario_packed_160x144, PACKED_FRAME_SIZE);
     memcpy(packed_buffer_1, packed_buffer_0, PACKED_FRAME_SIZE);
+    memset(packed_buffer_previous, 0x00, PACKED_FRAME_SIZE);
 
     // Both modes use packed buffer directly (TMDS encoder handles palette and scaling)
     packed_display_ptr = packed_buffer_0;
     // TODO packed_render_ptr = packed_buffer_1;
 
-    // Initialize OSD overlays (disabled by default)
-    OSD_init(DMG_PIXELS_X, DMG_PIXELS_Y);
+    // Initialize OSD overlays (disabled by default), drawn at output resolution
+    // Settings pick the video mode, so they are needed before DVI is set up
+    const video_mode_t *boot_mode = video_mode;
+    load_settings();
+    if (video_mode != boot_mode)
+    {
+        set_video_clocks(video_mode, boot_mode);
+        uart_set_baudrate(uart1, PICO_DEFAULT_UART_BAUD_RATE);
+    }
+    apply_video_mode(video_mode);
+
+    OSD_init(video_mode->timing->h_active_pixels / DVI_SYMBOLS_PER_WORD, scanline_count, video_mode->timing->v_active_lines);
     OSD_clear();
     OSD_set_enabled(false);
 
-    dvi0.timing = &DVI_TIMING;
+    dvi0.timing = video_mode->timing;
     dvi0.ser_cfg = DVI_DEFAULT_SERIAL_CONFIG;
     //dvi0.scanline_callback = (dvi_callback_t*)core1_scanline_callback;
     dvi0.scanline_callback = core1_scanline_callback;
     dvi_init(&dvi0, next_striped_spin_lock_num(), next_striped_spin_lock_num());
-
-    load_settings();
+    dvi_set_scanline_count(&dvi0, scanline_count);
+    dvi_set_scanline(&dvi0, lcd_effect == LCD_EFFECT_SCANLINES);
 
     uint32_t *bufptr = (uint32_t*)line_buffer;
     queue_add_blocking_u32(&dvi0.q_colour_valid, &bufptr);
     queue_add_blocking_u32(&dvi0.q_colour_valid, &bufptr);
 
     // HDMI Audio related
-    // Support 16000, 22050, 24000, 32000, 44100, and 48000 Hz sample rates
+    // N/CTS are picked per timing so CTS is exact at the pixel clock
 #if ENABLE_AUDIO
-    int offset;
-    if (rate == 48000) {
-        offset = 2;
-    } else if (rate == 44100) {
-        offset = 1;
-    } else if (rate == 24000) {
-        offset = 5;  // 24kHz - well supported
-    } else if (rate == 22050) {
-        offset = 3;  // Half of 44.1k
-    } else if (rate == 16000) {
-        offset = 4;  // Half of 32k
-    } else {
-        offset = 0;  // Default for other rates (32000)
-    }
-    int cts = dvi0.timing->bit_clk_khz*hdmi_n[offset]/(rate/100)/128;
+    int audio_n, audio_cts;
+    bool audio_exact = dvi_audio_compute_n_cts(dvi_timing_get_pixel_clock(dvi0.timing), rate, &audio_n, &audio_cts);
+    printf("HDMI audio %d Hz: N=%d CTS=%d%s\n", rate, audio_n, audio_cts, audio_exact ? "" : " (inexact)");
     dvi_get_blank_settings(&dvi0)->top    = 0;
     dvi_get_blank_settings(&dvi0)->bottom = 0;
     dvi_audio_sample_buffer_set(&dvi0, audio_buffer, AUDIO_BUFFER_SIZE);
-    dvi_set_audio_freq(&dvi0, rate, cts, hdmi_n[offset]);
+    dvi_set_audio_freq(&dvi0, rate, audio_cts, audio_n);
     // Note: dvi_set_audio_freq() automatically calls dvi_enable_data_island()
-    
-    // Pre-fill buffer to 25% to allow for bursty DVI consumption patterns
-    increase_write_pointer(&dvi0.audio_ring, AUDIO_BUFFER_SIZE / 4);
-    printf("Audio buffer pre-filled to %d samples (25%%)\n", AUDIO_BUFFER_SIZE / 4);
 #endif
 
     // OPTIMIZED ORDER for audio + video:
-    // 1. Start audio timer (500Hz chunk processing)
+    // 1. Initialize audio processing (driven by ADC DMA completion)
     // 2. Start Core1 (DVI output starts consuming audio)
     // 3. Initialize ADC microphone
     // 4. Initialize GPIO/PIO for DMG controller
     // 5. Register VSYNC interrupt (video capture begins)
 
 #if ENABLE_AUDIO
-    if (AUDIO_ON_CORE1) {
-        emu_audio_set_manual_tick(true);
-        printf("Audio: manual tick on Core1 every %d ms\n", AUDIO_TICK_MS);
-    } else {
-        emu_audio_set_manual_tick(false);
-        printf("Starting audio timer (500Hz chunk rate)...\n");
-    }
-	emu_sndInit(false, false, &dvi0.audio_ring, sample_buffer_for_audio);
+	emu_sndInit(false, false, &dvi0.audio_ring);
+    emu_audio_set_sample_rate(rate);
     emu_audio_set_gain(2.0f);  // Boost audio volume
     emu_audio_set_lowpass(3000.0f); // try 2–4 kHz to shave hiss
+    emu_audio_set_latency_target_ms(audio_latency_ms);
     printf("Audio system initialized\n");
-    
-#endif
-
-#if ENABLE_VIDEO_CAPTURE
-
-    printf("Initializing PIO video capture...\n");
-    video_offset = pio_add_program(pio_video, &video_capture_irq_program);
-    video_capture_program_init(pio_video, video_sm, video_offset);
+    boot_checkpoint("Audio pipeline initialized");
 
-    // Video uses polled completion; pass -1 to avoid enabling any DMA IRQ
-    int video_dma_chan = video_capture_dma_init(pio_video, video_sm, -1, packed_buffer_0, PACKED_FRAME_SIZE);
-    if (video_dma_chan < 0)
-    {
-        printf("ERROR: Video capture DMA initialization failed!\n");
-        while (1) { tight_loop_contents(); }
-    }
-    // Video uses polled completion (no IRQ) to avoid contention
-    printf("  -> DMA initialized (packed format: %d bytes, polled completion)\n", PACKED_FRAME_SIZE);
-    stdio_flush();
+    // Pre-fill the ring to the latency target to allow for bursty DVI
+    // consumption patterns. The audio resampler holds it there from here on
+    increase_write_pointer(&dvi0.audio_ring, emu_audio_get_ring_target_fill());
+    printf("Audio buffer pre-filled to %u samples (%u ms)\n", (unsigned)emu_audio_get_ring_target_fill(), (unsigned)audio_latency_ms);
+    
 #endif
 
     // Always start DVI output on Core 1, regardless of audio
     printf("Starting Core 1 (DVI output)...\n");
     multicore_launch_core1(core1_main);
     printf("Core 1 running - now consuming video!\n");
+    boot_checkpoint("DVI started");
+#if !PICO_COPY_TO_RAM
+    EEPROM_set_flash_hook(settings_flash_hook);
+#endif
 
     // Wait for Core1 to arm DMA IRQ handler before starting analog mic DMA
-    if (AUDIO_ON_CORE1) {
+    if (ENABLE_AUDIO) {
         while (!dma_irq_ready_core1) {
             // Also drain FIFO token if core1 already signaled
             if (multicore_fifo_rvalid()) {
@@ -1294,6 +2647,7 @@ int main(void)
     }
 
 #if ENABLE_AUDIO
+    mic_config.sample_rate = rate * ADC_OVERSAMPLE;
     printf("Initializing analog microphone on GPIO %d at %d Hz...\n", mic_config.gpio, mic_config.sample_rate);
     if (analog_microphone_init(&mic_config) < 0) {
         printf("ERROR: analog microphone initialization failed!\n");
@@ -1301,8 +2655,11 @@ int main(void)
     }
     printf("Analog microphone initialized successfully\n");
 
-    analog_microphone_set_samples_ready_handler(on_analog_samples_ready);
+#if !AUDIO_IN_CORE1_LOOP
+    // Each completed ADC buffer is converted from the shared DMA IRQ on Core 1
+    analog_microphone_set_samples_ready_handler(emu_audio_service);
     printf("ADC callback handler registered\n");
+#endif
 
     printf("Starting analog microphone DMA capture...\n");
     if (analog_microphone_start() < 0) {
@@ -1310,16 +2667,38 @@ int main(void)
         while (1) { tight_loop_contents(); }
     }
     printf("Analog microphone started successfully - DMA should be running\n");
+    boot_checkpoint("Audio capture started");
+#endif
+
+#if ENABLE_VIDEO_CAPTURE
+
+    printf("Initializing PIO video capture...\n");
+    video_offset = pio_add_program(pio_video, &video_capture_irq_program);
+    video_capture_program_init(pio_video, video_sm, video_offset);
+
+    // Video uses polled completion; pass -1 to avoid enabling any DMA IRQ
+    int video_dma_chan = video_capture_dma_init(pio_video, video_sm, -1, packed_buffer_0, PACKED_FRAME_SIZE);
+    if (video_dma_chan < 0)
+    {
+        printf("ERROR: Video capture DMA initialization failed!\n");
+        while (1) { tight_loop_contents(); }
+    }
+    // Video uses polled completion (no IRQ) to avoid contention
+    printf("  -> DMA initialized (packed format: %d bytes, polled completion)\n", PACKED_FRAME_SIZE);
+    stdio_flush();
+    boot_checkpoint("Video capture ready");
 #endif
 
     boot_checkpoint("Initializing GPIO");
     initialize_gpio();
     boot_checkpoint("GPIO initialized");
 
+#if !FAST_BOOT
     for (int i = 0; i < 5; i++) {
         printf("\n\n=== PicoDVI-DMG_EMU Starting (attempt %d) ===\n", i + 1);
-        sleep_ms(100);
+        boot_delay_ms(100);
     }
+#endif
 
     printf("Firmware build: %s %s\n", __DATE__, __TIME__);
 
@@ -1334,6 +2713,8 @@ int main(void)
     irq_set_priority(IO_IRQ_BANK0, 0x00);  // Max priority to avoid missing VSYNC edges
     gpio_set_irq_enabled(VSYNC_PIN, GPIO_IRQ_EDGE_RISE, true);
     printf("VSYNC GPIO interrupt enabled (rising edge)\n");
+#else
+    boot_summary();
 #endif
 
     // Track which packed buffer is being captured (both modes use packed buffers)
@@ -1354,7 +2735,6 @@ int main(void)
     while (true) 
     {
         static uint32_t loop_counter = 0;
-        static uint32_t frames_captured = 0;
 #if ENABLE_VIDEO_CAPTURE
 
         // Skip arming capture until splash time has elapsed
@@ -1364,6 +2744,7 @@ int main(void)
             {
                 printf("Splash screen done, starting video capture\n");
                 splash_done = true;
+                boot_delay_us += SPLASH_DURATION_MS * 1000u;
             }
         }
 
@@ -1392,6 +2773,7 @@ int main(void)
 
             if (video_capture_frame_ready()) 
             {
+                const uint32_t work_start_us = time_us_32();
                 // Swap capture buffers now and immediately arm next capture to minimize VSYNC miss window
                 uint8_t* completed_packed = video_capture_get_frame();
                 uint8_t* next_buf = (completed_packed == packed_buffer_0) ? packed_buffer_1 : packed_buffer_0;
@@ -1430,25 +2812,36 @@ int main(void)
 
                         // Single lookup for brightened ghost (non-white→gray, white→white)
                         // This matches: *pixel_old++ = new_value > 0 ? 2 : 0;
-                        packed_buffer_previous[i] = store_lut[current];
+                        packed_buffer_previous[i] = frame_blend_store_lut[current];
                     }
                 }
     
-                // Overlay OSD text, if enabled
-                OSD_render((uint8_t*)completed_packed);
-
                 // Swap display buffer to the completed frame (packed 2bpp)
                 __dmb();
                 packed_display_ptr = (volatile uint8_t*)completed_packed;
                 __dmb();
     
                 frames_captured++;
+                core0_busy_us += time_us_32() - work_start_us;
+
+                if (frames_captured == 1)
+                {
+                    boot_checkpoint("First frame captured");
+                    boot_summary();
+                }
             }
         }
 
 
 #endif // ENABLE_VIDEO_CAPTURE
 
+#if ENABLE_OSD
+        // Rebuild the cached overlay only if menu state changed since last pass
+        update_perf_hud();
+        OSD_update();
+#endif // ENABLE_OSD
+        update_lcd_grid();
+
         loop_counter++;
         
         // Poll controller at a low rate to reduce I2C/CPU load that can steal VSYNC time
@@ -1456,10 +2849,12 @@ int main(void)
         absolute_time_t now = get_absolute_time();
         if (time_reached(controller_poll_enable_time) && time_reached(next_controller_poll)) 
         {
+            const uint32_t work_start_us = time_us_32();
             nes_classic_controller();
             (void)command_check();
             button_state_save_previous();
             next_controller_poll = delayed_by_ms(now, 5);  // ~200 Hz
+            core0_busy_us += time_us_32() - work_start_us;
         }
     }
     __builtin_unreachable();
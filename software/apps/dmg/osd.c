@@ -4,218 +4,489 @@
 #include <string.h>
 #include <stdint.h>
 
-static inline void set_pixel_2bpp(uint8_t *buf, int x, int y, uint8_t color)
-{
-    if ((buf == NULL) || (x < 0) || (x >= DMG_PIXELS_X) || (y < 0) || (y >= DMG_PIXELS_Y)) {
-        return;
-    }
+// The OSD is drawn at output resolution straight into the TMDS scanline
+// buffer, after the game line has been encoded. Boxes are laid out in font
+// pixels, each one px_words TMDS words (DVI_SYMBOLS_PER_WORD output pixels
+// each) wide and px_rows scanline buffers tall. A buffer is repeated on one
+// or more output lines, not necessarily the same number for every buffer,
+// so the scale is picked per mode to keep the font pixels close to 2:3 and
+// about 1/160 of the screen tall, as they are at 640x480.
+#define OSD_BORDER          2   // font pixels left/right and top/bottom
+#define OSD_PADDING         1
+#define OSD_LINE_STRIDE     8   // 7px glyph height + 1px spacing
+#define OSD_GLYPH_WORDS     6   // 5 glyph columns + 1 spacing column, at 1 word per pixel
+#define OSD_MAX_HEIGHT      (OSD_MAX_LINES * (OSD_LINE_STRIDE + 1) + OSD_BORDER * 2 + OSD_PADDING * 2)
 
-    // Treat 0xFF as transparent (skip write)
-    if (color == 0xFF) {
-        return;
-    }
+// Fixed OSD colours (RGB888), independent of the game palette
+#define OSD_RGB_FG          0xf0f0f0
+#define OSD_RGB_BG          0x202830
+#define OSD_RGB_BORDER      0x8890a0
+#define OSD_RGB_HIGHLIGHT   0x3050a0
 
-    size_t idx = (size_t)y * PACKED_LINE_STRIDE_BYTES + (size_t)(x >> 2);
-    uint32_t shift = (3u - (uint32_t)(x & 3)) * 2u;
-    uint8_t mask = (uint8_t)(0x03u << shift);
-    buf[idx] = (uint8_t)((buf[idx] & ~mask) | ((color & 0x03u) << shift));
-}
+typedef enum {
+    OSD_ROW_BORDER = 0,     // solid border colour across the box
+    OSD_ROW_FILL,           // border | background | border
+    OSD_ROW_TEXT,           // border | padding | glyph spans | padding | border
+} osd_row_kind_t;
+
+typedef enum {
+    OSD_SPANS_NORMAL = 0,
+    OSD_SPANS_HIGHLIGHT,
+    OSD_SPANS_COUNT
+} osd_span_set_t;
 
-// static void fill_buffer_2bpp(uint8_t *buf, uint8_t color)
-// {
-//     if (buf == NULL) {
-//         return;
-//     }
+typedef struct {
+    uint8_t kind;
+    uint8_t spans;                      // osd_span_set_t, for text rows
+    uint8_t bits[OSD_MAX_CHARS];        // 5-bit glyph row per character
+} osd_row_t;
 
-//     uint8_t packed = (uint8_t)(((color & 0x03u) << 6) | ((color & 0x03u) << 4) | ((color & 0x03u) << 2) | (color & 0x03u));
-//     memset(buf, packed, PACKED_FRAME_SIZE);
-// }
+// Pre-built plan of a box: one entry per font pixel row, so the compose
+// path never touches the font or the text. The scale is copied in, as core 1
+// may still be using an old plan just after a mode change.
+typedef struct {
+    osd_row_t rows[OSD_MAX_HEIGHT];
+    int first_row;                      // in scanline buffers
+    int row_count;                      // in font pixel rows
+    uint x_word;
+    uint chars;                         // glyph slots per text row
+    uint px_words;
+    uint px_rows;
+    uint32_t px_rows_recip;             // 2^16 / px_rows, rounded up
+} osd_plan_t;
 
-static void draw_glyph_5x7(uint8_t *buf, int x, int y, const glyph_5x7_t *glyph, uint8_t fg, uint8_t bg)
+// A text box: the menu (centred, fixed width, with a highlighted line) or
+// the HUD (top-left corner, sized to its text). Each keeps two plans so
+// core 1 can keep compositing the published one while the other is
+// rebuilt. front is NULL whenever there is nothing to show. Core 1 sets
+// acked to the plan it last finished with; the other plan is only reused
+// once acked has caught up with front, as until then core 1 may still be
+// part way through a line from it.
+typedef struct {
+    char lines[OSD_MAX_LINES][OSD_MAX_CHARS + 1];
+    int max_lines;
+    int active_line;                    // -1 for no highlight
+    bool enabled;
+    bool dirty;
+    bool centred;
+    osd_plan_t plans[2];
+    osd_plan_t * volatile front;
+    const osd_plan_t * volatile acked;
+} osd_box_t;
+
+// Duplicated from tmds_encode.c
+static const uint32_t osd_tmds_table[] = {
+#include "tmds_table.h"
+};
+
+// Pre-encoded TMDS words, per lane (0 = blue, 1 = green, 2 = red)
+static uint32_t osd_word_fg[3];
+static uint32_t osd_word_bg[OSD_SPANS_COUNT][3];
+static uint32_t osd_word_border[3];
+// Every 5-bit glyph row pattern, pre-encoded as a 6 word span per lane
+static uint32_t osd_glyph_spans[OSD_SPANS_COUNT][3][32][OSD_GLYPH_WORDS];
+
+static uint16_t fb_words = 320;
+static uint16_t fb_h = 160;
+// Font pixel size for the mode, and font rows per text line
+static uint osd_px_words = 1;
+static uint osd_px_rows = 1;
+static uint osd_line_stride = OSD_LINE_STRIDE;
+
+static osd_box_t osd_menu = { .max_lines = OSD_MAX_LINES, .dirty = true, .centred = true };
+static osd_box_t osd_hud  = { .max_lines = OSD_HUD_LINES, .active_line = -1, .dirty = true };
+
+static void osd_encode_rgb(uint32_t *words, uint32_t rgb888)
 {
-    if ((buf == NULL) || (glyph == NULL)) {
-        return;
+    words[0] = osd_tmds_table[(rgb888 & 0xff) >> 2];
+    words[1] = osd_tmds_table[((rgb888 >> 8) & 0xff) >> 2];
+    words[2] = osd_tmds_table[((rgb888 >> 16) & 0xff) >> 2];
+}
+
+static void osd_build_spans(void)
+{
+    osd_encode_rgb(osd_word_fg, OSD_RGB_FG);
+    osd_encode_rgb(osd_word_bg[OSD_SPANS_NORMAL], OSD_RGB_BG);
+    osd_encode_rgb(osd_word_bg[OSD_SPANS_HIGHLIGHT], OSD_RGB_HIGHLIGHT);
+    osd_encode_rgb(osd_word_border, OSD_RGB_BORDER);
+
+    for (int set = 0; set < OSD_SPANS_COUNT; ++set) {
+        for (int lane = 0; lane < 3; ++lane) {
+            for (uint32_t bits = 0; bits < 32; ++bits) {
+                uint32_t *span = osd_glyph_spans[set][lane][bits];
+                for (int col = 0; col < 5; ++col) {
+                    const bool on = (bits & (0x10u >> col)) != 0;
+                    span[col] = on ? osd_word_fg[lane] : osd_word_bg[set][lane];
+                }
+                span[5] = osd_word_bg[set][lane]; // 1 column spacing
+            }
+        }
     }
+}
 
-    for (int row = 0; row < 7; ++row) {
-        uint8_t bits = glyph->rows[row];
-        for (int col = 0; col < 5; ++col) {
-            const bool on = (bits & (0x10 >> col)) != 0;
-            set_pixel_2bpp(buf, x + col, y + row, on ? fg : bg);
+static int osd_visible_lines(const osd_box_t *box)
+{
+    int last = -1;
+    for (int i = 0; i < box->max_lines; ++i) {
+        if (box->lines[i][0] != '\0') {
+            last = i;
         }
-        set_pixel_2bpp(buf, x + 5, y + row, bg); // 1px spacing
     }
+    return last + 1; // 0 if nothing to show
 }
 
-static void draw_text_line(uint8_t *buf, int x, int y, const char *text, uint8_t fg, uint8_t bg)
+static void osd_box_set_line_text(osd_box_t *box, int line, const char *text)
 {
-    if ((buf == NULL) || (text == NULL)) {
+    if (line < 0 || line >= box->max_lines || text == NULL) {
+        return;
+    }
+    if (strncmp(box->lines[line], text, OSD_MAX_CHARS) == 0) {
         return;
     }
+    strncpy(box->lines[line], text, OSD_MAX_CHARS);
+    box->lines[line][OSD_MAX_CHARS] = '\0';
+    box->dirty = true;
+}
 
-    // Render exactly OSD_MAX_CHARS glyph slots; pad with spaces
-    int cursor_x = x;
-    for (int i = 0; i < OSD_MAX_CHARS; ++i) {
-        char c = text[i];
-        if (c == '\0') c = ' ';
-        const glyph_5x7_t *glyph = font5x7_lookup(c);
-        draw_glyph_5x7(buf, cursor_x, y, glyph, fg, bg);
-        cursor_x += 6; // 5 pixels plus spacing
+static void osd_box_set_enabled(osd_box_t *box, bool enable)
+{
+    if (box->enabled != enable) {
+        box->enabled = enable;
+        box->dirty = true;
     }
 }
 
-static bool osd_enabled = false;
-static uint16_t fb_w = DMG_PIXELS_X;
-static uint16_t fb_h = DMG_PIXELS_Y;
-static int osd_x = 0;
-static int osd_y = 0;
-static int osd_width = 0;
-static int osd_height = 0;
-static int osd_border = 2;
-static int osd_padding = 1;
-static int osd_active_line = 0;
-static char osd_lines[OSD_MAX_LINES][OSD_MAX_CHARS + 1];
+static uint osd_gcd(uint a, uint b)
+{
+    while (b != 0) {
+        const uint t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
 
-static int osd_visible_lines(void)
+static void osd_set_scale(uint16_t words_per_line, uint16_t fb_height, uint16_t output_lines)
 {
-    int last = -1;
-    for (int i = 0; i < OSD_MAX_LINES; ++i) {
-        if (osd_lines[i][0] != '\0') {
-            last = i;
-        }
+    fb_words = words_per_line;
+    fb_h = fb_height;
+
+    // Lines per buffer and the wanted font pixel height, both x16. The
+    // height is 3 lines at 480, scaled with the screen: output_lines / 160.
+    const uint lines_x16 = ((uint)output_lines * 16u + fb_height / 2u) / fb_height;
+    const uint target_x16 = output_lines / 10u;
+    // Halfway rounds down, to the smaller box: 640 SMALL keeps 2 lines
+    osd_px_rows = MAX(1u, (target_x16 + (lines_x16 - 1u) / 2u) / lines_x16);
+    // Width two thirds of the height actually got, in whole words
+    const uint width_x16 = osd_px_rows * lines_x16 * 2u / 3u / DVI_SYMBOLS_PER_WORD;
+    osd_px_words = MAX(1u, (width_x16 + 8u) / 16u);
+
+    // When the buffers are not all the same height (the FULL modes), the
+    // heights repeat every period buffers. A 9th row per text line, where
+    // that is a whole number of periods, puts every line on the same
+    // pattern, so all lines come out the same height with the same rows
+    // (640 FULL: 3, 3, 4 lines). Longer periods keep the plain stride.
+    const uint period = fb_height / osd_gcd(output_lines, fb_height);
+    osd_line_stride = OSD_LINE_STRIDE;
+    if (period > 1 && (OSD_LINE_STRIDE + 1) * osd_px_rows % period == 0) {
+        osd_line_stride = OSD_LINE_STRIDE + 1;
     }
-    return last + 1; // 0 if nothing to show
 }
 
 // Public API
-void OSD_init(uint16_t fb_width, uint16_t fb_height)
+void OSD_init(uint16_t words_per_line, uint16_t fb_height, uint16_t output_lines)
 {
-    fb_w = fb_width;
-    fb_h = fb_height;
-    osd_width  = 6 * OSD_MAX_CHARS + osd_border * 2 + osd_padding * 2;   // glyphs + spacing + border + padding
-    osd_height = 0; // will be set dynamically per render
-    osd_x = 0;
-    osd_y = 0;
+    osd_set_scale(words_per_line, fb_height, output_lines);
+    osd_build_spans();
     OSD_clear();
+    for (int i = 0; i < OSD_HUD_LINES; ++i) {
+        osd_hud.lines[i][0] = '\0';
+    }
+    osd_hud.dirty = true;
+}
+
+void OSD_set_frame_size(uint16_t words_per_line, uint16_t fb_height, uint16_t output_lines)
+{
+    osd_set_scale(words_per_line, fb_height, output_lines);
+    osd_menu.dirty = true;
+    osd_hud.dirty = true;
 }
 
 void OSD_set_enabled(bool enable)
 {
-    osd_enabled = enable;
+    osd_box_set_enabled(&osd_menu, enable);
 }
 
 void OSD_toggle(void)
 {
-    osd_enabled = !osd_enabled;
+    osd_box_set_enabled(&osd_menu, !osd_menu.enabled);
 }
 
 bool OSD_is_enabled(void)
 {
-    return osd_enabled;
+    return osd_menu.enabled;
 }
 
 void OSD_set_line_text(int line, const char *text)
 {
-    if (line < 0 || line >= OSD_MAX_LINES || text == NULL) {
-        return;
-    }
-    strncpy(osd_lines[line], text, OSD_MAX_CHARS);
-    osd_lines[line][OSD_MAX_CHARS] = '\0';
+    osd_box_set_line_text(&osd_menu, line, text);
 }
 
 void OSD_set_active_line(int line)
 {
-    int count = osd_visible_lines();
+    int count = osd_visible_lines(&osd_menu);
     if (count <= 0) {
-        osd_active_line = 0;
+        osd_menu.active_line = 0;
         return;
     }
     if (line < 0) line = 0;
     if (line >= count) line = count - 1;
-    osd_active_line = line;
+    if (osd_menu.active_line != line) {
+        osd_menu.active_line = line;
+        osd_menu.dirty = true;
+    }
 }
 
 void OSD_change_active_line(int delta)
 {
-    int count = osd_visible_lines();
+    int count = osd_visible_lines(&osd_menu);
     if (count <= 0) {
-        osd_active_line = 0;
+        osd_menu.active_line = 0;
         return;
     }
-    int next = (osd_active_line + delta) % count;
+    int next = (osd_menu.active_line + delta) % count;
     if (next < 0) next += count;
-    osd_active_line = next;
+    if (osd_menu.active_line != next) {
+        osd_menu.active_line = next;
+        osd_menu.dirty = true;
+    }
 }
 
 int OSD_get_active_line(void)
 {
-    return osd_active_line;
+    return osd_menu.active_line;
 }
 
 void OSD_clear(void)
 {
     for (int i = 0; i < OSD_MAX_LINES; ++i) {
-        osd_lines[i][0] = '\0';
+        osd_menu.lines[i][0] = '\0';
+    }
+    osd_menu.active_line = 0;
+    osd_menu.dirty = true;
+}
+
+void OSD_set_hud_enabled(bool enable)
+{
+    osd_box_set_enabled(&osd_hud, enable);
+}
+
+bool OSD_is_hud_enabled(void)
+{
+    return osd_hud.enabled;
+}
+
+void OSD_set_hud_line_text(int line, const char *text)
+{
+    osd_box_set_line_text(&osd_hud, line, text);
+}
+
+static void osd_rebuild(const osd_box_t *box, osd_plan_t *plan, int line_count)
+{
+    const int height = line_count * (int)osd_line_stride + OSD_BORDER * 2 + OSD_PADDING * 2;
+    const uint px = osd_px_words;
+    plan->px_words = px;
+    plan->px_rows = osd_px_rows;
+    plan->px_rows_recip = (65536u + osd_px_rows - 1u) / osd_px_rows;
+
+    // The menu keeps a fixed width; the HUD shrinks to its longest line
+    uint chars = OSD_MAX_CHARS;
+    if (!box->centred) {
+        chars = 0;
+        for (int i = 0; i < line_count; ++i) {
+            uint len = (uint)strlen(box->lines[i]);
+            if (len > chars) chars = len;
+        }
+    }
+    plan->chars = chars;
+
+    const int box_words = (int)((chars * OSD_GLYPH_WORDS + OSD_BORDER * 2 + OSD_PADDING * 2) * px);
+    const int box_buffers = height * (int)osd_px_rows;
+    if (box->centred) {
+        plan->x_word = ((int)fb_words > box_words) ? (uint)((int)fb_words - box_words) / 2 : 0;
+        plan->first_row = ((int)fb_h - box_buffers) / 2;
+    } else {
+        plan->x_word = OSD_BORDER * 2 * px;
+        plan->first_row = OSD_BORDER * (int)osd_px_rows;
+    }
+    plan->row_count = height;
+
+    for (int y = 0; y < height; ++y) {
+        osd_row_t *row = &plan->rows[y];
+        row->kind = OSD_ROW_FILL;
+        row->spans = OSD_SPANS_NORMAL;
+
+        if ((y < OSD_BORDER) || (y >= height - OSD_BORDER)) {
+            row->kind = OSD_ROW_BORDER;
+            continue;
+        }
+
+        // 7 glyph rows, then 1 or 2 rows of background
+        int text_y = y - OSD_BORDER - OSD_PADDING;
+        if ((text_y < 0) || (text_y >= line_count * (int)osd_line_stride)) {
+            continue;
+        }
+        int line = text_y / (int)osd_line_stride;
+        int glyph_row = text_y % (int)osd_line_stride;
+        if (glyph_row >= 7) {
+            continue;
+        }
+
+        // Highlight active line across glyph height (leave spacing as bg)
+        row->kind = OSD_ROW_TEXT;
+        row->spans = (line == box->active_line) ? OSD_SPANS_HIGHLIGHT : OSD_SPANS_NORMAL;
+
+        // Render exactly 'chars' glyph slots; pad with spaces
+        bool ended = false;
+        for (uint i = 0; i < chars; ++i) {
+            char c = ended ? ' ' : box->lines[line][i];
+            if (c == '\0') {
+                ended = true;
+                c = ' ';
+            }
+            row->bits[i] = font5x7_lookup(c)->rows[glyph_row] & 0x1f;
+        }
     }
-    osd_active_line = 0;
 }
 
-void OSD_render(uint8_t *packed_buf)
+static void osd_box_update(osd_box_t *box)
 {
-    if (!osd_enabled || packed_buf == NULL) {
+    if (!box->dirty) {
         return;
     }
 
-    int line_count = osd_visible_lines();
-    if (line_count <= 0) {
+    int line_count = osd_visible_lines(box);
+    if (!box->enabled || line_count <= 0) {
+        box->dirty = false;
+        box->front = NULL;
         return;
     }
 
-    if (osd_active_line >= line_count) {
-        osd_active_line = line_count - 1;
+    // Last flip not seen by core 1 yet: try again on the next update
+    if (box->acked != box->front) {
+        return;
     }
+    box->dirty = false;
 
-    osd_height = line_count * 8 + osd_border * 2 + osd_padding * 2;
-    osd_x = (int)(fb_w - osd_width) / 2;
-    osd_y = (int)(fb_h - osd_height) / 2;
+    if (box->active_line >= line_count) {
+        box->active_line = line_count - 1;
+    }
 
-    const uint8_t bg = 3;             // dark fill for text background
-    const uint8_t border = 2;         // slightly lighter border
-    const uint8_t highlight_bg = 1;   // lighter fill for active line
-    const uint8_t fg = 0;             // bright text
+    osd_plan_t *back = (box->front == &box->plans[0]) ? &box->plans[1] : &box->plans[0];
+    osd_rebuild(box, back, line_count);
 
-    // Outer border box
-    for (int y = 0; y < osd_height; ++y) {
-        for (int x = 0; x < osd_width; ++x) {
-            set_pixel_2bpp(packed_buf, osd_x + x, osd_y + y, border);
-        }
+    __dmb();
+    box->front = back;
+}
+
+void OSD_update(void)
+{
+    osd_box_update(&osd_hud);
+    osd_box_update(&osd_menu);
+}
+
+// Unrolled by four: the fill rows of a box are as wide as its text
+static inline void osd_fill_words(uint32_t *dst, uint32_t word, int count)
+{
+    for (; count >= 4; count -= 4, dst += 4) {
+        dst[0] = word;
+        dst[1] = word;
+        dst[2] = word;
+        dst[3] = word;
+    }
+    for (int i = 0; i < count; ++i) {
+        dst[i] = word;
     }
+}
 
-    // Inner fill
-    int inner_w = osd_width - osd_border * 2;
-    int inner_h = osd_height - osd_border * 2;
-    int inner_x = osd_x + osd_border;
-    int inner_y = osd_y + osd_border;
-    for (int y = 0; y < inner_h; ++y) {
-        for (int x = 0; x < inner_w; ++x) {
-            set_pixel_2bpp(packed_buf, inner_x + x, inner_y + y, bg);
-        }
+static void __not_in_flash_func(osd_compose_plan)(const osd_plan_t *plan, uint32_t *tmdsbuf, uint32_t words_per_lane, int row)
+{
+    if (plan == NULL) {
+        return;
     }
+    int y = row - plan->first_row;
+    const int px = (int)plan->px_words;
+    const int text_words = (int)(plan->chars * OSD_GLYPH_WORDS) * px;
+    const int border_words = OSD_BORDER * px;
+    const int padding_words = OSD_PADDING * px;
+    const int box_words = text_words + (border_words + padding_words) * 2;
+    if ((y < 0) || (y >= plan->row_count * (int)plan->px_rows) || (plan->x_word + box_words > words_per_lane)) {
+        return;
+    }
+    // Buffers to font rows, without a divide
+    y = (int)(((uint32_t)y * plan->px_rows_recip) >> 16);
 
-    // Render lines inside border; 8px stride fills inter-line gap with bg
-    int text_origin_y = inner_y + osd_padding;
-    int text_origin_x = inner_x + osd_padding;
-    int text_width = 6 * OSD_MAX_CHARS;
-    for (int i = 0; i < line_count; ++i) {
-        int y = text_origin_y + i * 8; // 7px glyph height + 1px spacing
-        // Highlight active line across glyph height (leave spacing as bg)
-        if (i == osd_active_line) {
-            for (int row = 0; row < 7; ++row) {
-                for (int x = 0; x < text_width; ++x) {
-                    set_pixel_2bpp(packed_buf, text_origin_x + x, y + row, highlight_bg);
+    const osd_row_t *r = &plan->rows[y];
+    for (int lane = 0; lane < 3; ++lane) {
+        uint32_t *dst = tmdsbuf + lane * words_per_lane + plan->x_word;
+        const uint32_t border = osd_word_border[lane];
+
+        if (r->kind == OSD_ROW_BORDER) {
+            osd_fill_words(dst, border, box_words);
+            continue;
+        }
+
+        const uint32_t bg = osd_word_bg[r->spans][lane];
+        osd_fill_words(dst, border, border_words);
+        dst += border_words;
+
+        if (r->kind == OSD_ROW_FILL) {
+            osd_fill_words(dst, osd_word_bg[OSD_SPANS_NORMAL][lane], text_words + padding_words * 2);
+        } else {
+            osd_fill_words(dst, bg, padding_words);
+            uint32_t *text = dst + padding_words;
+            const uint32_t (*spans)[OSD_GLYPH_WORDS] = osd_glyph_spans[r->spans][lane];
+            if (px == 1) {
+                for (uint i = 0; i < plan->chars; ++i) {
+                    const uint32_t *span = spans[r->bits[i]];
+                    text[0] = span[0];
+                    text[1] = span[1];
+                    text[2] = span[2];
+                    text[3] = span[3];
+                    text[4] = span[4];
+                    text[5] = span[5];
+                    text += OSD_GLYPH_WORDS;
+                }
+            } else {
+                // Wide font pixels: each span word repeated
+                for (uint i = 0; i < plan->chars; ++i) {
+                    const uint32_t *span = spans[r->bits[i]];
+                    for (int col = 0; col < OSD_GLYPH_WORDS; ++col) {
+                        osd_fill_words(text, span[col], px);
+                        text += px;
+                    }
                 }
             }
+            osd_fill_words(text, bg, padding_words);
         }
-        draw_text_line(packed_buf, text_origin_x, y, osd_lines[i], fg, (i == osd_active_line) ? highlight_bg : bg);
+        dst += text_words + padding_words * 2;
+
+        osd_fill_words(dst, border, border_words);
     }
-}
\ No newline at end of file
+}
+
+static void __not_in_flash_func(osd_compose_box)(osd_box_t *box, uint32_t *tmdsbuf, uint32_t words_per_lane, int row)
+{
+    const osd_plan_t *plan = box->front;
+    osd_compose_plan(plan, tmdsbuf, words_per_lane, row);
+    // All reads of the plan are done before core 0 may see it released
+    __dmb();
+    box->acked = plan;
+}
+
+void __not_in_flash_func(OSD_compose_tmds_line)(uint32_t *tmdsbuf, uint32_t words_per_lane, int row)
+{
+    osd_compose_box(&osd_hud, tmdsbuf, words_per_lane, row);
+    // Menu last so it stays on top if the two ever overlap
+    osd_compose_box(&osd_menu, tmdsbuf, words_per_lane, row);
+}
@@ -4,10 +4,16 @@
 #include <stdbool.h>
 #include <stdint.h>
 
-#define OSD_MAX_LINES   10
+#define OSD_MAX_LINES   11
 #define OSD_MAX_CHARS   21
+#define OSD_HUD_LINES   4   // per HUD page
 
-void OSD_init(uint16_t fb_width, uint16_t fb_height);
+// words_per_line is the output width in TMDS words, fb_height the number of
+// scanline buffers per frame and output_lines the lines they cover, so
+// output_lines / fb_height lines per buffer (not always a whole number).
+// The font is scaled from these to look the same in every mode.
+void OSD_init(uint16_t words_per_line, uint16_t fb_height, uint16_t output_lines);
+void OSD_set_frame_size(uint16_t words_per_line, uint16_t fb_height, uint16_t output_lines);  // after a video mode change
 void OSD_set_enabled(bool enable);
 void OSD_toggle(void);
 bool OSD_is_enabled(void);
@@ -16,6 +22,14 @@ void OSD_set_active_line(int line);
 void OSD_change_active_line(int delta);
 int  OSD_get_active_line(void);
 void OSD_clear(void);
-void OSD_render(uint8_t *packed_buf);
+// Small box in the top-left corner for live diagnostics (performance HUD)
+void OSD_set_hud_enabled(bool enable);
+bool OSD_is_hud_enabled(void);
+void OSD_set_hud_line_text(int line, const char *text);
+// Rebuild the cached overlay if any OSD state changed. Call from the main loop.
+void OSD_update(void);
+// Overwrite the OSD box span of an encoded TMDS scanline buffer (3 lanes of
+// words_per_lane words, blue first) if scanline row is covered by the box.
+void OSD_compose_tmds_line(uint32_t *tmdsbuf, uint32_t words_per_lane, int row);
 
 #endif // OSD_H
\ No newline at end of file
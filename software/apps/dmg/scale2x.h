@@ -0,0 +1,128 @@
+#ifndef SCALE2X_H
+#define SCALE2X_H
+
+// Scale2x (EPX) and Scale4x on packed 2bpp Game Boy lines, for the smoothing
+// video modes. Free of SDK includes so the host tests in software/tests can
+// run the exact same code against a direct EPX reference. Needs DMG_PIXELS_X
+// and DMG_PIXELS_Y (see video_defs.h) defined first, and the lookup table is
+// scale2x_lut from dmg_tables.h.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define SCALE2X_INLINE static inline __attribute__((always_inline))
+
+// The scanline callback copies each Game Boy line with two neighbours either
+// side into a job; the pointer it queues for the encoder carries the output
+// row within the line in its low bits.
+typedef struct smooth_job_t
+{
+    uint8_t rows[5][DMG_PIXELS_X / 4];  // lines - 2 .. + 2, repeated at the frame edges
+    uint8_t line;
+} __attribute__((aligned(4))) smooth_job_t;
+#define SMOOTH_ROW_MASK 3u
+
+SCALE2X_INLINE void smooth_job_fill(smooth_job_t *job, const uint8_t *packed_fb, int line)
+{
+    for (int i = 0; i < 5; ++i)
+    {
+        int src = line + i - 2;
+        src = (src < 0) ? 0 : (src > DMG_PIXELS_Y - 1) ? DMG_PIXELS_Y - 1 : src;
+        memcpy(job->rows[i], packed_fb + src * (DMG_PIXELS_X / 4), DMG_PIXELS_X / 4);
+    }
+    job->line = (uint8_t)line;
+}
+
+// Scale2x one packed row. Each pixel's left, centre and right neighbours sit
+// side by side in a 24-bit window over the line, so with the pixels above and
+// below they make a 10-bit key into scale2x_lut. Each pixel gives an output
+// pair: either a TMDS word from the split table or, for the Scale4x first
+// pass, a nibble of a packed row twice as wide. Edge pixels repeat outwards.
+SCALE2X_INLINE void scale2x_row(const uint8_t *above, const uint8_t *cur, const uint8_t *below,
+                                size_t bytes, const uint8_t *lut, uint8_t *packed_out,
+                                uint32_t *symbuf_r, uint32_t *symbuf_g, uint32_t *symbuf_b,
+                                const uint32_t *split_r, const uint32_t *split_g, const uint32_t *split_b)
+{
+    for (size_t i = 0; i < bytes; i++)
+    {
+        const uint32_t prev = (i > 0) ? cur[i - 1] : (uint32_t)cur[0] >> 6;
+        const uint32_t next = (i + 1 < bytes) ? (uint32_t)cur[i + 1] : ((uint32_t)cur[i] & 0x03) << 6;
+        const uint32_t window = (prev << 16) | ((uint32_t)cur[i] << 8) | next;
+        const uint32_t up = above[i];
+        const uint32_t down = below[i];
+        uint32_t pairs = 0;
+
+        for (int k = 0; k < 4; k++)
+        {
+            const uint32_t key = (((window >> (12 - 2 * k)) & 0x3f) << 4) |
+                                 (((up >> (6 - 2 * k)) & 0x03) << 2) |
+                                 ((down >> (6 - 2 * k)) & 0x03);
+            const uint32_t pair = lut[key];
+            if (packed_out)
+            {
+                pairs = (pairs << 4) | pair;
+            }
+            else
+            {
+                *symbuf_r++ = split_r[pair];
+                *symbuf_g++ = split_g[pair];
+                *symbuf_b++ = split_b[pair];
+            }
+        }
+        if (packed_out)
+        {
+            packed_out[2 * i] = (uint8_t)(pairs >> 8);
+            packed_out[2 * i + 1] = (uint8_t)pairs;
+        }
+    }
+}
+
+// Scale4x: the Scale2x rows (2x image) of recent lines, by row index mod 4
+typedef struct scale4x_cache_t
+{
+    uint8_t rows[4][DMG_PIXELS_X / 2];
+    int row_index[4];
+} __attribute__((aligned(4))) scale4x_cache_t;
+
+SCALE2X_INLINE void scale4x_cache_reset(scale4x_cache_t *cache)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        cache->row_index[i] = -1;
+    }
+}
+
+// Row r2x of the 2x image, from the cache or made from the job's lines. The
+// job holds lines - 2 .. + 2, which covers every 2x row a Scale4x line needs.
+SCALE2X_INLINE const uint8_t *scale4x_2x_row(scale4x_cache_t *cache, const smooth_job_t *job,
+                                             const uint8_t lut[2][1024], int r2x)
+{
+    r2x = (r2x < 0) ? 0 : (r2x > 2 * DMG_PIXELS_Y - 1) ? 2 * DMG_PIXELS_Y - 1 : r2x;
+    const unsigned slot = (unsigned)r2x & 3;
+    if (cache->row_index[slot] != r2x)
+    {
+        const int j = (r2x >> 1) - (int)job->line + 2;
+        scale2x_row(job->rows[j - 1], job->rows[j], job->rows[j + 1], DMG_PIXELS_X / 4, lut[r2x & 1],
+                    cache->rows[slot], NULL, NULL, NULL, NULL, NULL, NULL);
+        cache->row_index[slot] = r2x;
+    }
+    return cache->rows[slot];
+}
+
+// The three 2x rows output row sub_row (0-3) of the job's line is made from.
+// The first row of a frame drops whatever the cache held.
+SCALE2X_INLINE void scale4x_source_rows(scale4x_cache_t *cache, const smooth_job_t *job, unsigned sub_row,
+                                        const uint8_t lut[2][1024], const uint8_t *rows[3])
+{
+    if (job->line == 0 && sub_row == 0)
+    {
+        scale4x_cache_reset(cache);
+    }
+    const int r2x = 2 * job->line + (int)(sub_row >> 1);
+    rows[0] = scale4x_2x_row(cache, job, lut, r2x - 1);
+    rows[1] = scale4x_2x_row(cache, job, lut, r2x);
+    rows[2] = scale4x_2x_row(cache, job, lut, r2x + 1);
+}
+
+#endif // SCALE2X_H
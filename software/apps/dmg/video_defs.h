@@ -13,51 +13,21 @@
 #define PACKED_LINE_STRIDE_BYTES    (DMG_PIXELS_X / 4)
 
 
+// Output modes, in the order of the video mode table in main.c. RESOLUTION_MODE
+// (CMake) picks the mode used until saved settings are loaded; the rest are
+// selectable at runtime from the OSD.
 #define RESOLUTION_MODE_640x480_x4x3 0   // stretch x4,x3, window = 640x432
 #define RESOLUTION_MODE_800x600 1        // stretch x4,x4, window = 640x576
 #define RESOLUTION_MODE_640x480_x2x2 2   // stretch x2,x2, window = 320x288
-
-#if RESOLUTION_MODE == RESOLUTION_MODE_640x480_x4x3  // 640x480, stretch x4,x3
-#define FRAME_WIDTH 640
-#define FRAME_HEIGHT 480
-#define HORIZONTAL_SCALE 4
-
-#define VREG_VSEL VREG_VOLTAGE_1_10  // 252 MHz is comfortable at lower voltage
-#define DVI_TIMING dvi_timing_640x480p_60hz
-#elif RESOLUTION_MODE == RESOLUTION_MODE_800x600    // 800x600, stretch x4,x4
-#define FRAME_WIDTH 800
-#define FRAME_HEIGHT 600
-
-#define HORIZONTAL_SCALE 4
-
-static const struct dvi_timing __not_in_flash_func(dvi_timing_800x600p_60hz_280K) = {
-    .h_sync_polarity   = false,
-    .h_front_porch     = 44,
-    .h_sync_width      = 128,
-    .h_back_porch      = 88,
-    .h_active_pixels   = 800,
-
-    .v_sync_polarity   = false,
-    .v_front_porch     = 2,        // increased from 1
-    .v_sync_width      = 4,
-    .v_back_porch      = 22,
-    .v_active_lines    = 600,
-
-    .bit_clk_khz       = 280000
-};
-
-#define VREG_VSEL VREG_VOLTAGE_1_20
-#define DVI_TIMING dvi_timing_800x600p_60hz_280K
-#else  // RESOLUTION_MODE_640x480_x2x2
-#define FRAME_WIDTH 640
-#define FRAME_HEIGHT 480
-#define HORIZONTAL_SCALE 2
-
-#define VREG_VSEL VREG_VOLTAGE_1_10  // 252 MHz is comfortable at lower voltage
-#define DVI_TIMING dvi_timing_640x480p_60hz
-#endif
-
-#define SCANLINE_COUNT    (FRAME_HEIGHT / DVI_VERTICAL_REPEAT)
-#define VERTICAL_OFFSET   (((SCANLINE_COUNT - DMG_PIXELS_Y) / 2) - 2)  // center vertically, adjust for pre-pushed lines
+#define RESOLUTION_MODE_640x480_FULL 3   // stretch x4,x3.33, window = 640x480
+#define RESOLUTION_MODE_800x600_FULL 4   // stretch x4,x4.17, window = 640x600
+#define RESOLUTION_MODE_640x480_ASPECT 5 // stretch x3.33,x3.33, window = 534x480
+#define RESOLUTION_MODE_800x600_ASPECT 6 // stretch x4.17,x4.17, window = 666x600
+#define RESOLUTION_MODE_800x600_FILL 7   // stretch x5,x4.17, window = 800x600
+#define RESOLUTION_MODE_960x540_x3 8     // stretch x3,x3, window = 480x432
+#define RESOLUTION_MODE_1280x720_x5 9    // stretch x5,x5, window = 800x720 (30 Hz)
+#define RESOLUTION_MODE_640x480_SCALE2X 10 // Scale2x smoothing, window = 320x288
+#define RESOLUTION_MODE_800x600_SCALE4X 11 // Scale4x smoothing, window = 640x576
+#define RESOLUTION_MODE_COUNT 12
 
 #endif // VIDEO_DEFS_H
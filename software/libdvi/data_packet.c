@@ -69,6 +69,90 @@ int __not_in_flash_func(encode_BCH_7)(const uint8_t *p) {
     v = bchTable_[p[6] ^ v];
     return v;
 }
+
+// BCH is linear, so the parity of an audio sample subpacket is the XOR of
+// per-byte contributions. Bytes 0 and 3 are always zero, byte 6 only carries
+// the channel status and parity bits. Built statically with the following code
+// for (int i = 0; i < 256; ++i) { m[] = {0}; m[pos] = i; bchAudioTable_[k][i] = encode_BCH_7(m); } for pos = 1, 2, 4, 5
+const uint8_t __not_in_flash_func(bchAudioTable_)[4][256] = {
+    {
+        0x00, 0x34, 0x68, 0x5c, 0xd0, 0xe4, 0xb8, 0x8c, 0xa7, 0x93, 0xcf, 0xfb, 0x77, 0x43, 0x1f, 0x2b,
+        0x49, 0x7d, 0x21, 0x15, 0x99, 0xad, 0xf1, 0xc5, 0xee, 0xda, 0x86, 0xb2, 0x3e, 0x0a, 0x56, 0x62,
+        0x92, 0xa6, 0xfa, 0xce, 0x42, 0x76, 0x2a, 0x1e, 0x35, 0x01, 0x5d, 0x69, 0xe5, 0xd1, 0x8d, 0xb9,
+        0xdb, 0xef, 0xb3, 0x87, 0x0b, 0x3f, 0x63, 0x57, 0x7c, 0x48, 0x14, 0x20, 0xac, 0x98, 0xc4, 0xf0,
+        0x23, 0x17, 0x4b, 0x7f, 0xf3, 0xc7, 0x9b, 0xaf, 0x84, 0xb0, 0xec, 0xd8, 0x54, 0x60, 0x3c, 0x08,
+        0x6a, 0x5e, 0x02, 0x36, 0xba, 0x8e, 0xd2, 0xe6, 0xcd, 0xf9, 0xa5, 0x91, 0x1d, 0x29, 0x75, 0x41,
+        0xb1, 0x85, 0xd9, 0xed, 0x61, 0x55, 0x09, 0x3d, 0x16, 0x22, 0x7e, 0x4a, 0xc6, 0xf2, 0xae, 0x9a,
+        0xf8, 0xcc, 0x90, 0xa4, 0x28, 0x1c, 0x40, 0x74, 0x5f, 0x6b, 0x37, 0x03, 0x8f, 0xbb, 0xe7, 0xd3,
+        0x46, 0x72, 0x2e, 0x1a, 0x96, 0xa2, 0xfe, 0xca, 0xe1, 0xd5, 0x89, 0xbd, 0x31, 0x05, 0x59, 0x6d,
+        0x0f, 0x3b, 0x67, 0x53, 0xdf, 0xeb, 0xb7, 0x83, 0xa8, 0x9c, 0xc0, 0xf4, 0x78, 0x4c, 0x10, 0x24,
+        0xd4, 0xe0, 0xbc, 0x88, 0x04, 0x30, 0x6c, 0x58, 0x73, 0x47, 0x1b, 0x2f, 0xa3, 0x97, 0xcb, 0xff,
+        0x9d, 0xa9, 0xf5, 0xc1, 0x4d, 0x79, 0x25, 0x11, 0x3a, 0x0e, 0x52, 0x66, 0xea, 0xde, 0x82, 0xb6,
+        0x65, 0x51, 0x0d, 0x39, 0xb5, 0x81, 0xdd, 0xe9, 0xc2, 0xf6, 0xaa, 0x9e, 0x12, 0x26, 0x7a, 0x4e,
+        0x2c, 0x18, 0x44, 0x70, 0xfc, 0xc8, 0x94, 0xa0, 0x8b, 0xbf, 0xe3, 0xd7, 0x5b, 0x6f, 0x33, 0x07,
+        0xf7, 0xc3, 0x9f, 0xab, 0x27, 0x13, 0x4f, 0x7b, 0x50, 0x64, 0x38, 0x0c, 0x80, 0xb4, 0xe8, 0xdc,
+        0xbe, 0x8a, 0xd6, 0xe2, 0x6e, 0x5a, 0x06, 0x32, 0x19, 0x2d, 0x71, 0x45, 0xc9, 0xfd, 0xa1, 0x95,
+    },
+    {
+        0x00, 0x8c, 0x1f, 0x93, 0x3e, 0xb2, 0x21, 0xad, 0x7c, 0xf0, 0x63, 0xef, 0x42, 0xce, 0x5d, 0xd1,
+        0xf8, 0x74, 0xe7, 0x6b, 0xc6, 0x4a, 0xd9, 0x55, 0x84, 0x08, 0x9b, 0x17, 0xba, 0x36, 0xa5, 0x29,
+        0xf7, 0x7b, 0xe8, 0x64, 0xc9, 0x45, 0xd6, 0x5a, 0x8b, 0x07, 0x94, 0x18, 0xb5, 0x39, 0xaa, 0x26,
+        0x0f, 0x83, 0x10, 0x9c, 0x31, 0xbd, 0x2e, 0xa2, 0x73, 0xff, 0x6c, 0xe0, 0x4d, 0xc1, 0x52, 0xde,
+        0xe9, 0x65, 0xf6, 0x7a, 0xd7, 0x5b, 0xc8, 0x44, 0x95, 0x19, 0x8a, 0x06, 0xab, 0x27, 0xb4, 0x38,
+        0x11, 0x9d, 0x0e, 0x82, 0x2f, 0xa3, 0x30, 0xbc, 0x6d, 0xe1, 0x72, 0xfe, 0x53, 0xdf, 0x4c, 0xc0,
+        0x1e, 0x92, 0x01, 0x8d, 0x20, 0xac, 0x3f, 0xb3, 0x62, 0xee, 0x7d, 0xf1, 0x5c, 0xd0, 0x43, 0xcf,
+        0xe6, 0x6a, 0xf9, 0x75, 0xd8, 0x54, 0xc7, 0x4b, 0x9a, 0x16, 0x85, 0x09, 0xa4, 0x28, 0xbb, 0x37,
+        0xd5, 0x59, 0xca, 0x46, 0xeb, 0x67, 0xf4, 0x78, 0xa9, 0x25, 0xb6, 0x3a, 0x97, 0x1b, 0x88, 0x04,
+        0x2d, 0xa1, 0x32, 0xbe, 0x13, 0x9f, 0x0c, 0x80, 0x51, 0xdd, 0x4e, 0xc2, 0x6f, 0xe3, 0x70, 0xfc,
+        0x22, 0xae, 0x3d, 0xb1, 0x1c, 0x90, 0x03, 0x8f, 0x5e, 0xd2, 0x41, 0xcd, 0x60, 0xec, 0x7f, 0xf3,
+        0xda, 0x56, 0xc5, 0x49, 0xe4, 0x68, 0xfb, 0x77, 0xa6, 0x2a, 0xb9, 0x35, 0x98, 0x14, 0x87, 0x0b,
+        0x3c, 0xb0, 0x23, 0xaf, 0x02, 0x8e, 0x1d, 0x91, 0x40, 0xcc, 0x5f, 0xd3, 0x7e, 0xf2, 0x61, 0xed,
+        0xc4, 0x48, 0xdb, 0x57, 0xfa, 0x76, 0xe5, 0x69, 0xb8, 0x34, 0xa7, 0x2b, 0x86, 0x0a, 0x99, 0x15,
+        0xcb, 0x47, 0xd4, 0x58, 0xf5, 0x79, 0xea, 0x66, 0xb7, 0x3b, 0xa8, 0x24, 0x89, 0x05, 0x96, 0x1a,
+        0x33, 0xbf, 0x2c, 0xa0, 0x0d, 0x81, 0x12, 0x9e, 0x4f, 0xc3, 0x50, 0xdc, 0x71, 0xfd, 0x6e, 0xe2,
+    },
+    {
+        0x00, 0x4a, 0x94, 0xde, 0x2f, 0x65, 0xbb, 0xf1, 0x5e, 0x14, 0xca, 0x80, 0x71, 0x3b, 0xe5, 0xaf,
+        0xbc, 0xf6, 0x28, 0x62, 0x93, 0xd9, 0x07, 0x4d, 0xe2, 0xa8, 0x76, 0x3c, 0xcd, 0x87, 0x59, 0x13,
+        0x7f, 0x35, 0xeb, 0xa1, 0x50, 0x1a, 0xc4, 0x8e, 0x21, 0x6b, 0xb5, 0xff, 0x0e, 0x44, 0x9a, 0xd0,
+        0xc3, 0x89, 0x57, 0x1d, 0xec, 0xa6, 0x78, 0x32, 0x9d, 0xd7, 0x09, 0x43, 0xb2, 0xf8, 0x26, 0x6c,
+        0xfe, 0xb4, 0x6a, 0x20, 0xd1, 0x9b, 0x45, 0x0f, 0xa0, 0xea, 0x34, 0x7e, 0x8f, 0xc5, 0x1b, 0x51,
+        0x42, 0x08, 0xd6, 0x9c, 0x6d, 0x27, 0xf9, 0xb3, 0x1c, 0x56, 0x88, 0xc2, 0x33, 0x79, 0xa7, 0xed,
+        0x81, 0xcb, 0x15, 0x5f, 0xae, 0xe4, 0x3a, 0x70, 0xdf, 0x95, 0x4b, 0x01, 0xf0, 0xba, 0x64, 0x2e,
+        0x3d, 0x77, 0xa9, 0xe3, 0x12, 0x58, 0x86, 0xcc, 0x63, 0x29, 0xf7, 0xbd, 0x4c, 0x06, 0xd8, 0x92,
+        0xfb, 0xb1, 0x6f, 0x25, 0xd4, 0x9e, 0x40, 0x0a, 0xa5, 0xef, 0x31, 0x7b, 0x8a, 0xc0, 0x1e, 0x54,
+        0x47, 0x0d, 0xd3, 0x99, 0x68, 0x22, 0xfc, 0xb6, 0x19, 0x53, 0x8d, 0xc7, 0x36, 0x7c, 0xa2, 0xe8,
+        0x84, 0xce, 0x10, 0x5a, 0xab, 0xe1, 0x3f, 0x75, 0xda, 0x90, 0x4e, 0x04, 0xf5, 0xbf, 0x61, 0x2b,
+        0x38, 0x72, 0xac, 0xe6, 0x17, 0x5d, 0x83, 0xc9, 0x66, 0x2c, 0xf2, 0xb8, 0x49, 0x03, 0xdd, 0x97,
+        0x05, 0x4f, 0x91, 0xdb, 0x2a, 0x60, 0xbe, 0xf4, 0x5b, 0x11, 0xcf, 0x85, 0x74, 0x3e, 0xe0, 0xaa,
+        0xb9, 0xf3, 0x2d, 0x67, 0x96, 0xdc, 0x02, 0x48, 0xe7, 0xad, 0x73, 0x39, 0xc8, 0x82, 0x5c, 0x16,
+        0x7a, 0x30, 0xee, 0xa4, 0x55, 0x1f, 0xc1, 0x8b, 0x24, 0x6e, 0xb0, 0xfa, 0x0b, 0x41, 0x9f, 0xd5,
+        0xc6, 0x8c, 0x52, 0x18, 0xe9, 0xa3, 0x7d, 0x37, 0x98, 0xd2, 0x0c, 0x46, 0xb7, 0xfd, 0x23, 0x69,
+    },
+    {
+        0x00, 0xf1, 0xe5, 0x14, 0xcd, 0x3c, 0x28, 0xd9, 0x9d, 0x6c, 0x78, 0x89, 0x50, 0xa1, 0xb5, 0x44,
+        0x3d, 0xcc, 0xd8, 0x29, 0xf0, 0x01, 0x15, 0xe4, 0xa0, 0x51, 0x45, 0xb4, 0x6d, 0x9c, 0x88, 0x79,
+        0x7a, 0x8b, 0x9f, 0x6e, 0xb7, 0x46, 0x52, 0xa3, 0xe7, 0x16, 0x02, 0xf3, 0x2a, 0xdb, 0xcf, 0x3e,
+        0x47, 0xb6, 0xa2, 0x53, 0x8a, 0x7b, 0x6f, 0x9e, 0xda, 0x2b, 0x3f, 0xce, 0x17, 0xe6, 0xf2, 0x03,
+        0xf4, 0x05, 0x11, 0xe0, 0x39, 0xc8, 0xdc, 0x2d, 0x69, 0x98, 0x8c, 0x7d, 0xa4, 0x55, 0x41, 0xb0,
+        0xc9, 0x38, 0x2c, 0xdd, 0x04, 0xf5, 0xe1, 0x10, 0x54, 0xa5, 0xb1, 0x40, 0x99, 0x68, 0x7c, 0x8d,
+        0x8e, 0x7f, 0x6b, 0x9a, 0x43, 0xb2, 0xa6, 0x57, 0x13, 0xe2, 0xf6, 0x07, 0xde, 0x2f, 0x3b, 0xca,
+        0xb3, 0x42, 0x56, 0xa7, 0x7e, 0x8f, 0x9b, 0x6a, 0x2e, 0xdf, 0xcb, 0x3a, 0xe3, 0x12, 0x06, 0xf7,
+        0xef, 0x1e, 0x0a, 0xfb, 0x22, 0xd3, 0xc7, 0x36, 0x72, 0x83, 0x97, 0x66, 0xbf, 0x4e, 0x5a, 0xab,
+        0xd2, 0x23, 0x37, 0xc6, 0x1f, 0xee, 0xfa, 0x0b, 0x4f, 0xbe, 0xaa, 0x5b, 0x82, 0x73, 0x67, 0x96,
+        0x95, 0x64, 0x70, 0x81, 0x58, 0xa9, 0xbd, 0x4c, 0x08, 0xf9, 0xed, 0x1c, 0xc5, 0x34, 0x20, 0xd1,
+        0xa8, 0x59, 0x4d, 0xbc, 0x65, 0x94, 0x80, 0x71, 0x35, 0xc4, 0xd0, 0x21, 0xf8, 0x09, 0x1d, 0xec,
+        0x1b, 0xea, 0xfe, 0x0f, 0xd6, 0x27, 0x33, 0xc2, 0x86, 0x77, 0x63, 0x92, 0x4b, 0xba, 0xae, 0x5f,
+        0x26, 0xd7, 0xc3, 0x32, 0xeb, 0x1a, 0x0e, 0xff, 0xbb, 0x4a, 0x5e, 0xaf, 0x76, 0x87, 0x93, 0x62,
+        0x61, 0x90, 0x84, 0x75, 0xac, 0x5d, 0x49, 0xb8, 0xfc, 0x0d, 0x19, 0xe8, 0x31, 0xc0, 0xd4, 0x25,
+        0x5c, 0xad, 0xb9, 0x48, 0x91, 0x60, 0x74, 0x85, 0xc1, 0x30, 0x24, 0xd5, 0x0c, 0xfd, 0xe9, 0x18,
+    },
+};
+
+// Contribution of byte 6, indexed by CL | PL << 1 | CR << 2 | PR << 3 (V and U are always 0)
+const uint8_t __not_in_flash_func(bchAudioStatusTable_)[16] = {
+    0x00, 0x6d, 0xda, 0xb7, 0xc2, 0xaf, 0x18, 0x75, 0x83, 0xee, 0x59, 0x34, 0x41, 0x2c, 0x9b, 0xf6,
+};
 // BCH Encoding End
 
 // TERC4 Start
@@ -93,6 +177,84 @@ uint16_t __not_in_flash_func(TERC4Syms_)[16] = {
 
 uint32_t __not_in_flash_func(makeTERC4x2Char)(int i) { return TERC4Syms_[i] | (TERC4Syms_[i] << 10); }
 uint32_t __not_in_flash_func(makeTERC4x2Char_2)(int i0, int i1) { return TERC4Syms_[i0] | (TERC4Syms_[i1] << 10); }
+// Both TERC4 symbols of a word at once: index is (second nibble << 4) | first nibble.
+// Built statically with the following code
+// for (int i = 0; i < 256; ++i) { TERC4PairSyms_[i] = makeTERC4x2Char_2(i & 15, i >> 4); }
+const uint32_t __not_in_flash_func(TERC4PairSyms_)[256] = {
+    0xa729c, 0xa7263, 0xa72e4, 0xa72e2, 0xa7171, 0xa711e, 0xa718e, 0xa713c,
+    0xa72cc, 0xa7139, 0xa719c, 0xa72c6, 0xa728e, 0xa7271, 0xa7163, 0xa72c3,
+    0x98e9c, 0x98e63, 0x98ee4, 0x98ee2, 0x98d71, 0x98d1e, 0x98d8e, 0x98d3c,
+    0x98ecc, 0x98d39, 0x98d9c, 0x98ec6, 0x98e8e, 0x98e71, 0x98d63, 0x98ec3,
+    0xb929c, 0xb9263, 0xb92e4, 0xb92e2, 0xb9171, 0xb911e, 0xb918e, 0xb913c,
+    0xb92cc, 0xb9139, 0xb919c, 0xb92c6, 0xb928e, 0xb9271, 0xb9163, 0xb92c3,
+    0xb8a9c, 0xb8a63, 0xb8ae4, 0xb8ae2, 0xb8971, 0xb891e, 0xb898e, 0xb893c,
+    0xb8acc, 0xb8939, 0xb899c, 0xb8ac6, 0xb8a8e, 0xb8a71, 0xb8963, 0xb8ac3,
+    0x5c69c, 0x5c663, 0x5c6e4, 0x5c6e2, 0x5c571, 0x5c51e, 0x5c58e, 0x5c53c,
+    0x5c6cc, 0x5c539, 0x5c59c, 0x5c6c6, 0x5c68e, 0x5c671, 0x5c563, 0x5c6c3,
+    0x47a9c, 0x47a63, 0x47ae4, 0x47ae2, 0x47971, 0x4791e, 0x4798e, 0x4793c,
+    0x47acc, 0x47939, 0x4799c, 0x47ac6, 0x47a8e, 0x47a71, 0x47963, 0x47ac3,
+    0x63a9c, 0x63a63, 0x63ae4, 0x63ae2, 0x63971, 0x6391e, 0x6398e, 0x6393c,
+    0x63acc, 0x63939, 0x6399c, 0x63ac6, 0x63a8e, 0x63a71, 0x63963, 0x63ac3,
+    0x4f29c, 0x4f263, 0x4f2e4, 0x4f2e2, 0x4f171, 0x4f11e, 0x4f18e, 0x4f13c,
+    0x4f2cc, 0x4f139, 0x4f19c, 0x4f2c6, 0x4f28e, 0x4f271, 0x4f163, 0x4f2c3,
+    0xb329c, 0xb3263, 0xb32e4, 0xb32e2, 0xb3171, 0xb311e, 0xb318e, 0xb313c,
+    0xb32cc, 0xb3139, 0xb319c, 0xb32c6, 0xb328e, 0xb3271, 0xb3163, 0xb32c3,
+    0x4e69c, 0x4e663, 0x4e6e4, 0x4e6e2, 0x4e571, 0x4e51e, 0x4e58e, 0x4e53c,
+    0x4e6cc, 0x4e539, 0x4e59c, 0x4e6c6, 0x4e68e, 0x4e671, 0x4e563, 0x4e6c3,
+    0x6729c, 0x67263, 0x672e4, 0x672e2, 0x67171, 0x6711e, 0x6718e, 0x6713c,
+    0x672cc, 0x67139, 0x6719c, 0x672c6, 0x6728e, 0x67271, 0x67163, 0x672c3,
+    0xb1a9c, 0xb1a63, 0xb1ae4, 0xb1ae2, 0xb1971, 0xb191e, 0xb198e, 0xb193c,
+    0xb1acc, 0xb1939, 0xb199c, 0xb1ac6, 0xb1a8e, 0xb1a71, 0xb1963, 0xb1ac3,
+    0xa3a9c, 0xa3a63, 0xa3ae4, 0xa3ae2, 0xa3971, 0xa391e, 0xa398e, 0xa393c,
+    0xa3acc, 0xa3939, 0xa399c, 0xa3ac6, 0xa3a8e, 0xa3a71, 0xa3963, 0xa3ac3,
+    0x9c69c, 0x9c663, 0x9c6e4, 0x9c6e2, 0x9c571, 0x9c51e, 0x9c58e, 0x9c53c,
+    0x9c6cc, 0x9c539, 0x9c59c, 0x9c6c6, 0x9c68e, 0x9c671, 0x9c563, 0x9c6c3,
+    0x58e9c, 0x58e63, 0x58ee4, 0x58ee2, 0x58d71, 0x58d1e, 0x58d8e, 0x58d3c,
+    0x58ecc, 0x58d39, 0x58d9c, 0x58ec6, 0x58e8e, 0x58e71, 0x58d63, 0x58ec3,
+    0xb0e9c, 0xb0e63, 0xb0ee4, 0xb0ee2, 0xb0d71, 0xb0d1e, 0xb0d8e, 0xb0d3c,
+    0xb0ecc, 0xb0d39, 0xb0d9c, 0xb0ec6, 0xb0e8e, 0xb0e71, 0xb0d63, 0xb0ec3,
+};
+
+// Spreads bit k of a subpacket byte to bit 0 of the nibble that carries it,
+// in the order encode_subpacket() emits them: bits 0,2,4,6 then 1,3,5,7.
+// Shifting by the subpacket number interleaves all four subpackets.
+// Built statically with the following code
+// for (int i = 0; i < 256; ++i) { for (int k = 0; k < 8; ++k) { if (i >> k & 1) subpacketSpread_[i] |= 1u << (4 * ((k & 1) * 4 + k / 2)); } }
+const uint32_t __not_in_flash_func(subpacketSpread_)[256] = {
+    0x00000000, 0x00000001, 0x00010000, 0x00010001, 0x00000010, 0x00000011, 0x00010010, 0x00010011,
+    0x00100000, 0x00100001, 0x00110000, 0x00110001, 0x00100010, 0x00100011, 0x00110010, 0x00110011,
+    0x00000100, 0x00000101, 0x00010100, 0x00010101, 0x00000110, 0x00000111, 0x00010110, 0x00010111,
+    0x00100100, 0x00100101, 0x00110100, 0x00110101, 0x00100110, 0x00100111, 0x00110110, 0x00110111,
+    0x01000000, 0x01000001, 0x01010000, 0x01010001, 0x01000010, 0x01000011, 0x01010010, 0x01010011,
+    0x01100000, 0x01100001, 0x01110000, 0x01110001, 0x01100010, 0x01100011, 0x01110010, 0x01110011,
+    0x01000100, 0x01000101, 0x01010100, 0x01010101, 0x01000110, 0x01000111, 0x01010110, 0x01010111,
+    0x01100100, 0x01100101, 0x01110100, 0x01110101, 0x01100110, 0x01100111, 0x01110110, 0x01110111,
+    0x00001000, 0x00001001, 0x00011000, 0x00011001, 0x00001010, 0x00001011, 0x00011010, 0x00011011,
+    0x00101000, 0x00101001, 0x00111000, 0x00111001, 0x00101010, 0x00101011, 0x00111010, 0x00111011,
+    0x00001100, 0x00001101, 0x00011100, 0x00011101, 0x00001110, 0x00001111, 0x00011110, 0x00011111,
+    0x00101100, 0x00101101, 0x00111100, 0x00111101, 0x00101110, 0x00101111, 0x00111110, 0x00111111,
+    0x01001000, 0x01001001, 0x01011000, 0x01011001, 0x01001010, 0x01001011, 0x01011010, 0x01011011,
+    0x01101000, 0x01101001, 0x01111000, 0x01111001, 0x01101010, 0x01101011, 0x01111010, 0x01111011,
+    0x01001100, 0x01001101, 0x01011100, 0x01011101, 0x01001110, 0x01001111, 0x01011110, 0x01011111,
+    0x01101100, 0x01101101, 0x01111100, 0x01111101, 0x01101110, 0x01101111, 0x01111110, 0x01111111,
+    0x10000000, 0x10000001, 0x10010000, 0x10010001, 0x10000010, 0x10000011, 0x10010010, 0x10010011,
+    0x10100000, 0x10100001, 0x10110000, 0x10110001, 0x10100010, 0x10100011, 0x10110010, 0x10110011,
+    0x10000100, 0x10000101, 0x10010100, 0x10010101, 0x10000110, 0x10000111, 0x10010110, 0x10010111,
+    0x10100100, 0x10100101, 0x10110100, 0x10110101, 0x10100110, 0x10100111, 0x10110110, 0x10110111,
+    0x11000000, 0x11000001, 0x11010000, 0x11010001, 0x11000010, 0x11000011, 0x11010010, 0x11010011,
+    0x11100000, 0x11100001, 0x11110000, 0x11110001, 0x11100010, 0x11100011, 0x11110010, 0x11110011,
+    0x11000100, 0x11000101, 0x11010100, 0x11010101, 0x11000110, 0x11000111, 0x11010110, 0x11010111,
+    0x11100100, 0x11100101, 0x11110100, 0x11110101, 0x11100110, 0x11100111, 0x11110110, 0x11110111,
+    0x10001000, 0x10001001, 0x10011000, 0x10011001, 0x10001010, 0x10001011, 0x10011010, 0x10011011,
+    0x10101000, 0x10101001, 0x10111000, 0x10111001, 0x10101010, 0x10101011, 0x10111010, 0x10111011,
+    0x10001100, 0x10001101, 0x10011100, 0x10011101, 0x10001110, 0x10001111, 0x10011110, 0x10011111,
+    0x10101100, 0x10101101, 0x10111100, 0x10111101, 0x10101110, 0x10101111, 0x10111110, 0x10111111,
+    0x11001000, 0x11001001, 0x11011000, 0x11011001, 0x11001010, 0x11001011, 0x11011010, 0x11011011,
+    0x11101000, 0x11101001, 0x11111000, 0x11111001, 0x11101010, 0x11101011, 0x11111010, 0x11111011,
+    0x11001100, 0x11001101, 0x11011100, 0x11011101, 0x11001110, 0x11001111, 0x11011110, 0x11011111,
+    0x11101100, 0x11101101, 0x11111100, 0x11111101, 0x11101110, 0x11101111, 0x11111110, 0x11111111,
+};
+
 #define TERC4_0x2CharSym_ 0x000A729C // Build time generated -> makeTERC4x2Char(0);
 #define dataGaurdbandSym_ 0x0004CD33 // Build time generated -> 0b0100110011'0100110011;
 uint32_t __not_in_flash_func(defaultDataPacket12_)[N_DATA_ISLAND_WORDS] = {
@@ -116,12 +278,14 @@ uint32_t __not_in_flash_func(defaultDataPacket12_)[N_DATA_ISLAND_WORDS] = {
     dataGaurdbandSym_,
 };
 
-// This table is built in compilation time from a function that uses makeTERC4x2Char 
+// Null packet channel 0 for each hv = vsync << 1 | hsync, the same as encode()
+// gives: only the first packet symbol has bit 3 clear. Built statically with
+// encode(&s, &null_packet, hv >> 1, hv & 1); defaultDataPackets0_[hv] = s.data[0];
 uint32_t __not_in_flash_func(defaultDataPackets0_)[4][N_DATA_ISLAND_WORDS] = {
-    { 0xa3a8e, 0xa729c, 0xb32cc, 0xb32cc, 0xb32cc, 0xb32cc, 0xb32cc, 0xb32cc, 0xb32cc, 0xb32cc, 0xb32cc, 0xb32cc, 0xb32cc, 0xb32cc, 0xb32cc, 0xb32cc, 0xb32cc, 0xa3a8e},
-    { 0x9c671, 0x98e63, 0x4e539, 0x4e539, 0x4e539, 0x4e539, 0x4e539, 0x4e539, 0x4e539, 0x4e539, 0x4e539, 0x4e539, 0x4e539, 0x4e539, 0x4e539, 0x4e539, 0x4e539, 0x9c671}, 
-    { 0x58d63, 0xb92e4, 0x6719c, 0x6719c, 0x6719c, 0x6719c, 0x6719c, 0x6719c, 0x6719c, 0x6719c, 0x6719c, 0x6719c, 0x6719c, 0x6719c, 0x6719c, 0x6719c, 0x6719c, 0x58d63}, 
-    { 0xb0ec3, 0xb8ae2, 0xb1ac6, 0xb1ac6, 0xb1ac6, 0xb1ac6, 0xb1ac6, 0xb1ac6, 0xb1ac6, 0xb1ac6, 0xb1ac6, 0xb1ac6, 0xb1ac6, 0xb1ac6, 0xb1ac6, 0xb1ac6, 0xb1ac6, 0xb0ec3}
+    { 0xa3a8e, 0xb329c, 0xb32cc, 0xb32cc, 0xb32cc, 0xb32cc, 0xb32cc, 0xb32cc, 0xb32cc, 0xb32cc, 0xb32cc, 0xb32cc, 0xb32cc, 0xb32cc, 0xb32cc, 0xb32cc, 0xb32cc, 0xa3a8e},
+    { 0x9c671, 0x4e663, 0x4e539, 0x4e539, 0x4e539, 0x4e539, 0x4e539, 0x4e539, 0x4e539, 0x4e539, 0x4e539, 0x4e539, 0x4e539, 0x4e539, 0x4e539, 0x4e539, 0x4e539, 0x9c671}, 
+    { 0x58d63, 0x672e4, 0x6719c, 0x6719c, 0x6719c, 0x6719c, 0x6719c, 0x6719c, 0x6719c, 0x6719c, 0x6719c, 0x6719c, 0x6719c, 0x6719c, 0x6719c, 0x6719c, 0x6719c, 0x58d63}, 
+    { 0xb0ec3, 0xb1ae2, 0xb1ac6, 0xb1ac6, 0xb1ac6, 0xb1ac6, 0xb1ac6, 0xb1ac6, 0xb1ac6, 0xb1ac6, 0xb1ac6, 0xb1ac6, 0xb1ac6, 0xb1ac6, 0xb1ac6, 0xb1ac6, 0xb1ac6, 0xb0ec3}
 };
 
 uint32_t *__not_in_flash_func(getDefaultDataPacket0)(bool vsync, bool hsync) {
@@ -181,18 +345,15 @@ void __not_in_flash_func(encode_header)(const data_packet_t *data_packet, uint32
 
 void __not_in_flash_func(encode_subpacket)(const data_packet_t *data_packet, uint32_t *dst1, uint32_t *dst2) {
     for (int i = 0; i < 8; ++i) {
-        uint32_t v = (data_packet->subpacket[0][i] << 0)  | (data_packet->subpacket[1][i] << 8) |
-                     (data_packet->subpacket[2][i] << 16) | (data_packet->subpacket[3][i] << 24);
-        uint32_t t = (v ^ (v >> 7)) & 0x00aa00aa;
-        v = v ^ t ^ (t << 7);
-        t = (v ^ (v >> 14)) & 0x0000cccc;
-        v = v ^ t ^ (t << 14);
-        // 01234567 89abcdef ghijklmn opqrstuv
-        // 08go4cks 19hp5dlt 2aiq6emu 3bjr7fnv
-        dst1[0] = makeTERC4x2Char_2((v >> 0) & 15,  (v >> 16) & 15);
-        dst1[1] = makeTERC4x2Char_2((v >> 4) & 15,  (v >> 20) & 15);
-        dst2[0] = makeTERC4x2Char_2((v >> 8) & 15,  (v >> 24) & 15);
-        dst2[1] = makeTERC4x2Char_2((v >> 12) & 15, (v >> 28) & 15);
+        // Each byte holds the TERC4 nibble pair for one output word
+        uint32_t v = subpacketSpread_[data_packet->subpacket[0][i]]        |
+                     (subpacketSpread_[data_packet->subpacket[1][i]] << 1) |
+                     (subpacketSpread_[data_packet->subpacket[2][i]] << 2) |
+                     (subpacketSpread_[data_packet->subpacket[3][i]] << 3);
+        dst1[0] = TERC4PairSyms_[v & 0xff];
+        dst1[1] = TERC4PairSyms_[(v >> 8) & 0xff];
+        dst2[0] = TERC4PairSyms_[(v >> 16) & 0xff];
+        dst2[1] = TERC4PairSyms_[v >> 24];
         dst1 += 2;
         dst2 += 2;
     }
@@ -202,7 +363,42 @@ void __not_in_flash_func(set_null)(data_packet_t *data_packet) {
     memset(data_packet, 0, sizeof(data_packet_t));
 }
 
-int  __not_in_flash_func(set_audio_sample)(data_packet_t *data_packet, const audio_sample_t *p, int n, int frameCt) {
+// Channel status bit for IEC 60958 frame f (0..191) of the left channel. The
+// right channel only differs in the channel number (byte 2), which is 1 for
+// left and 2 for right, so bits 20 and 21 are swapped.
+static inline bool channel_status_bit(const uint8_t *status, int f) {
+    return status ? (status[f >> 3] >> (f & 7)) & 1 : 0;
+}
+
+static inline void set_audio_subpacket(uint8_t *d, const audio_sample_t *p, const uint8_t *status, int f) {
+    const int16_t l = (*p).channels[0];
+    const int16_t r = (*p).channels[1];
+    // V = 0 marks the sample as valid, U is unused
+    const bool cl = channel_status_bit(status, f);
+    const bool cr = (f == 20 || f == 21) ? !cl : cl;
+    d[0] = 0;
+    d[1] = l;
+    d[2] = l >> 8;
+    d[3] = 0;
+    d[4] = r;
+    d[5] = r >> 8;
+
+    bool pl = compute8_2(d[1], d[2]) ^ cl;
+    bool pr = compute8_2(d[4], d[5]) ^ cr;
+    d[6] = (cl << 2) | (pl << 3) | (cr << 6) | (pr << 7);
+    d[7] = bchAudioTable_[0][d[1]] ^ bchAudioTable_[1][d[2]] ^
+           bchAudioTable_[2][d[4]] ^ bchAudioTable_[3][d[5]] ^
+           bchAudioStatusTable_[cl | (pl << 1) | (cr << 2) | (pr << 3)];
+}
+
+// IEC 60958 frame number of sample i in a packet: frameCt counts down to the
+// next block start, which is flagged with B.
+static inline int audio_frame_index(int frameCt, int i) {
+    int f = i - frameCt;
+    return f < 0 ? f + 192 : f;
+}
+
+int  __not_in_flash_func(set_audio_sample)(data_packet_t *data_packet, const audio_sample_t *p, int n, int frameCt, const uint8_t *channel_status) {
     const int layout = 0;
     const int samplePresent = (1 << n) - 1;
     const int B = frameCt < 4 ? 1 << frameCt : 0;
@@ -213,23 +409,8 @@ int  __not_in_flash_func(set_audio_sample)(data_packet_t *data_packet, const aud
 
     for (int i = 0; i < n; ++i)
     {
-        const int16_t l = (*p).channels[0];
-        const int16_t r = (*p).channels[1];
-        const uint8_t vuc = 1; // valid
-        uint8_t *d = data_packet->subpacket[i];
-        d[0] = 0;
-        d[1] = l;
-        d[2] = l >> 8;
-        d[3] = 0;
-        d[4] = r;
-        d[5] = r >> 8;
-
-        bool pl = compute8_3(d[1], d[2], vuc);
-        bool pr = compute8_3(d[4], d[5], vuc);
-        d[6] = (vuc << 0) | (pl << 3) | (vuc << 4) | (pr << 7);
-        compute_subpacket_parity(data_packet, i);
+        set_audio_subpacket(data_packet->subpacket[i], p, channel_status, audio_frame_index(frameCt, i));
         ++p;
-        // channel status (is it relevant?)
     }
     memset(data_packet->subpacket[n], 0, sizeof(data_packet->subpacket[0]) * (4 - n));
     // dump();
@@ -261,6 +442,91 @@ void set_audio_clock_regeneration(data_packet_t *data_packet, int cts, int n) {
     memcpy(data_packet->subpacket[3], data_packet->subpacket[0], sizeof(data_packet->subpacket[0]));
 }
 
+static uint32_t gcd_u32(uint32_t a, uint32_t b) {
+    while (b) {
+        uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// HDMI 1.4 section 7.2: 128 * fs = f_pixel * N / CTS, with N ideally close to
+// 128 * fs / 1000 and within [128 * fs / 1500, 128 * fs / 300]. CTS is only
+// exact when f_pixel * N is a multiple of 128 * fs, i.e. when N is a multiple
+// of 128 * fs / gcd(f_pixel, 128 * fs). Take the multiple nearest the N the
+// spec recommends, so sinks see a constant CTS and need no averaging.
+bool dvi_audio_compute_n_cts(uint32_t pixel_clock_hz, int audio_freq, int *n, int *cts) {
+    const uint32_t fs128 = 128u * (uint32_t)audio_freq;
+    int n_rec;
+    switch (audio_freq) {
+    case 32000: n_rec = 4096; break;
+    case 44100: n_rec = 6272; break;
+    case 48000: n_rec = 6144; break;
+    case 88200: n_rec = 12544; break;
+    case 96000: n_rec = 12288; break;
+    case 176400: n_rec = 25088; break;
+    case 192000: n_rec = 24576; break;
+    default: n_rec = (fs128 + 500) / 1000; break;
+    }
+    const uint32_t n_min = (fs128 + 1499) / 1500;
+    const uint32_t n_max = fs128 / 300;
+
+    const uint32_t g = gcd_u32(pixel_clock_hz, fs128);
+    const uint32_t step = fs128 / g;
+    const uint32_t below = (n_rec / step) * step;
+    const uint32_t above = below + step;
+    uint32_t best = 0;
+    if (below >= n_min) {
+        best = below;
+    }
+    if (above <= n_max && (!best || above - n_rec < n_rec - below)) {
+        best = above;
+    }
+    if (best) {
+        *n = best;
+        *cts = (pixel_clock_hz / g) * (best / step);
+        return true;
+    }
+    *n = n_rec;
+    *cts = ((uint64_t)pixel_clock_hz * n_rec + fs128 / 2) / fs128;
+    return false;
+}
+
+// IEC 60958-3 consumer channel status for 2ch 16 bit L-PCM, left channel
+void set_audio_channel_status(uint8_t *status, int freq) {
+    memset(status, 0, AUDIO_CHANNEL_STATUS_BYTES);
+    status[0] = 1 << 2;                 // consumer, L-PCM, no copyright, no pre-emphasis
+    status[2] = 1 << 4;                 // channel number 1 (left)
+    switch (freq) {                     // sampling frequency, bits 24-27
+    case 22050: status[3] = 0x4; break;
+    case 24000: status[3] = 0x6; break;
+    case 44100: status[3] = 0x0; break;
+    case 48000: status[3] = 0x2; break;
+    case 32000: status[3] = 0x3; break;
+    case 88200: status[3] = 0x8; break;
+    case 96000: status[3] = 0xa; break;
+    case 176400: status[3] = 0xc; break;
+    case 192000: status[3] = 0xe; break;
+    default: status[3] = 0x1; break;    // not indicated
+    }
+    status[4] = 1 << 1;                 // 16 bit word length (max 20)
+}
+
+// CEA-861 audio infoframe sample frequency code, 0 = refer to stream header
+static int audio_info_frame_sample_freq(int freq) {
+    switch (freq) {
+    case 32000: return 1;
+    case 44100: return 2;
+    case 48000: return 3;
+    case 88200: return 4;
+    case 96000: return 5;
+    case 176400: return 6;
+    case 192000: return 7;
+    default: return 0;
+    }
+}
+
 void set_audio_info_frame(data_packet_t *data_packet, int freq) {
     set_null(data_packet);
     data_packet->header[0] = 0x84;
@@ -270,7 +536,7 @@ void set_audio_info_frame(data_packet_t *data_packet, int freq) {
     const int cc = 1; // 2ch
     const int ct = 1; // IEC 60958 PCM
     const int ss = 1; // 16bit
-    const int sf = freq == 48000 ? 3 : (freq == 44100 ? 2 : 0);
+    const int sf = audio_info_frame_sample_freq(freq);
     const int ca = 0;  // FR, FL
     const int lsv = 0; // 0db
     const int dm_inh = 0;
@@ -302,16 +568,54 @@ void set_AVI_info_frame(data_packet_t *data_packet, scan_info s, pixel_format y,
     compute_parity(data_packet);
 }
 
-void encode(data_island_stream_t *dst, const data_packet_t *packet, bool vsync, bool hsync) {
-    int hv = (vsync ? 2 : 0) | (hsync ? 1 : 0);
+static inline void encode_guardbands(data_island_stream_t *dst, int hv) {
     dst->data[0][0] = makeTERC4x2Char(0b1100 | hv);
     dst->data[1][0] = dataGaurdbandSym_;
     dst->data[2][0] = dataGaurdbandSym_;
 
-    encode_header(packet, &dst->data[0][1], hv, true);
-    encode_subpacket(packet, &dst->data[1][1], &dst->data[2][1]);
-
     dst->data[0][N_DATA_ISLAND_WORDS - 1] = makeTERC4x2Char(0b1100 | hv);
     dst->data[1][N_DATA_ISLAND_WORDS - 1] = dataGaurdbandSym_;
     dst->data[2][N_DATA_ISLAND_WORDS - 1] = dataGaurdbandSym_;
+}
+
+void __not_in_flash_func(encode)(data_island_stream_t *dst, const data_packet_t *packet, bool vsync, bool hsync) {
+    int hv = (vsync ? 2 : 0) | (hsync ? 1 : 0);
+    encode_guardbands(dst, hv);
+    encode_header(packet, &dst->data[0][1], hv, true);
+    encode_subpacket(packet, &dst->data[1][1], &dst->data[2][1]);
+}
+
+int __not_in_flash_func(encode_audio_sample_packet)(data_island_stream_t *dst, const audio_sample_t *p, int n, int frameCt, const uint8_t *channel_status, bool vsync, bool hsync) {
+    // The header only depends on the sample count, the frame start flag and
+    // the sync levels, so consecutive packets almost always share it. Keep
+    // the last encoded header around. Not reentrant: one encoder at a time.
+    static uint32_t cached_key = UINT32_MAX;
+    static uint32_t cached_header[16];
+
+    int hv = (vsync ? 2 : 0) | (hsync ? 1 : 0);
+    const int B = frameCt < 4 ? 1 << frameCt : 0;
+    const uint32_t key = (uint32_t)n | ((uint32_t)B << 4) | ((uint32_t)hv << 8);
+    data_packet_t packet;
+    if (key != cached_key) {
+        packet.header[0] = 2;
+        packet.header[1] = (1 << n) - 1;    // layout 0, sample present bits
+        packet.header[2] = B << 4;
+        compute_header_parity(&packet);
+        encode_header(&packet, cached_header, hv, true);
+        cached_key = key;
+    }
+    encode_guardbands(dst, hv);
+    memcpy(&dst->data[0][1], cached_header, sizeof(cached_header));
+
+    for (int i = 0; i < n; ++i) {
+        set_audio_subpacket(packet.subpacket[i], p++, channel_status, audio_frame_index(frameCt, i));
+    }
+    memset(packet.subpacket[n], 0, sizeof(packet.subpacket[0]) * (4 - n));
+    encode_subpacket(&packet, &dst->data[1][1], &dst->data[2][1]);
+
+    frameCt -= n;
+    if (frameCt < 0) {
+        frameCt += 192;
+    }
+    return frameCt;
 }
\ No newline at end of file
@@ -20,6 +20,7 @@
 
 #define W_DATA_ISLAND        (W_GUARDBAND * 2 + W_DATA_PACKET)
 #define N_DATA_ISLAND_WORDS  (W_DATA_ISLAND / DVI_SYMBOLS_PER_WORD)
+#define AUDIO_CHANNEL_STATUS_BYTES 24   // one 192 frame IEC 60958 block
 
 typedef enum {
     SCAN_INFO_NO_DATA,
@@ -84,8 +85,13 @@ void compute_info_frame_checkSum(data_packet_t *data_packet);
 void encode_header(const data_packet_t *data_packet, uint32_t *dst, int hv, bool firstPacket);
 void encode_subpacket(const data_packet_t *data_packet, uint32_t *dst1, uint32_t *dst2);
 void set_null(data_packet_t *data_packet);
-int  set_audio_sample(data_packet_t *data_packet, const audio_sample_t *p, int n, int frameCt);
+int  set_audio_sample(data_packet_t *data_packet, const audio_sample_t *p, int n, int frameCt, const uint8_t *channel_status);
+void set_audio_channel_status(uint8_t *status, int freq);
 void set_audio_clock_regeneration(data_packet_t *data_packet, int CTS, int N);
+// Pick N and CTS for audio clock regeneration so that CTS is exact for this
+// pixel clock. Returns false if no N in the allowed range gives an integer CTS,
+// in which case the recommended N and the nearest CTS are returned.
+bool dvi_audio_compute_n_cts(uint32_t pixel_clock_hz, int audio_freq, int *n, int *cts);
 void set_audio_info_frame(data_packet_t *data_packet, int freq);
 void set_AVI_info_frame(data_packet_t *data_packet, scan_info s, pixel_format y, colorimetry c, picture_aspect_ratio m,
     active_format_aspect_ratio r, RGB_quantization_range q, video_code vic);
@@ -97,4 +103,6 @@ inline uint32_t *getDefaultDataPacket12() {
 }
 uint32_t *getDefaultDataPacket0(bool vsync, bool hsync);
 void encode(data_island_stream_t *dst, const data_packet_t *packet, bool vsync, bool hsync);
+// Fast path equivalent to set_audio_sample() followed by encode(). Returns the new frame count.
+int  encode_audio_sample_packet(data_island_stream_t *dst, const audio_sample_t *p, int n, int frameCt, const uint8_t *channel_status, bool vsync, bool hsync);
 #endif
@@ -2,7 +2,16 @@
 #include "hardware/dma.h"
 #include "hardware/irq.h"
 #include "hardware/gpio.h"
+#include "hardware/sync.h"
 #include "pico/time.h"
+#if PICO_RP2040
+#include "hardware/regs/m0plus.h"
+#else
+#include "hardware/structs/nvic.h"
+#endif
+#if DVI_COLLECT_STATS
+#include "hardware/structs/systick.h"
+#endif
 
 #include "dvi.h"
 #include "dvi_timing.h"
@@ -20,11 +29,92 @@
 static struct dvi_inst *dma_irq_privdata[2];
 static void dvi_dma0_irq();
 static void dvi_dma1_irq();
+#if DVI_DATA_ISLAND_USE_SPARE_IRQ
+static struct dvi_inst *data_island_irq_privdata;
+static void dvi_data_island_irq();
+#endif
+
+static_assert((DVI_DATA_ISLAND_QUEUE_LEN & (DVI_DATA_ISLAND_QUEUE_LEN - 1)) == 0,
+    "DVI_DATA_ISLAND_QUEUE_LEN must be a power of 2");
+
+// irq_set_pending() lives in flash. The DMA IRQ must not touch flash during
+// vblank, so the application can program flash then (dvi_vblank_lines_remaining)
+static inline void _dvi_irq_set_pending(uint num) {
+#if PICO_RP2040
+    *((io_rw_32 *)(PPB_BASE + M0PLUS_NVIC_ISPR_OFFSET)) = 1u << num;
+#else
+    nvic_hw->ispr[num / 32] = 1u << (num % 32);
+#endif
+}
+
+// Timing state after `seq` calls to dvi_timing_state_advance() from the
+// state set by dvi_timing_state_init()
+static void __dvi_func(_dvi_timing_state_for_line)(const struct dvi_timing *t, uint32_t seq, struct dvi_timing_state *s) {
+    const uint lengths[DVI_STATE_COUNT] = {
+        [DVI_STATE_FRONT_PORCH] = t->v_front_porch,
+        [DVI_STATE_SYNC]        = t->v_sync_width,
+        [DVI_STATE_BACK_PORCH]  = t->v_back_porch,
+        [DVI_STATE_ACTIVE]      = t->v_active_lines,
+    };
+    uint line = seq % (t->v_front_porch + t->v_sync_width + t->v_back_porch + t->v_active_lines);
+    s->v_state = DVI_STATE_FRONT_PORCH;
+    while (line >= lengths[s->v_state]) {
+        line -= lengths[s->v_state];
+        s->v_state = (s->v_state + 1) % DVI_STATE_COUNT;
+    }
+    s->v_ctr = line;
+}
+
+#if DVI_TMDS_POOL_BYTES
+static uint32_t __uninitialized_ram(dvi_tmds_pool)[DVI_TMDS_POOL_BYTES / sizeof(uint32_t)];
+#endif
+
+static void _dvi_alloc_tmds_buffers(struct dvi_inst *inst) {
+#if DVI_MONOCHROME_TMDS
+    const uint buf_words = inst->timing->h_active_pixels / DVI_SYMBOLS_PER_WORD;
+#else
+    const uint buf_words = TMDS_CHANNELS * inst->timing->h_active_pixels / DVI_SYMBOLS_PER_WORD;
+#endif
+#if DVI_TMDS_POOL_BYTES
+    if (DVI_N_TMDS_BUFFERS * buf_words > count_of(dvi_tmds_pool)) {
+        panic("TMDS buffer pool too small for this timing");
+    }
+#endif
+    for (int i = 0; i < DVI_N_TMDS_BUFFERS; ++i) {
+#if DVI_TMDS_POOL_BYTES
+        void *tmdsbuf = &dvi_tmds_pool[i * buf_words];
+#else
+        void *tmdsbuf = malloc(buf_words * sizeof(uint32_t));
+#endif
+        if (!tmdsbuf) {
+            panic("TMDS buffer allocation failed");
+        }
+        queue_add_blocking_u32(&inst->q_tmds_free, &tmdsbuf);
+    }
+}
+
+static void _dvi_free_tmds_buffer(uint32_t *tmdsbuf) {
+#if DVI_TMDS_POOL_BYTES
+    (void)tmdsbuf;  // the pool is carved again for the next timing
+#else
+    free(tmdsbuf);
+#endif
+}
+
+static void _dvi_set_lane_words(struct dvi_inst *inst) {
+#if DVI_MONOCHROME_TMDS
+    inst->tmds_lane_words = 0;
+#else
+    inst->tmds_lane_words = inst->timing->h_active_pixels / DVI_SYMBOLS_PER_WORD;
+#endif
+}
 
 void dvi_init(struct dvi_inst *inst, uint spinlock_tmds_queue, uint spinlock_colour_queue) {
     inst->dvi_started = false;
     inst->timing_state.v_ctr  = 0;
     inst->dvi_frame_count = 0;
+    inst->line_seq = 0;
+    inst->data_island_irq = -1;
     
     dvi_audio_init(inst);
     dvi_timing_state_init(&inst->timing_state);
@@ -36,8 +126,31 @@ void dvi_init(struct dvi_inst *inst, uint spinlock_tmds_queue, uint spinlock_col
         inst->dma_cfg[i].dreq = pio_get_dreq(inst->ser_cfg.pio, inst->ser_cfg.sm_tmds[i], true);
     }
     inst->late_scanline_ctr = 0;
+    _dvi_set_lane_words(inst);
+    inst->line_release_map = NULL;
+    dvi_set_scanline_count(inst, inst->timing->v_active_lines / DVI_VERTICAL_REPEAT);
+    inst->scanline_ctr = 0;
+    inst->gap_line = NULL;
+    inst->gap_first = 0;
+    inst->gap_count = 0;
+#if DVI_COLLECT_STATS
+    inst->late_scanline_total = 0;
+    inst->late_frame_total = 0;
+    inst->late_scanlines_last_frame = 0;
+    inst->repeated_line_total = 0;
+    inst->late_scanlines_this_frame = 0;
+    inst->lane_wait_total = 0;
+    inst->list_cycles_max = 0;
+    inst->irq_cycles_max = 0;
+    inst->irq_cycles_total = 0;
+    inst->irq_count = 0;
+    inst->data_island_cycles_max = 0;
+#endif
     inst->tmds_buf_release[0] = NULL;
     inst->tmds_buf_release[1] = NULL;
+#if DVI_REPEAT_LATE_SCANLINE
+    inst->tmds_buf_held = NULL;
+#endif
     queue_init_with_spinlock(&inst->q_tmds_valid,   sizeof(void*),  8, spinlock_tmds_queue);
     queue_init_with_spinlock(&inst->q_tmds_free,    sizeof(void*),  8, spinlock_tmds_queue);
     queue_init_with_spinlock(&inst->q_colour_valid, sizeof(void*),  8, spinlock_colour_queue);
@@ -49,17 +162,7 @@ void dvi_init(struct dvi_inst *inst, uint spinlock_tmds_queue, uint spinlock_col
     dvi_setup_scanline_for_active(inst->timing, inst->dma_cfg, NULL, &inst->dma_list_error, false);
     dvi_setup_scanline_for_active(inst->timing, inst->dma_cfg, NULL, &inst->dma_list_active_blank, true);
 
-    for (int i = 0; i < DVI_N_TMDS_BUFFERS; ++i) {
-#if DVI_MONOCHROME_TMDS
-        void *tmdsbuf = malloc(inst->timing->h_active_pixels / DVI_SYMBOLS_PER_WORD * sizeof(uint32_t));
-#else
-        void *tmdsbuf = malloc(TMDS_CHANNELS * inst->timing->h_active_pixels / DVI_SYMBOLS_PER_WORD * sizeof(uint32_t));
-#endif
-        if (!tmdsbuf) {
-            panic("TMDS buffer allocation failed");
-        }
-        queue_add_blocking_u32(&inst->q_tmds_free, &tmdsbuf);
-    }
+    _dvi_alloc_tmds_buffers(inst);
 
     set_AVI_info_frame(&inst->avi_info_frame, UNDERSCAN, RGB, ITU601, PIC_ASPECT_RATIO_4_3, SAME_AS_PAR, FULL, _640x480P60);
 
@@ -69,6 +172,18 @@ void dvi_init(struct dvi_inst *inst, uint spinlock_tmds_queue, uint spinlock_col
 // The IRQs will run on whichever core calls this function (this is why it's
 // called separately from dvi_init)
 void dvi_register_irqs_this_core(struct dvi_inst *inst, uint irq_num) {
+#if DVI_COLLECT_STATS
+    // Free-running 24-bit down counter at the system clock for the cycle
+    // counts. Only differences are used, so the wrap (~66 ms at 252 MHz)
+    // doesn't matter for anything as short as an IRQ.
+    systick_hw->rvr = 0x00ffffffu;
+    systick_hw->cvr = 0;
+#if PICO_RP2040
+    systick_hw->csr = M0PLUS_SYST_CSR_CLKSOURCE_BITS | M0PLUS_SYST_CSR_ENABLE_BITS;
+#else
+    systick_hw->csr = M33_SYST_CSR_CLKSOURCE_BITS | M33_SYST_CSR_ENABLE_BITS;
+#endif
+#endif
     uint32_t mask_sync_channel = 1u << inst->dma_cfg[TMDS_SYNC_LANE].chan_data;
     uint32_t mask_all_channels = 0;
     for (int i = 0; i < N_TMDS_LANES; ++i)
@@ -98,8 +213,21 @@ void dvi_register_irqs_this_core(struct dvi_inst *inst, uint irq_num) {
     }
 
 #if !DVI_USE_SHARED_DMA_IRQ
+    irq_set_priority(irq_num, DVI_DMA_IRQ_PRIORITY);
     irq_set_enabled(irq_num, true);
 #endif
+
+#if DVI_DATA_ISLAND_USE_SPARE_IRQ
+    // Data island encoding runs from a software IRQ on this core, pended by
+    // the scanline IRQ, so it can be preempted by the next scanline IRQ.
+    if (inst->data_island_irq < 0) {
+        inst->data_island_irq = user_irq_claim_unused(true);
+        data_island_irq_privdata = inst;
+        irq_set_exclusive_handler(inst->data_island_irq, dvi_data_island_irq);
+        irq_set_priority(inst->data_island_irq, DVI_DATA_ISLAND_IRQ_PRIORITY);
+        irq_set_enabled(inst->data_island_irq, true);
+    }
+#endif
 }
 
 void dvi_unregister_irqs_this_core(struct dvi_inst *inst, uint irq_num) {
@@ -113,6 +241,14 @@ void dvi_unregister_irqs_this_core(struct dvi_inst *inst, uint irq_num) {
 #else
     (void)inst;
     (void)irq_num;
+#endif
+#if DVI_DATA_ISLAND_USE_SPARE_IRQ
+    if (inst->data_island_irq >= 0) {
+        irq_set_enabled(inst->data_island_irq, false);
+        irq_remove_handler(inst->data_island_irq, dvi_data_island_irq);
+        user_irq_unclaim(inst->data_island_irq);
+        inst->data_island_irq = -1;
+    }
 #endif
     if (inst->tmds_buf_release[1]) {
         queue_try_add_u32(&inst->q_tmds_free, &inst->tmds_buf_release[1]);
@@ -122,12 +258,19 @@ void dvi_unregister_irqs_this_core(struct dvi_inst *inst, uint irq_num) {
     }
     inst->tmds_buf_release[1] = NULL;
     inst->tmds_buf_release[0] = NULL;
+#if DVI_REPEAT_LATE_SCANLINE
+    if (inst->tmds_buf_held) {
+        queue_try_add_u32(&inst->q_tmds_free, &inst->tmds_buf_held);
+        inst->tmds_buf_held = NULL;
+    }
+#endif
 }
 // JOE MODIFICATION END
 
 // Set up control channels to make transfers to data channels' control
 // registers (but don't trigger the control channels -- this is done either by
-// data channel CHAIN_TO or an initial write to MULTI_CHAN_TRIGGER)
+// data channel CHAIN_TO or an initial write to MULTI_CHAN_TRIGGER). Only
+// needed once, in dvi_start(); after that see _dvi_point_dma_op().
 static inline void __attribute__((always_inline)) _dvi_load_dma_op(const struct dvi_lane_dma_cfg dma_cfg[], struct dvi_scanline_dma_list *l) {
     for (int i = 0; i < N_TMDS_LANES; ++i) {
         dma_channel_config cfg = dma_channel_get_default_config(dma_cfg[i].chan_ctrl);
@@ -145,6 +288,31 @@ static inline void __attribute__((always_inline)) _dvi_load_dma_op(const struct
     }
 }
 
+// Point idle control channels at the next list. Everything else set up by
+// _dvi_load_dma_op() survives a block load: the config (EN stays set), the
+// transfer count (reloaded on every trigger) and the write address, which the
+// 16-byte ring brings back to the data channel's READ_ADDR after the 4 words.
+// So per scanline only READ_ADDR changes, and the data channel's CHAIN_TO
+// triggers the load at the end of the line as before.
+static inline void __attribute__((always_inline)) _dvi_point_dma_op(const struct dvi_lane_dma_cfg dma_cfg[], struct dvi_scanline_dma_list *l) {
+    for (int i = 0; i < N_TMDS_LANES; ++i) {
+        dma_channel_set_read_addr(dma_cfg[i].chan_ctrl, dvi_lane_from_list(l, i), false);
+    }
+}
+
+// dvi_update_scanline_data_dma() for dma_list_active, inlined, with the lane
+// stride worked out in advance
+static inline void __attribute__((always_inline)) _dvi_set_active_tmdsbuf(struct dvi_inst *inst, const uint32_t *tmdsbuf) {
+    const bool audio = inst->data_island_is_enabled;
+    for (int i = 0; i < N_TMDS_LANES; ++i) {
+        const uint32_t *lane_tmdsbuf = tmdsbuf + i * inst->tmds_lane_words;
+        if (i == TMDS_SYNC_LANE)
+            dvi_lane_from_list(&inst->dma_list_active, i)[audio ? 5 : 3].read_addr = lane_tmdsbuf;
+        else
+            dvi_lane_from_list(&inst->dma_list_active, i)[audio ? 6 : 1].read_addr = lane_tmdsbuf;
+    }
+}
+
 // Setup first set of control block lists, configure the control channels, and
 // trigger them. Control channels will subsequently be triggered only by DMA
 // CHAIN_TO on data channel completion. IRQ handler *must* be prepared before
@@ -238,18 +406,26 @@ void __dvi_func(dvi_scanbuf_main_16bpp)(struct dvi_inst *inst) {
 }
 
 static void __dvi_func(dvi_dma_irq_handler)(struct dvi_inst *inst) {
+#if DVI_COLLECT_STATS
+    const uint32_t irq_start = systick_hw->cvr;
+#endif
     // Every fourth interrupt marks the start of the horizontal active region. We
     // now have until the end of this region to generate DMA blocklist for next
     // scanline.
     dvi_timing_state_advance(inst->timing, &inst->timing_state);
-    
-    // Make sure all three channels have definitely loaded their last block
-    // (should be within a few cycles of one another)
-    for (int i = 0; i < N_TMDS_LANES; ++i) {
-        while (dma_debug_hw->ch[inst->dma_cfg[i].chan_data].dbg_tcr != inst->timing->h_active_pixels / DVI_SYMBOLS_PER_WORD) {
-            tight_loop_contents();
-        }    
-    }
+
+    // Nothing before the lane check below touches a DMA list or the control
+    // channels. That work (queues, buffer choice) takes far longer than the
+    // few cycles between the lanes loading their active blocks, so by the
+    // time the lists are touched all three lanes are idle. See the check.
+
+    // The previous line's data island has been read out by now, so its
+    // queue entry may be reused once the encoder sees this count.
+    const uint32_t line_seq = inst->line_seq + 1;
+    inst->line_seq = line_seq;
+    struct dvi_scanline_dma_list *dma_list;
+    const uint32_t *active_tmdsbuf = NULL;   // buffer for dma_list_active
+    bool consumed = false;                   // last line of a scanline buffer
 
     if (inst->tmds_buf_release[1] && !queue_try_add_u32(&inst->q_tmds_free, &inst->tmds_buf_release[1])) {
         panic("TMDS free queue full in IRQ!");
@@ -268,6 +444,25 @@ static void __dvi_func(dvi_dma_irq_handler)(struct dvi_inst *inst) {
     switch (inst->timing_state.v_state) {
         case DVI_STATE_ACTIVE:
         {
+            const uint v_ctr = inst->timing_state.v_ctr;
+            if (v_ctr == 0) {
+                inst->scanline_ctr = 0;
+#if DVI_COLLECT_STATS
+                inst->late_scanlines_last_frame = inst->late_scanlines_this_frame;
+                if (inst->late_scanlines_this_frame) {
+                    ++inst->late_frame_total;
+                }
+                inst->late_scanlines_this_frame = 0;
+#endif
+            }
+            // Last output line of this scanline buffer: consume it afterwards
+            const bool last_repeat = (inst->line_release_map[v_ctr >> 5] >> (v_ctr & 31)) & 1u;
+            const uint32_t *gap_line = inst->gap_line;
+            if (gap_line && !(last_repeat && v_ctr > 0 &&
+                              !((inst->line_release_map[(v_ctr - 1) >> 5] >> ((v_ctr - 1) & 31)) & 1u) &&
+                              inst->scanline_ctr - inst->gap_first < inst->gap_count)) {
+                gap_line = NULL;
+            }
             bool is_blank_line = false;
             if (inst->timing_state.v_ctr < inst->blank_settings.top ||
                 inst->timing_state.v_ctr >= (inst->timing->v_active_lines - inst->blank_settings.bottom))
@@ -279,19 +474,42 @@ static void __dvi_func(dvi_dma_irq_handler)(struct dvi_inst *inst) {
             {
                 if (queue_try_peek_u32(&inst->q_tmds_valid, &tmdsbuf))
                 {
-                    if (inst->timing_state.v_ctr % DVI_VERTICAL_REPEAT == DVI_VERTICAL_REPEAT - 1)
+                    if (last_repeat)
                     {
                         queue_remove_blocking_u32(&inst->q_tmds_valid, &tmdsbuf);
+#if DVI_REPEAT_LATE_SCANLINE
+                        // Keep it for a late successor; let the previous one go
+                        inst->tmds_buf_release[0] = inst->tmds_buf_held;
+                        inst->tmds_buf_held = tmdsbuf;
+#else
                         inst->tmds_buf_release[0] = tmdsbuf;
+#endif
                     }
                 }
                 else
                 {
+#if DVI_REPEAT_LATE_SCANLINE
+                    // No valid scanline was ready: show the last one again,
+                    // or the solid error line if there isn't one yet
+                    tmdsbuf = inst->tmds_buf_held;
+#if DVI_COLLECT_STATS
+                    if (tmdsbuf) {
+                        ++inst->repeated_line_total;
+                    }
+#endif
+#else
                     // No valid scanline was ready (generates solid red scanline)
                     tmdsbuf = NULL;
-                    if (inst->timing_state.v_ctr % DVI_VERTICAL_REPEAT == DVI_VERTICAL_REPEAT - 1)
+#endif
+                    if (last_repeat)
                     {
+                        // The late buffer is dropped when it turns up, so
+                        // the lines after it stay in the right place
                         ++inst->late_scanline_ctr;
+#if DVI_COLLECT_STATS
+                        ++inst->late_scanline_total;
+                        ++inst->late_scanlines_this_frame;
+#endif
                     }
                 }
 
@@ -303,39 +521,107 @@ static void __dvi_func(dvi_dma_irq_handler)(struct dvi_inst *inst) {
 
             if (is_blank_line)
             {
-                _dvi_load_dma_op(inst->dma_cfg, &inst->dma_list_active_blank);
+                dma_list = &inst->dma_list_active_blank;
             }
-            else if (tmdsbuf)
+            else if (gap_line)
             {
-                dvi_update_scanline_data_dma(inst->timing, tmdsbuf, &inst->dma_list_active, inst->data_island_is_enabled);
-                _dvi_load_dma_op(inst->dma_cfg, &inst->dma_list_active);
+                active_tmdsbuf = gap_line;
+                dma_list = &inst->dma_list_active;
             }
-            else
+            else if (tmdsbuf)
             {
-                _dvi_load_dma_op(inst->dma_cfg, &inst->dma_list_error);
+                active_tmdsbuf = tmdsbuf;
+                dma_list = &inst->dma_list_active;
             }
-            if (inst->scanline_callback && inst->timing_state.v_ctr % DVI_VERTICAL_REPEAT == DVI_VERTICAL_REPEAT - 1)
+            else
             {
-                inst->scanline_callback(inst->timing_state.v_ctr / DVI_VERTICAL_REPEAT);
+                dma_list = &inst->dma_list_error;
             }
+            consumed = last_repeat;
         }
         break;
 
         case DVI_STATE_SYNC:
-            _dvi_load_dma_op(inst->dma_cfg, &inst->dma_list_vblank_sync);
+            dma_list = &inst->dma_list_vblank_sync;
             if (inst->timing_state.v_ctr == 0) {
                 ++inst->dvi_frame_count;
             }
             break;
 
         default:
-            _dvi_load_dma_op(inst->dma_cfg, &inst->dma_list_vblank_nosync);
+            dma_list = &inst->dma_list_vblank_nosync;
             break;
     }
 
+    // Each lane's control channel must have loaded this line's active block
+    // before its READ_ADDR or dma_list_active may change. The lanes drain in
+    // lockstep, so they get there within a few cycles of the sync lane that
+    // raised this IRQ, well before now. Check rather than assume, but this
+    // shouldn't ever wait.
+#if DVI_COLLECT_STATS
+    const uint32_t list_start = systick_hw->cvr;
+#endif
+    const uint active_words = inst->timing->h_active_pixels / DVI_SYMBOLS_PER_WORD;
+    for (int i = 0; i < N_TMDS_LANES; ++i) {
+        if (dma_debug_hw->ch[inst->dma_cfg[i].chan_data].dbg_tcr != active_words) {
+#if DVI_COLLECT_STATS
+            ++inst->lane_wait_total;
+#endif
+            while (dma_debug_hw->ch[inst->dma_cfg[i].chan_data].dbg_tcr != active_words) {
+                tight_loop_contents();
+            }
+        }
+    }
+    if (active_tmdsbuf) {
+        _dvi_set_active_tmdsbuf(inst, active_tmdsbuf);
+    }
+#if DVI_IRQ_FULL_DMA_RELOAD
+    _dvi_load_dma_op(inst->dma_cfg, dma_list);
+#else
+    _dvi_point_dma_op(inst->dma_cfg, dma_list);
+#endif
+#if DVI_COLLECT_STATS
+    const uint32_t list_cycles = (list_start - systick_hw->cvr) & 0x00ffffffu;
+    if (list_cycles > inst->list_cycles_max) {
+        inst->list_cycles_max = list_cycles;
+    }
+#endif
+
+    if (consumed)
+    {
+        if (inst->scanline_callback)
+        {
+            inst->scanline_callback(inst->scanline_ctr);
+        }
+        ++inst->scanline_ctr;
+    }
+
+    // The control channels only fetch the list at the end of the current
+    // line, so it is still safe to repoint its data island here.
     if (inst->data_island_is_enabled) {
-        dvi_update_data_packet(inst);
+        const uint32_t slot = line_seq % DVI_DATA_ISLAND_QUEUE_LEN;
+        data_island_stream_t *stream;
+        if (inst->data_island_queue[slot].seq == line_seq) {
+            stream = &inst->data_island_queue[slot].stream;
+        } else {
+            stream = &inst->data_island_null[inst->timing_state.v_state == DVI_STATE_SYNC];
+            ++inst->data_island_underruns;
+        }
+        dvi_update_data_island_ptr(dma_list, stream);
+#if DVI_DATA_ISLAND_USE_SPARE_IRQ
+        _dvi_irq_set_pending(inst->data_island_irq);
+#endif
     }
+
+#if DVI_COLLECT_STATS
+    // SysTick counts down. Excludes exception entry/exit and the dispatch.
+    const uint32_t irq_cycles = (irq_start - systick_hw->cvr) & 0x00ffffffu;
+    if (irq_cycles > inst->irq_cycles_max) {
+        inst->irq_cycles_max = irq_cycles;
+    }
+    inst->irq_cycles_total += irq_cycles;
+    ++inst->irq_count;
+#endif
 }
 
 static void __dvi_func(dvi_dma0_irq)() {
@@ -350,6 +636,12 @@ static void __dvi_func(dvi_dma1_irq)() {
     dvi_dma_irq_handler(inst);
 }
 
+#if DVI_DATA_ISLAND_USE_SPARE_IRQ
+static void __dvi_func(dvi_data_island_irq)() {
+    dvi_prepare_data_islands(data_island_irq_privdata);
+}
+#endif
+
 // DVI Data island related
 void dvi_audio_init(struct dvi_inst *inst) {
     inst->data_island_is_enabled = false;
@@ -360,9 +652,23 @@ void dvi_audio_init(struct dvi_inst *inst) {
     inst->left_audio_sample_count = 0;
     inst->audio_sample_pos = 0;
     inst->audio_frame_count = 0;
+    inst->data_island_underruns = 0;
+    for (int i = 0; i < DVI_DATA_ISLAND_QUEUE_LEN; ++i) {
+        inst->data_island_queue[i].seq = UINT32_MAX;
+    }
 }
 
 void dvi_enable_data_island(struct dvi_inst *inst) {
+    // Fallback streams for lines the encoder did not get to in time
+    data_packet_t null_packet;
+    set_null(&null_packet);
+    for (int vsync = 0; vsync < 2; ++vsync) {
+        encode(&inst->data_island_null[vsync], &null_packet, inst->timing->v_sync_polarity == vsync, inst->timing->h_sync_polarity);
+    }
+    // Start encoding a few lines ahead of wherever the scanline IRQ is now
+    inst->data_island_next_seq = inst->line_seq + 2;
+    _dvi_timing_state_for_line(inst->timing, inst->data_island_next_seq, &inst->data_island_timing);
+    __dmb();
     inst->data_island_is_enabled  = true;
 
     dvi_setup_scanline_for_vblank_with_audio(inst->timing, inst->dma_cfg, true, &inst->dma_list_vblank_sync);
@@ -371,15 +677,15 @@ void dvi_enable_data_island(struct dvi_inst *inst) {
     dvi_setup_scanline_for_active_with_audio(inst->timing, inst->dma_cfg, NULL, &inst->dma_list_error, false);
     dvi_setup_scanline_for_active_with_audio(inst->timing, inst->dma_cfg, NULL, &inst->dma_list_active_blank, true);
 
-    // Setup internal Data Packet streams
-    dvi_update_data_island_ptr(&inst->dma_list_vblank_sync,   &inst->next_data_stream);
-    dvi_update_data_island_ptr(&inst->dma_list_vblank_nosync, &inst->next_data_stream);
-    dvi_update_data_island_ptr(&inst->dma_list_active,        &inst->next_data_stream);
-    dvi_update_data_island_ptr(&inst->dma_list_error,         &inst->next_data_stream);
-    dvi_update_data_island_ptr(&inst->dma_list_active_blank,  &inst->next_data_stream);
+    // Setup internal Data Packet streams; the IRQ repoints them every line
+    dvi_update_data_island_ptr(&inst->dma_list_vblank_sync,   &inst->data_island_null[1]);
+    dvi_update_data_island_ptr(&inst->dma_list_vblank_nosync, &inst->data_island_null[0]);
+    dvi_update_data_island_ptr(&inst->dma_list_active,        &inst->data_island_null[0]);
+    dvi_update_data_island_ptr(&inst->dma_list_error,         &inst->data_island_null[0]);
+    dvi_update_data_island_ptr(&inst->dma_list_active_blank,  &inst->data_island_null[0]);
 }
 
-void dvi_update_data_island_ptr(struct dvi_scanline_dma_list *dma_list, data_island_stream_t *stream) {
+void __dvi_func(dvi_update_data_island_ptr)(struct dvi_scanline_dma_list *dma_list, data_island_stream_t *stream) {
     for (int i = 0; i < N_TMDS_LANES; ++i) {
         dma_cb_t *cblist = dvi_lane_from_list(dma_list, i);
         uint32_t *src = stream->data[i];
@@ -392,6 +698,26 @@ void dvi_update_data_island_ptr(struct dvi_scanline_dma_list *dma_list, data_isl
     }
 }
 
+uint dvi_vblank_lines_remaining(struct dvi_inst *inst) {
+    const struct dvi_timing *t = inst->timing;
+    // The last IRQ set up line line_seq; the next one sets up line_seq + 1
+    const uint32_t line_seq = inst->line_seq;
+    struct dvi_timing_state s;
+    _dvi_timing_state_for_line(t, line_seq, &s);
+    if (s.v_state == DVI_STATE_ACTIVE) {
+        return 0;
+    }
+    // Buffers still held from the active area go back through the (flash
+    // resident) queue code on the next IRQs, as do late scanlines
+    if (inst->tmds_buf_release[0] || inst->tmds_buf_release[1] || inst->late_scanline_ctr) {
+        return 0;
+    }
+    const uint vblank_lines = t->v_front_porch + t->v_sync_width + t->v_back_porch;
+    const uint total_lines = vblank_lines + t->v_active_lines;
+    // The IRQ that sets up the first active line is the first to use the queues
+    return vblank_lines - 1 - line_seq % total_lines;
+}
+
 void dvi_audio_sample_buffer_set(struct dvi_inst *inst, audio_sample_t *buffer, int size) {
     audio_ring_set(&inst->audio_ring, buffer, size);
 }
@@ -402,65 +728,225 @@ void dvi_audio_sample_buffer_set(struct dvi_inst *inst, audio_sample_t *buffer,
 // N: HDMI Constant
 // 128 * audio_freq = video_freq * N / CTS
 // e.g.: video_freq = 23495525, audio_freq = 44100 , CTS = 28000, N = 6727 
-void dvi_set_audio_freq(struct dvi_inst *inst, int audio_freq, int cts, int n) {
+static void _dvi_set_audio_params(struct dvi_inst *inst, int audio_freq, int cts, int n) {
     inst->audio_freq = audio_freq;
     set_audio_clock_regeneration(&inst->audio_clock_regeneration, cts, n);
     set_audio_info_frame(&inst->audio_info_frame, audio_freq);
+    set_audio_channel_status(inst->audio_channel_status, audio_freq);
     uint pixelClock =   dvi_timing_get_pixel_clock(inst->timing);
-    uint nPixPerFrame = dvi_timing_get_pixels_per_frame(inst->timing);
     uint nPixPerLine =  dvi_timing_get_pixels_per_line(inst->timing);
-    inst->samples_per_frame  = (uint64_t)(audio_freq) * nPixPerFrame / pixelClock;
     inst->samples_per_line16 = (uint64_t)(audio_freq) * nPixPerLine * 65536 / pixelClock;
+}
+
+void dvi_set_audio_freq(struct dvi_inst *inst, int audio_freq, int cts, int n) {
+    _dvi_set_audio_params(inst, audio_freq, cts, n);
+    uint nPixPerFrame = dvi_timing_get_pixels_per_frame(inst->timing);
+    inst->samples_per_frame  = (uint64_t)(audio_freq) * nPixPerFrame / dvi_timing_get_pixel_clock(inst->timing);
     dvi_enable_data_island(inst);
 }
 
-void dvi_wait_for_valid_line(struct dvi_inst *inst) {
-    uint32_t *tmdsbuf = NULL;
-    queue_peek_blocking_u32(&inst->q_colour_valid, &tmdsbuf);
+bool dvi_set_audio_rate(struct dvi_inst *inst, int audio_freq) {
+    int n, cts;
+    bool exact = dvi_audio_compute_n_cts(dvi_timing_get_pixel_clock(inst->timing), audio_freq, &n, &cts);
+    if (!inst->data_island_is_enabled || !inst->dvi_started) {
+        dvi_set_audio_freq(inst, audio_freq, cts, n);
+        return exact;
+    }
+
+    // The encoder may be running on the other core or from its IRQ. With
+    // samples_per_frame at 0 it only sends null packets and does not touch
+    // the audio state, so stop it, let any pass already in flight finish
+    // (one pass encodes at most a queue's worth of lines), then update.
+    inst->samples_per_frame = 0;
+    __dmb();
+    const uint32_t seq = inst->line_seq;
+    while ((int32_t)(inst->line_seq - seq) < 2 * DVI_DATA_ISLAND_QUEUE_LEN) {
+        tight_loop_contents();
+    }
+    _dvi_set_audio_params(inst, audio_freq, cts, n);
+    inst->audio_sample_pos = 0;
+    inst->audio_frame_count = 0;
+    uint nPixPerFrame = dvi_timing_get_pixels_per_frame(inst->timing);
+    uint32_t samples_per_frame = (uint64_t)(audio_freq) * nPixPerFrame / dvi_timing_get_pixel_clock(inst->timing);
+    __dmb();
+    inst->samples_per_frame = samples_per_frame;
+    return exact;
 }
 
-bool dvi_update_data_packet_(struct dvi_inst *inst, data_packet_t *packet) {
-    if (inst->samples_per_frame == 0) {
-        return false;
+void dvi_set_scanline_count(struct dvi_inst *inst, uint scanline_count) {
+    assert(!inst->dvi_started);
+    const uint lines = inst->timing->v_active_lines;
+    assert(scanline_count > 0 && scanline_count <= lines);
+
+    const uint words = (lines + 31) / 32;
+    free(inst->line_release_map);
+    uint32_t *map = calloc(words, sizeof(uint32_t));
+    if (!map) {
+        panic("Line release map allocation failed");
+    }
+    // Buffer i ends on line floor((i + 1) * lines / scanline_count) - 1, which
+    // is every n-th line when scanline_count divides lines
+    for (uint i = 0; i < scanline_count; ++i) {
+        const uint last = (i + 1) * lines / scanline_count - 1;
+        map[last >> 5] |= 1u << (last & 31);
     }
+    inst->line_release_map = map;
+    inst->scanline_count = scanline_count;
+}
 
-    inst->audio_sample_pos += inst->samples_per_line16;
-    if (inst->timing_state.v_state == DVI_STATE_FRONT_PORCH) {
-        if (inst->timing_state.v_ctr == 0) {
-            if (inst->dvi_frame_count & 1) {
-                *packet = inst->avi_info_frame;
-            } else {
-                *packet = inst->audio_info_frame;
-            }
-            inst->left_audio_sample_count = inst->samples_per_frame;
+void dvi_set_timing(struct dvi_inst *inst, const struct dvi_timing *timing, uint scanline_count) {
+    assert(!inst->dvi_started);
+
+    // Gather up every TMDS buffer wherever the IRQ left it, and free it
+    uint32_t *tmdsbuf;
+    uint n_bufs = 0;
+    for (int i = 0; i < 2; ++i) {
+        if (inst->tmds_buf_release[i]) {
+            _dvi_free_tmds_buffer(inst->tmds_buf_release[i]);
+            inst->tmds_buf_release[i] = NULL;
+            ++n_bufs;
+        }
+    }
+#if DVI_REPEAT_LATE_SCANLINE
+    if (inst->tmds_buf_held) {
+        _dvi_free_tmds_buffer(inst->tmds_buf_held);
+        inst->tmds_buf_held = NULL;
+        ++n_bufs;
+    }
+#endif
+    while (queue_try_remove_u32(&inst->q_tmds_valid, &tmdsbuf)) {
+        _dvi_free_tmds_buffer(tmdsbuf);
+        ++n_bufs;
+    }
+    while (queue_try_remove_u32(&inst->q_tmds_free, &tmdsbuf)) {
+        _dvi_free_tmds_buffer(tmdsbuf);
+        ++n_bufs;
+    }
+    if (n_bufs != DVI_N_TMDS_BUFFERS) {
+        panic("TMDS buffer still in use while changing timing");
+    }
+
+    inst->timing = timing;
+    _dvi_set_lane_words(inst);
+    inst->gap_line = NULL;
+    dvi_set_scanline_count(inst, scanline_count);
+    dvi_timing_state_init(&inst->timing_state);
+    inst->line_seq = 0;
+    inst->late_scanline_ctr = 0;
+    inst->scanline_ctr = 0;
+    _dvi_alloc_tmds_buffers(inst);
 
-            return true;
-        } else if (inst->timing_state.v_ctr == 1) {
-            *packet = inst->audio_clock_regeneration;
+    // Drop whatever the serialisers still hold from the old mode
+    for (int i = 0; i < N_TMDS_LANES; ++i) {
+        pio_sm_clear_fifos(inst->ser_cfg.pio, inst->ser_cfg.sm_tmds[i]);
+        pio_sm_restart(inst->ser_cfg.pio, inst->ser_cfg.sm_tmds[i]);
+    }
 
-            return true;
+    if (inst->data_island_is_enabled) {
+        // line_seq restarted, so queued islands could match the wrong lines
+        inst->data_island_is_enabled = false;
+        for (int i = 0; i < DVI_DATA_ISLAND_QUEUE_LEN; ++i) {
+            inst->data_island_queue[i].seq = UINT32_MAX;
         }
+        dvi_enable_data_island(inst);
+    } else {
+        dvi_setup_scanline_for_vblank(inst->timing, inst->dma_cfg, true, &inst->dma_list_vblank_sync);
+        dvi_setup_scanline_for_vblank(inst->timing, inst->dma_cfg, false, &inst->dma_list_vblank_nosync);
+        dvi_setup_scanline_for_active(inst->timing, inst->dma_cfg, (void*)SRAM_BASE, &inst->dma_list_active, false);
+        dvi_setup_scanline_for_active(inst->timing, inst->dma_cfg, NULL, &inst->dma_list_error, false);
+        dvi_setup_scanline_for_active(inst->timing, inst->dma_cfg, NULL, &inst->dma_list_active_blank, true);
     }
-    int sample_pos_16 = inst->audio_sample_pos >> 16;
-    int read_size = get_read_size(&inst->audio_ring, false);
-    int n = MAX(0, MIN(4, MIN(sample_pos_16, read_size)));
-    inst->audio_sample_pos -= n << 16;
-    if (n) {
-        audio_sample_t *audio_sample_ptr = get_read_pointer(&inst->audio_ring);
-        inst->audio_frame_count = set_audio_sample(packet, audio_sample_ptr, n, inst->audio_frame_count);
-        increase_read_pointer(&inst->audio_ring, n);
-        
-        return true;
+}
+
+void dvi_set_gap_line(struct dvi_inst *inst, const uint32_t *tmdsbuf, uint first, uint count) {
+    // The IRQ may be on the other core: never let it see a half-updated range
+    inst->gap_line = NULL;
+    __compiler_memory_barrier();
+    inst->gap_first = first;
+    inst->gap_count = count;
+    __compiler_memory_barrier();
+    inst->gap_line = tmdsbuf;
+}
+
+void dvi_wait_for_valid_line(struct dvi_inst *inst) {
+    uint32_t *tmdsbuf = NULL;
+    queue_peek_blocking_u32(&inst->q_colour_valid, &tmdsbuf);
+}
+
+static void __dvi_func(_dvi_encode_data_island)(struct dvi_inst *inst, const struct dvi_timing_state *ts, bool odd_frame, data_island_stream_t *stream) {
+    const bool vsync_active = ts->v_state == DVI_STATE_SYNC;
+    const bool vsync = inst->timing->v_sync_polarity == vsync_active;
+    const bool hsync = inst->timing->h_sync_polarity;
+
+    if (inst->samples_per_frame != 0) {
+        inst->audio_sample_pos += inst->samples_per_line16;
+        if (ts->v_state == DVI_STATE_FRONT_PORCH && ts->v_ctr < 2) {
+            if (ts->v_ctr == 0) {
+                encode(stream, odd_frame ? &inst->avi_info_frame : &inst->audio_info_frame, vsync, hsync);
+                inst->left_audio_sample_count = inst->samples_per_frame;
+            } else {
+                encode(stream, &inst->audio_clock_regeneration, vsync, hsync);
+            }
+            return;
+        }
+        int sample_pos_16 = inst->audio_sample_pos >> 16;
+        int read_size = get_read_size(&inst->audio_ring, false);
+        int n = MAX(0, MIN(4, MIN(sample_pos_16, read_size)));
+        inst->audio_sample_pos -= n << 16;
+        if (n) {
+            audio_sample_t *audio_sample_ptr = get_read_pointer(&inst->audio_ring);
+            inst->audio_frame_count = encode_audio_sample_packet(stream, audio_sample_ptr, n, inst->audio_frame_count, inst->audio_channel_status, vsync, hsync);
+            increase_read_pointer(&inst->audio_ring, n);
+            return;
+        }
     }
 
-    return false;
+    // Nothing to send: copy the pre-encoded null packet
+    *stream = inst->data_island_null[vsync_active];
 }
 
-void dvi_update_data_packet(struct dvi_inst *inst) {
-    data_packet_t packet;
-    if (!dvi_update_data_packet_(inst, &packet)) {
-        set_null(&packet);
+void __dvi_func(dvi_prepare_data_islands)(struct dvi_inst *inst) {
+    if (!inst->data_island_is_enabled) {
+        return;
+    }
+
+    const struct dvi_timing *t = inst->timing;
+    const uint32_t lines_per_frame = t->v_front_porch + t->v_sync_width + t->v_back_porch + t->v_active_lines;
+    uint32_t seq = inst->data_island_next_seq;
+
+    while (true) {
+        const uint32_t current = inst->line_seq;
+        if ((int32_t)(seq - current) <= 0) {
+            // Fell behind the scanline IRQ, which has already sent null packets
+            // for the missed lines. Skip ahead, and let the audio pacing catch up
+            // on a few of the lost lines (packets carry up to 4 samples each).
+            uint32_t skipped = current + 1 - seq;
+            inst->audio_sample_pos += MIN(skipped, 8u) * inst->samples_per_line16;
+            seq = current + 1;
+            _dvi_timing_state_for_line(t, seq, &inst->data_island_timing);
+        }
+        // Entry seq - N is free once the IRQ has moved past it (see dvi_dma_irq_handler)
+        if ((int32_t)(seq - current) >= DVI_DATA_ISLAND_QUEUE_LEN) {
+            break;
+        }
+
+        const uint32_t slot = seq % DVI_DATA_ISLAND_QUEUE_LEN;
+#if DVI_COLLECT_STATS
+        const uint32_t encode_start = systick_hw->cvr;
+#endif
+        _dvi_encode_data_island(inst, &inst->data_island_timing, (seq / lines_per_frame) & 1, &inst->data_island_queue[slot].stream);
+#if DVI_COLLECT_STATS
+        const uint32_t encode_cycles = (encode_start - systick_hw->cvr) & 0x00ffffffu;
+        if (encode_cycles > inst->data_island_cycles_max) {
+            inst->data_island_cycles_max = encode_cycles;
+        }
+#endif
+        // Publish only once the stream is complete
+        __dmb();
+        inst->data_island_queue[slot].seq = seq;
+
+        ++seq;
+        dvi_timing_state_advance(t, &inst->data_island_timing);
     }
-    bool vsync = inst->timing_state.v_state == DVI_STATE_SYNC;
-    encode(&inst->next_data_stream, &packet, inst->timing->v_sync_polarity == vsync, inst->timing->h_sync_polarity);
-}
\ No newline at end of file
+    inst->data_island_next_seq = seq;
+}
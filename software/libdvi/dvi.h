@@ -44,11 +44,67 @@ struct dvi_inst {
 	// block for this buf has been loaded, and the second occurs some time after
 	// the actual data DMA transfer has completed.
 	uint32_t *tmds_buf_release[2];
+#if DVI_REPEAT_LATE_SCANLINE
+	// The TMDS buffer most recently consumed, kept back from release so it
+	// can be shown again in place of a late one. Released once the next
+	// buffer is consumed.
+	uint32_t *tmds_buf_held;
+#endif
+
+	// Words from one lane of a TMDS buffer to the next (0 if monochrome), for
+	// pointing dma_list_active at a new buffer without recomputing it
+	uint tmds_lane_words;
 
 	// Remember how far behind the source is on TMDS scanlines, so we can output
 	// solid colour until they catch up (rather than dying spectacularly)
 	uint late_scanline_ctr;
 
+	// One bit per active line, set on the last line each scanline buffer is
+	// shown for; the IRQ consumes the buffer there. Built by
+	// dvi_set_scanline_count(), so a buffer count that doesn't divide
+	// v_active_lines gets a mix of n and n+1 repeats.
+	uint32_t *line_release_map;
+	uint scanline_count;
+	// Position within the active area in scanline buffers
+	uint scanline_ctr;
+
+	// Gap line (LCD grid effect): the last output line of each scanline
+	// buffer from gap_first to gap_first + gap_count - 1 shows this
+	// pre-encoded line instead, if the buffer covers more than one line.
+	// NULL when off. See dvi_set_gap_line().
+	const uint32_t *volatile gap_line;
+	uint gap_first;
+	uint gap_count;
+
+#if DVI_COLLECT_STATS
+	// Diagnostics. late_scanline_total counts every late_scanline_ctr
+	// increment since init. late_frame_total counts frames with
+	// any late scanline, late_scanlines_last_frame is the count for the
+	// last complete frame, and repeated_line_total the output lines that
+	// re-showed an earlier buffer (DVI_REPEAT_LATE_SCANLINE) instead of the
+	// error line.
+	volatile uint late_scanline_total;
+	volatile uint late_frame_total;
+	volatile uint late_scanlines_last_frame;
+	volatile uint repeated_line_total;
+	uint late_scanlines_this_frame;
+	// IRQs that found a lane still loading its active block when the next
+	// list was due (see dvi_dma_irq_handler()). Expected to stay at 0.
+	volatile uint lane_wait_total;
+	// Longest stretch of the DMA IRQ spent on that check and on pointing the
+	// control channels at the next list, in cycles, cleared by the caller
+	volatile uint32_t list_cycles_max;
+	// System clock cycles, from the SysTick that dvi_register_irqs_this_core()
+	// starts on the IRQ core. irq_cycles_max is the longest DMA IRQ since the
+	// caller last cleared it; irq_cycles_total / irq_count is the average.
+	// data_island_cycles_max is the longest single data island encode, the
+	// work the DMA IRQ used to do inline, also cleared by the caller.
+	volatile uint32_t irq_cycles_max;
+	volatile uint32_t irq_cycles_total;
+	volatile uint32_t irq_count;
+	volatile uint32_t data_island_cycles_max;
+#endif
+
 	// Encoded scanlines:
 	queue_t q_tmds_valid;
 	queue_t q_tmds_free;
@@ -63,15 +119,30 @@ struct dvi_inst {
     data_packet_t avi_info_frame;
     data_packet_t audio_clock_regeneration;
     data_packet_t audio_info_frame;
+    uint8_t audio_channel_status[AUDIO_CHANNEL_STATUS_BYTES];
     int audio_freq;
     int samples_per_frame;
     int samples_per_line16;
     
     bool data_island_is_enabled;
     bool scanline_is_enabled;
-    data_island_stream_t next_data_stream;
     audio_ring_t  audio_ring;
 
+    // Data islands are encoded ahead of time by dvi_prepare_data_islands()
+    // into a ring indexed by scanline sequence number. The DMA IRQ only
+    // points the next scanline's DMA list at the matching entry, or at a
+    // pre-encoded null packet if the encoder has fallen behind.
+    struct {
+        data_island_stream_t stream;
+        volatile uint32_t seq;
+    } data_island_queue[DVI_DATA_ISLAND_QUEUE_LEN];
+    data_island_stream_t data_island_null[2];       // indexed by vsync active
+    volatile uint32_t line_seq;                     // timing advances since dvi_init
+    uint32_t data_island_next_seq;                  // next line the encoder will produce
+    struct dvi_timing_state data_island_timing;     // timing state for data_island_next_seq
+    volatile uint data_island_underruns;
+    int data_island_irq;                            // spare IRQ running the encoder, or -1
+
     int left_audio_sample_count;
     int audio_sample_pos;
     int audio_frame_count;
@@ -102,6 +173,26 @@ void dvi_stop(struct dvi_inst *inst);
 //Waits for a valid line
 void dvi_wait_for_valid_line(struct dvi_inst *inst);
 
+// Switch to another video timing without a reboot, showing scanline_count
+// buffers per frame (see dvi_set_scanline_count()). Call with DVI stopped
+// (dvi_stop()) and the system clock already at the new timing's bit clock;
+// the TMDS buffers must all be back with libdvi, ie. not held by the encoder.
+// TMDS buffers are reallocated for the new width and the DMA lists rebuilt.
+// If audio is enabled, set the audio rate again afterwards
+// (dvi_set_audio_rate()) as it depends on the pixel clock. Then dvi_start().
+void dvi_set_timing(struct dvi_inst *inst, const struct dvi_timing *timing, uint scanline_count);
+
+// Set how many scanline buffers make up the active area, from 1 up to
+// v_active_lines. They are spread Bresenham-style: 144 buffers over 480 lines
+// get 3 or 4 lines each, in a fixed pattern. dvi_init() sets
+// v_active_lines / DVI_VERTICAL_REPEAT. DVI must be stopped.
+void dvi_set_scanline_count(struct dvi_inst *inst, uint scanline_count);
+
+// Number of whole lines left in the current vertical blanking interval, or 0
+// during the active area. While it is nonzero the DVI IRQ runs entirely from
+// RAM, so flash may be taken offline for that many line periods.
+uint dvi_vblank_lines_remaining(struct dvi_inst *inst);
+
 // TMDS encode worker function: core enters and doesn't leave, but still
 // responds to IRQs. Repeatedly pop a scanline buffer from q_colour_valid,
 // TMDS encode it, and pass it to the tmds valid queue.
@@ -118,10 +209,22 @@ void dvi_enable_data_island(struct dvi_inst *inst);
 void dvi_update_data_island_ptr(struct dvi_scanline_dma_list *dma_list, data_island_stream_t *stream);
 void dvi_audio_sample_buffer_set(struct dvi_inst *inst, audio_sample_t *buffer, int size);
 void dvi_set_audio_freq(struct dvi_inst *inst, int audio_freq, int cts, int n);
-void dvi_update_data_packet(struct dvi_inst *inst);
+// Set the audio sample rate with N/CTS from dvi_audio_compute_n_cts(). Can be
+// called while DVI is running: audio packets are paused for a few scanlines.
+bool dvi_set_audio_rate(struct dvi_inst *inst, int audio_freq);
+// Encode data island packets for upcoming scanlines until the queue is full.
+// Runs from a spare IRQ when DVI_DATA_ISLAND_USE_SPARE_IRQ is set, otherwise
+// must be called by the application. Must not preempt the DVI DMA IRQ.
+void dvi_prepare_data_islands(struct dvi_inst *inst);
 inline void dvi_set_scanline(struct dvi_inst *inst, bool value) {
     inst->scanline_is_enabled = value;
 }
+// Show tmdsbuf, laid out like a TMDS scanline buffer, on the last output line
+// of scanline buffers first to first + count - 1, so each is followed by a gap
+// without any encoding work. Buffers shown on a single line are left alone.
+// NULL turns it off. The buffer must stay valid until then; dvi_set_timing()
+// turns it off too.
+void dvi_set_gap_line(struct dvi_inst *inst, const uint32_t *tmdsbuf, uint first, uint count);
 inline dvi_blank_t *dvi_get_blank_settings(struct dvi_inst *inst) {
     return &inst->blank_settings;
 }
@@ -26,12 +26,71 @@
 #define DVI_N_TMDS_BUFFERS 3
 #endif
 
+// If nonzero, the DVI_N_TMDS_BUFFERS buffers are carved from a static pool of
+// this many bytes instead of malloc()ed, sized for the widest timing the
+// application uses. The pool is the uninitialized RAM group dvi_tmds_pool
+// (section .uninitialized_data.dvi_tmds_pool), so a linker script can give it
+// an SRAM bank of its own, away from the CPUs.
+#ifndef DVI_TMDS_POOL_BYTES
+#define DVI_TMDS_POOL_BYTES 0
+#endif
+
+// If 1, a scanline that isn't ready in time is replaced by another showing of
+// the last one that was, instead of a solid error line. libdvi holds on to the
+// most recently shown TMDS buffer for this, so it needs one buffer more than
+// usual: at least 4.
+#ifndef DVI_REPEAT_LATE_SCANLINE
+#define DVI_REPEAT_LATE_SCANLINE 0
+#endif
+
+#if DVI_REPEAT_LATE_SCANLINE && DVI_N_TMDS_BUFFERS > 0 && DVI_N_TMDS_BUFFERS < 4
+#error "DVI_REPEAT_LATE_SCANLINE needs DVI_N_TMDS_BUFFERS >= 4"
+#endif
+
 // If 1, replace the DVI serialiser with a 10n1 UART (1 start bit, 10 data
 // bits, 1 stop bit) so the stream can be dumped and analysed easily.
 #ifndef DVI_SERIAL_DEBUG
 #define DVI_SERIAL_DEBUG 0
 #endif
 
+// If 1, keep cheap running statistics in struct dvi_inst (late scanlines in
+// total and per frame, repeated lines, worst-case DMA IRQ duration) for
+// on-screen diagnostics. Costs four SysTick reads per DMA IRQ.
+#ifndef DVI_COLLECT_STATS
+#define DVI_COLLECT_STATS 0
+#endif
+
+// If 1, the DMA IRQ rewrites every control channel's full configuration for
+// each line, as it originally did, rather than just its READ_ADDR. Only there
+// to compare the two with DVI_COLLECT_STATS.
+#ifndef DVI_IRQ_FULL_DMA_RELOAD
+#define DVI_IRQ_FULL_DMA_RELOAD 0
+#endif
+
+// Number of pre-encoded data island packets queued ahead of the scanline
+// IRQ. Each entry is one scanline; the encoder may run up to this many lines
+// ahead. Must be a power of 2.
+#ifndef DVI_DATA_ISLAND_QUEUE_LEN
+#define DVI_DATA_ISLAND_QUEUE_LEN 8
+#endif
+
+// If 1, data island packets are encoded from a spare (software) IRQ that the
+// scanline IRQ pends once per line. If 0, the application must call
+// dvi_prepare_data_islands() often enough to keep the queue topped up.
+#ifndef DVI_DATA_ISLAND_USE_SPARE_IRQ
+#define DVI_DATA_ISLAND_USE_SPARE_IRQ 1
+#endif
+
+// NVIC priorities used when DVI owns its DMA IRQ. The data island encoder
+// must run below the scanline IRQ (on RP2040 only the top two bits count).
+#ifndef DVI_DMA_IRQ_PRIORITY
+#define DVI_DMA_IRQ_PRIORITY 0x40
+#endif
+
+#ifndef DVI_DATA_ISLAND_IRQ_PRIORITY
+#define DVI_DATA_ISLAND_IRQ_PRIORITY 0x80
+#endif
+
 // If 1, the same TMDS symbols are sent to all 3 lanes during the horizontal
 // active period. This means only monochrome colour is available, but the TMDS
 // buffers are 3 times smaller as a result, and the performance requirements
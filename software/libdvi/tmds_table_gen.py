@@ -142,9 +142,11 @@ enc = TMDSEncode()
 levels_2bpp_even = [0x05, 0x50, 0xaf, 0xfa]
 levels_2bpp_odd  = [0x04, 0x51, 0xae, 0xfb]
 
-for i1, p1 in enumerate(levels_2bpp_odd):
-	for i0, p0 in enumerate(levels_2bpp_even):
-		sym0 = enc.encode(p0, 0, 1)
-		sym1 = enc.encode(p1, 0, 1)
-		assert(enc.imbalance == 0)
-		print(f".word 0x{sym1 << 10 | sym0:05x} // {i0:02b}, {i1:02b}")
+# Guarded so that other generators can import TMDSEncode from here
+if __name__ == "__main__":
+	for i1, p1 in enumerate(levels_2bpp_odd):
+		for i0, p0 in enumerate(levels_2bpp_even):
+			sym0 = enc.encode(p0, 0, 1)
+			sym1 = enc.encode(p1, 0, 1)
+			assert(enc.imbalance == 0)
+			print(f".word 0x{sym1 << 10 | sym0:05x} // {i0:02b}, {i1:02b}")
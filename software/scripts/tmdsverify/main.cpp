@@ -0,0 +1,368 @@
+// tmdsverify: decode full-frame TMDS lane dumps taken in DVI_SERIAL_DEBUG
+// mode, check them, and compare the frames with a reference image. This is
+// the fast, checking counterpart of tmdsdump.py.
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "png.h"
+#include "stream.h"
+#include "tmds.h"
+
+static void usage(const char *prog) {
+	fprintf(stderr,
+		"usage: %s [options] LANE_R LANE_G LANE_B\n"
+		"\n"
+		"Lane dumps are in tmdsdump.py's order, with the sync lane last. A .csv file\n"
+		"holds one symbol per line in its second column (0x prefix allowed, lines\n"
+		"that don't parse are skipped); any other file is raw little-endian 16-bit\n"
+		"symbols.\n"
+		"\n"
+		"  --bgr              lanes are given sync lane (blue) first\n"
+		"  --png PREFIX       write frame N to PREFIXnn.png\n"
+		"  --wav FILE         write the decoded audio as 16-bit stereo WAV\n"
+		"  --audio-rate HZ    WAV sample rate (default 32000)\n"
+		"  --pixel-clock KHZ  also report the audio rate implied by ACR N/CTS\n"
+		"  --expect FILE      compare frames with this PNG\n"
+		"  --frame N          compare frame N only (default: every frame)\n"
+		"  --tolerance N      allowed difference per channel (default 0). Fractional\n"
+		"                     scaling split words can be one 6-bit level out: use 4\n"
+		"  --diff FILE        write a diff of the first mismatching frame\n"
+		"  --timing H,HFP,HS,HBP,V,VFP,VS,VBP\n"
+		"                     expected active/porch/sync sizes, in pixels and lines\n"
+		"\n"
+		"Exits 0 if every check passed, 1 if any failed, 2 on bad input.\n",
+		prog);
+}
+
+static bool read_file(const std::string &path, std::vector<char> &data) {
+	FILE *f = fopen(path.c_str(), "rb");
+	if (!f)
+		return false;
+	char buf[1 << 16];
+	size_t got;
+	while ((got = fread(buf, 1, sizeof(buf), f)) > 0)
+		data.insert(data.end(), buf, buf + got);
+	const bool ok = !ferror(f);
+	fclose(f);
+	return ok;
+}
+
+static bool ends_with(const std::string &s, const char *suffix) {
+	const size_t n = strlen(suffix);
+	if (s.size() < n)
+		return false;
+	for (size_t i = 0; i < n; ++i)
+		if (tolower((unsigned char)s[s.size() - n + i]) != suffix[i])
+			return false;
+	return true;
+}
+
+static bool load_lane(const std::string &path, std::vector<uint16_t> &syms) {
+	std::vector<char> data;
+	if (!read_file(path, data)) {
+		fprintf(stderr, "cannot read %s: %s\n", path.c_str(), strerror(errno));
+		return false;
+	}
+	if (!ends_with(path, ".csv")) {
+		syms.resize(data.size() / 2);
+		for (size_t i = 0; i < syms.size(); ++i)
+			syms[i] = (uint8_t)data[2 * i] | (uint8_t)data[2 * i + 1] << 8;
+		return true;
+	}
+
+	// Logic analyser export: "time,value" per line, maybe with a header
+	data.push_back('\0');
+	syms.reserve(data.size() / 8);
+	const char *p = data.data();
+	const char *end = p + data.size() - 1;
+	while (p < end) {
+		const char *eol = (const char *)memchr(p, '\n', end - p);
+		if (!eol)
+			eol = end;
+		const char *field = (const char *)memchr(p, ',', eol - p);
+		field = field ? field + 1 : p;
+		while (field < eol && (*field == ' ' || *field == '"'))
+			++field;
+		char *parsed;
+		const unsigned long v = strtoul(field, &parsed, 0);
+		if (parsed != field && parsed <= eol)
+			syms.push_back(v & 0x3ff);
+		p = eol + 1;
+	}
+	return true;
+}
+
+static void put_le(std::vector<uint8_t> &v, uint32_t x, int bytes) {
+	for (int i = 0; i < bytes; ++i)
+		v.push_back(x >> (8 * i));
+}
+
+static bool write_wav(const std::string &path, const std::vector<int16_t> &samples, unsigned rate) {
+	const uint32_t bytes = samples.size() * 2;
+	std::vector<uint8_t> hdr;
+	hdr.insert(hdr.end(), {'R', 'I', 'F', 'F'});
+	put_le(hdr, 36 + bytes, 4);
+	hdr.insert(hdr.end(), {'W', 'A', 'V', 'E', 'f', 'm', 't', ' '});
+	put_le(hdr, 16, 4);
+	put_le(hdr, 1, 2);         // PCM
+	put_le(hdr, 2, 2);         // stereo
+	put_le(hdr, rate, 4);
+	put_le(hdr, rate * 4, 4);  // byte rate
+	put_le(hdr, 4, 2);         // block align
+	put_le(hdr, 16, 2);
+	hdr.insert(hdr.end(), {'d', 'a', 't', 'a'});
+	put_le(hdr, bytes, 4);
+	for (int16_t s : samples)
+		put_le(hdr, (uint16_t)s, 2);
+
+	FILE *f = fopen(path.c_str(), "wb");
+	if (!f)
+		return false;
+	const bool ok = fwrite(hdr.data(), 1, hdr.size(), f) == hdr.size();
+	return fclose(f) == 0 && ok;
+}
+
+static void print_timing(const stream_timing &t) {
+	printf("  %ux%u, h %u/%u/%u/%u (%u) %c, v %u/%u/%u/%u (%u) %c\n",
+		t.h_active_pixels, t.v_active_lines,
+		t.h_active_pixels, t.h_front_porch, t.h_sync_width, t.h_back_porch, t.h_total(),
+		t.h_sync_polarity ? '+' : '-',
+		t.v_active_lines, t.v_front_porch, t.v_sync_width, t.v_back_porch, t.v_total(),
+		t.v_sync_polarity ? '+' : '-');
+}
+
+static bool check(const char *what, const stream_error &e) {
+	if (!e.count)
+		return true;
+	printf("FAIL %s: %u, first at symbol %zu\n", what, e.count, e.first);
+	return false;
+}
+
+struct compare_result {
+	size_t mismatched = 0;
+	int max_delta = 0;
+	unsigned first_x = 0, first_y = 0;
+};
+
+static compare_result compare(const image &got, const image &want, int tolerance, image *diff) {
+	compare_result r;
+	if (diff)
+		diff->resize(want.width, want.height);
+	for (unsigned y = 0; y < want.height; ++y) {
+		for (unsigned x = 0; x < want.width; ++x) {
+			const uint8_t *a = got.pixel(x, y);
+			const uint8_t *b = want.pixel(x, y);
+			int delta = 0;
+			for (int c = 0; c < 3; ++c)
+				delta = std::max(delta, abs(a[c] - b[c]));
+			const bool bad = delta > tolerance;
+			if (bad && !r.mismatched++) {
+				r.first_x = x;
+				r.first_y = y;
+			}
+			r.max_delta = std::max(r.max_delta, delta);
+			if (diff) {
+				// Mismatches in magenta over a dimmed reference
+				uint8_t *d = diff->pixel(x, y);
+				for (int c = 0; c < 3; ++c)
+					d[c] = bad ? (c == 1 ? 0 : 255) : b[c] / 4;
+			}
+		}
+	}
+	return r;
+}
+
+int main(int argc, char **argv) {
+	std::vector<std::string> files;
+	std::string png_prefix, wav_path, expect_path, diff_path;
+	unsigned audio_rate = 32000;
+	unsigned pixel_clock_khz = 0;
+	long only_frame = -1;
+	int tolerance = 0;
+	bool bgr = false;
+	bool have_timing = false;
+	stream_timing want_timing;
+
+	for (int i = 1; i < argc; ++i) {
+		const std::string a = argv[i];
+		const bool has_value = i + 1 < argc;
+		if (a == "--bgr") {
+			bgr = true;
+		} else if (a == "--png" && has_value) {
+			png_prefix = argv[++i];
+		} else if (a == "--wav" && has_value) {
+			wav_path = argv[++i];
+		} else if (a == "--audio-rate" && has_value) {
+			audio_rate = strtoul(argv[++i], nullptr, 0);
+		} else if (a == "--pixel-clock" && has_value) {
+			pixel_clock_khz = strtoul(argv[++i], nullptr, 0);
+		} else if (a == "--expect" && has_value) {
+			expect_path = argv[++i];
+		} else if (a == "--frame" && has_value) {
+			only_frame = strtol(argv[++i], nullptr, 0);
+		} else if (a == "--tolerance" && has_value) {
+			tolerance = atoi(argv[++i]);
+		} else if (a == "--diff" && has_value) {
+			diff_path = argv[++i];
+		} else if (a == "--timing" && has_value) {
+			stream_timing &t = want_timing;
+			if (sscanf(argv[++i], "%u,%u,%u,%u,%u,%u,%u,%u",
+					&t.h_active_pixels, &t.h_front_porch, &t.h_sync_width, &t.h_back_porch,
+					&t.v_active_lines, &t.v_front_porch, &t.v_sync_width, &t.v_back_porch) != 8) {
+				usage(argv[0]);
+				return 2;
+			}
+			have_timing = true;
+		} else if (a.size() > 1 && a[0] == '-') {
+			usage(argv[0]);
+			return 2;
+		} else {
+			files.push_back(a);
+		}
+	}
+	if (files.size() != TMDS_LANES) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	std::vector<uint16_t> lanes[TMDS_LANES];
+	for (int i = 0; i < TMDS_LANES; ++i) {
+		// Lane 0 is blue: last on the command line unless --bgr
+		const int lane = bgr ? i : TMDS_LANES - 1 - i;
+		if (!load_lane(files[i], lanes[lane]))
+			return 2;
+	}
+
+	image expected;
+	if (!expect_path.empty()) {
+		std::string error;
+		if (!png_read(expect_path, expected, error)) {
+			fprintf(stderr, "%s\n", error.c_str());
+			return 2;
+		}
+	}
+
+	const stream_result res = stream_decode(lanes);
+	const stream_stats &st = res.stats;
+	bool pass = true;
+
+	printf("symbols: %zu (control %zu, video %zu, island %zu), %s\n", st.symbols,
+		st.control_symbols, st.video_symbols, st.island_symbols, st.hdmi ? "HDMI" : "DVI");
+	printf("frames: %zu complete\n", res.frames.size());
+	if (res.frames.empty()) {
+		printf("FAIL no complete frame (a dump needs two vsync pulses)\n");
+		pass = false;
+	} else {
+		print_timing(res.frames[0].timing);
+	}
+	if (have_timing && !res.frames.empty()) {
+		const stream_timing &t = res.frames[0].timing;
+		want_timing.h_sync_polarity = t.h_sync_polarity;
+		want_timing.v_sync_polarity = t.v_sync_polarity;
+		if (t != want_timing) {
+			printf("FAIL timing, expected:\n");
+			print_timing(want_timing);
+			pass = false;
+		}
+	}
+
+	printf("dc balance: max |N1-N0| %d/%d/%d (B/G/R)\n",
+		st.max_disparity[0], st.max_disparity[1], st.max_disparity[2]);
+	if (st.non_canonical[0] || st.non_canonical[1] || st.non_canonical[2]) {
+		// Decodes fine, but no spec encoder would produce it
+		printf("warning: non-canonical video symbols %zu/%zu/%zu (B/G/R)\n",
+			st.non_canonical[0], st.non_canonical[1], st.non_canonical[2]);
+	}
+
+	if (st.packets) {
+		printf("packets: %u (null %u, ACR %u, audio %u, AVI %u, audio infoframe %u)\n", st.packets,
+			st.packets_by_type[0x00], st.packets_by_type[0x01], st.packets_by_type[0x02],
+			st.packets_by_type[0x82], st.packets_by_type[0x84]);
+	}
+	if (!res.audio.empty() || st.acr_n) {
+		unsigned min_samples = ~0u, max_samples = 0;
+		for (const stream_frame &f : res.frames) {
+			min_samples = std::min(min_samples, f.audio_samples);
+			max_samples = std::max(max_samples, f.audio_samples);
+		}
+		printf("audio: %zu samples", res.audio.size() / 2);
+		if (!res.frames.empty())
+			printf(", %u-%u per frame", min_samples, max_samples);
+		if (st.acr_n)
+			printf(", N %u CTS %u", st.acr_n, st.acr_cts);
+		if (st.acr_cts && pixel_clock_khz)
+			printf(" (%.0f Hz)", pixel_clock_khz * 1000.0 * st.acr_n / (128.0 * st.acr_cts));
+		printf("\n");
+	}
+
+	pass &= check("control symbols on some lanes only", st.mixed_control);
+	pass &= check("preamble length", st.preamble);
+	pass &= check("video guard band", st.video_guard);
+	pass &= check("data island guard band", st.island_guard);
+	pass &= check("non-TERC4 island symbols", st.terc4);
+	pass &= check("packet start bit", st.packet_start);
+	pass &= check("header BCH", st.header_bch);
+	pass &= check("subpacket BCH", st.subpacket_bch);
+	pass &= check("periods not DC balanced", st.unbalanced);
+	pass &= check("lines differing from the frame's first active line", st.line_length);
+	pass &= check("frames differing from the first frame's timing", st.frame_timing);
+
+	if (!expected.rgb.empty()) {
+		bool diff_written = false;
+		for (size_t i = 0; i < res.frames.size(); ++i) {
+			if (only_frame >= 0 && (size_t)only_frame != i)
+				continue;
+			const image &got = res.frames[i].img;
+			if (got.width != expected.width || got.height != expected.height) {
+				printf("FAIL frame %zu: %ux%u, expected %ux%u\n", i,
+					got.width, got.height, expected.width, expected.height);
+				pass = false;
+				continue;
+			}
+			image diff;
+			const bool want_diff = !diff_path.empty() && !diff_written;
+			const compare_result r = compare(got, expected, tolerance, want_diff ? &diff : nullptr);
+			if (!r.mismatched)
+				continue;
+			printf("FAIL frame %zu: %zu pixels differ (max %d), first at %u,%u\n", i,
+				r.mismatched, r.max_delta, r.first_x, r.first_y);
+			pass = false;
+			if (want_diff) {
+				if (!png_write(diff_path, diff)) {
+					fprintf(stderr, "cannot write %s\n", diff_path.c_str());
+					return 2;
+				}
+				diff_written = true;
+			}
+		}
+		if (only_frame >= 0 && (size_t)only_frame >= res.frames.size()) {
+			printf("FAIL frame %ld not in the dump\n", only_frame);
+			pass = false;
+		}
+	}
+
+	if (!png_prefix.empty()) {
+		for (size_t i = 0; i < res.frames.size(); ++i) {
+			char name[32];
+			snprintf(name, sizeof(name), "%02zu.png", i);
+			if (!png_write(png_prefix + name, res.frames[i].img)) {
+				fprintf(stderr, "cannot write %s%s\n", png_prefix.c_str(), name);
+				return 2;
+			}
+		}
+	}
+	if (!wav_path.empty() && !write_wav(wav_path, res.audio, audio_rate)) {
+		fprintf(stderr, "cannot write %s\n", wav_path.c_str());
+		return 2;
+	}
+
+	printf("%s\n", pass ? "PASS" : "FAIL");
+	return pass ? 0 : 1;
+}
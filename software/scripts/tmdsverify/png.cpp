@@ -0,0 +1,443 @@
+#include "png.h"
+
+#include <cstdio>
+#include <cstring>
+
+static const uint8_t png_signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+
+static uint32_t crc32(const uint8_t *p, size_t n, uint32_t crc = 0) {
+	static uint32_t table[256];
+	if (!table[1]) {
+		for (uint32_t i = 0; i < 256; ++i) {
+			uint32_t c = i;
+			for (int k = 0; k < 8; ++k)
+				c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+			table[i] = c;
+		}
+	}
+	crc = ~crc;
+	while (n--)
+		crc = table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
+
+static uint32_t adler32(const uint8_t *p, size_t n) {
+	uint32_t a = 1, b = 0;
+	while (n) {
+		// 5552 bytes is the most that can be summed before b might overflow
+		size_t chunk = n < 5552 ? n : 5552;
+		n -= chunk;
+		while (chunk--) {
+			a += *p++;
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+	}
+	return (b << 16) | a;
+}
+
+static uint32_t get_be32(const uint8_t *p) {
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static void put_be32(std::vector<uint8_t> &v, uint32_t x) {
+	v.push_back(x >> 24);
+	v.push_back(x >> 16);
+	v.push_back(x >> 8);
+	v.push_back(x);
+}
+
+static void put_chunk(std::vector<uint8_t> &out, const char *type, const std::vector<uint8_t> &data) {
+	put_be32(out, data.size());
+	const size_t start = out.size();
+	out.insert(out.end(), type, type + 4);
+	out.insert(out.end(), data.begin(), data.end());
+	put_be32(out, crc32(&out[start], out.size() - start));
+}
+
+bool png_write(const std::string &path, const image &img) {
+	std::vector<uint8_t> raw;
+	raw.reserve((size_t)img.height * (img.width * 3 + 1));
+	for (unsigned y = 0; y < img.height; ++y) {
+		raw.push_back(0); // filter: none
+		const uint8_t *row = img.rgb.data() + (size_t)y * img.width * 3;
+		raw.insert(raw.end(), row, row + img.width * 3);
+	}
+
+	// zlib stream of stored blocks: frames are small and this keeps it simple
+	std::vector<uint8_t> z = {0x78, 0x01};
+	size_t pos = 0;
+	do {
+		const size_t len = raw.size() - pos < 65535 ? raw.size() - pos : 65535;
+		z.push_back(pos + len == raw.size()); // BFINAL, BTYPE = 00
+		z.push_back(len);
+		z.push_back(len >> 8);
+		z.push_back(~len);
+		z.push_back(~len >> 8);
+		z.insert(z.end(), raw.begin() + pos, raw.begin() + pos + len);
+		pos += len;
+	} while (pos < raw.size());
+	put_be32(z, adler32(raw.data(), raw.size()));
+
+	std::vector<uint8_t> ihdr;
+	put_be32(ihdr, img.width);
+	put_be32(ihdr, img.height);
+	ihdr.insert(ihdr.end(), {8, 2, 0, 0, 0}); // 8-bit RGB, not interlaced
+
+	std::vector<uint8_t> out(png_signature, png_signature + 8);
+	put_chunk(out, "IHDR", ihdr);
+	put_chunk(out, "IDAT", z);
+	put_chunk(out, "IEND", {});
+
+	FILE *f = fopen(path.c_str(), "wb");
+	if (!f)
+		return false;
+	const bool ok = fwrite(out.data(), 1, out.size(), f) == out.size();
+	return fclose(f) == 0 && ok;
+}
+
+// ----------------------------------------------------------------------------
+// Inflate (RFC 1951), after the canonical decoding used by zlib's puff.c
+
+namespace {
+
+struct bit_reader {
+	const uint8_t *p;
+	size_t n;
+	size_t pos = 0;
+	uint32_t buf = 0;
+	int cnt = 0;
+	bool overrun = false;
+
+	bit_reader(const uint8_t *p_, size_t n_) : p(p_), n(n_) {}
+
+	int bits(int k) {
+		while (cnt < k) {
+			if (pos >= n) {
+				overrun = true;
+				return 0;
+			}
+			buf |= (uint32_t)p[pos++] << cnt;
+			cnt += 8;
+		}
+		const int v = buf & ((1u << k) - 1);
+		buf >>= k;
+		cnt -= k;
+		return v;
+	}
+};
+
+struct huffman {
+	uint16_t count[16];
+	uint16_t symbol[288];
+
+	// False if the lengths over-subscribe the code. Incomplete codes are
+	// allowed, as deflate uses them for single distance codes.
+	bool build(const uint8_t *lengths, int n) {
+		memset(count, 0, sizeof(count));
+		for (int i = 0; i < n; ++i)
+			count[lengths[i]]++;
+		int left = 1;
+		for (int len = 1; len < 16; ++len) {
+			left = (left << 1) - count[len];
+			if (left < 0)
+				return false;
+		}
+		uint16_t offs[16];
+		offs[1] = 0;
+		for (int len = 1; len < 15; ++len)
+			offs[len + 1] = offs[len] + count[len];
+		for (int i = 0; i < n; ++i)
+			if (lengths[i])
+				symbol[offs[lengths[i]]++] = i;
+		return true;
+	}
+
+	int decode(bit_reader &br) const {
+		int code = 0, first = 0, index = 0;
+		for (int len = 1; len < 16; ++len) {
+			code |= br.bits(1);
+			const int c = count[len];
+			if (code - c < first)
+				return symbol[index + (code - first)];
+			index += c;
+			first = (first + c) << 1;
+			code <<= 1;
+		}
+		return -1;
+	}
+};
+
+const uint16_t length_base[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+const uint8_t length_extra[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+const uint16_t dist_base[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+const uint8_t dist_extra[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+bool inflate_codes(bit_reader &br, std::vector<uint8_t> &out, const huffman &lit, const huffman &dist) {
+	for (;;) {
+		int sym = lit.decode(br);
+		if (sym < 0 || br.overrun)
+			return false;
+		if (sym < 256) {
+			out.push_back(sym);
+		} else if (sym == 256) {
+			return true;
+		} else {
+			sym -= 257;
+			if (sym >= 29)
+				return false;
+			const int len = length_base[sym] + br.bits(length_extra[sym]);
+			const int dsym = dist.decode(br);
+			if (dsym < 0 || dsym >= 30)
+				return false;
+			const size_t d = dist_base[dsym] + br.bits(dist_extra[dsym]);
+			if (d > out.size() || br.overrun)
+				return false;
+			const size_t from = out.size() - d;
+			for (int i = 0; i < len; ++i)
+				out.push_back(out[from + i]);
+		}
+	}
+}
+
+bool inflate(const uint8_t *p, size_t n, std::vector<uint8_t> &out) {
+	bit_reader br(p, n);
+	int last;
+	do {
+		last = br.bits(1);
+		const int type = br.bits(2);
+		if (type == 0) {
+			// Stored: drop the rest of the current byte
+			br.buf = 0;
+			br.cnt = 0;
+			if (br.pos + 4 > n)
+				return false;
+			const unsigned len = p[br.pos] | p[br.pos + 1] << 8;
+			const unsigned nlen = p[br.pos + 2] | p[br.pos + 3] << 8;
+			br.pos += 4;
+			if (len != (~nlen & 0xffff) || br.pos + len > n)
+				return false;
+			out.insert(out.end(), p + br.pos, p + br.pos + len);
+			br.pos += len;
+		} else if (type == 1) {
+			static huffman fixed_lit, fixed_dist;
+			static bool built = false;
+			if (!built) {
+				uint8_t lengths[288];
+				int i = 0;
+				for (; i < 144; ++i) lengths[i] = 8;
+				for (; i < 256; ++i) lengths[i] = 9;
+				for (; i < 280; ++i) lengths[i] = 7;
+				for (; i < 288; ++i) lengths[i] = 8;
+				fixed_lit.build(lengths, 288);
+				for (i = 0; i < 30; ++i) lengths[i] = 5;
+				fixed_dist.build(lengths, 30);
+				built = true;
+			}
+			if (!inflate_codes(br, out, fixed_lit, fixed_dist))
+				return false;
+		} else if (type == 2) {
+			static const uint8_t order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+			const int nlen = br.bits(5) + 257;
+			const int ndist = br.bits(5) + 1;
+			const int ncode = br.bits(4) + 4;
+			if (nlen > 286 || ndist > 30)
+				return false;
+			uint8_t lengths[286 + 30] = {0};
+			for (int i = 0; i < ncode; ++i)
+				lengths[order[i]] = br.bits(3);
+			huffman lencode;
+			if (!lencode.build(lengths, 19))
+				return false;
+			int i = 0;
+			while (i < nlen + ndist) {
+				int sym = lencode.decode(br);
+				if (sym < 0 || br.overrun)
+					return false;
+				if (sym < 16) {
+					lengths[i++] = sym;
+					continue;
+				}
+				uint8_t len = 0;
+				int repeat;
+				if (sym == 16) {
+					if (i == 0)
+						return false;
+					len = lengths[i - 1];
+					repeat = 3 + br.bits(2);
+				} else if (sym == 17) {
+					repeat = 3 + br.bits(3);
+				} else {
+					repeat = 11 + br.bits(7);
+				}
+				if (i + repeat > nlen + ndist)
+					return false;
+				while (repeat--)
+					lengths[i++] = len;
+			}
+			huffman lit, dist;
+			if (!lit.build(lengths, nlen) || !dist.build(lengths + nlen, ndist))
+				return false;
+			if (!inflate_codes(br, out, lit, dist))
+				return false;
+		} else {
+			return false;
+		}
+		if (br.overrun)
+			return false;
+	} while (!last);
+	return true;
+}
+
+int paeth(int a, int b, int c) {
+	const int p = a + b - c;
+	const int pa = p > a ? p - a : a - p;
+	const int pb = p > b ? p - b : b - p;
+	const int pc = p > c ? p - c : c - p;
+	if (pa <= pb && pa <= pc)
+		return a;
+	return pb <= pc ? b : c;
+}
+
+} // namespace
+
+bool png_read(const std::string &path, image &img, std::string &error) {
+	FILE *f = fopen(path.c_str(), "rb");
+	if (!f) {
+		error = "cannot open " + path;
+		return false;
+	}
+	std::vector<uint8_t> data;
+	uint8_t chunk[65536];
+	size_t got;
+	while ((got = fread(chunk, 1, sizeof(chunk), f)) > 0)
+		data.insert(data.end(), chunk, chunk + got);
+	fclose(f);
+
+	if (data.size() < 8 || memcmp(data.data(), png_signature, 8) != 0) {
+		error = path + " is not a PNG file";
+		return false;
+	}
+
+	unsigned width = 0, height = 0, depth = 0, colour = 0;
+	std::vector<uint8_t> palette, z;
+	bool have_header = false;
+	size_t pos = 8;
+	while (pos + 12 <= data.size()) {
+		const uint32_t len = get_be32(&data[pos]);
+		if (len > data.size() - pos - 12) {
+			error = path + ": truncated chunk";
+			return false;
+		}
+		const uint8_t *type = &data[pos + 4];
+		const uint8_t *body = &data[pos + 8];
+		if (!memcmp(type, "IHDR", 4) && len >= 13) {
+			width = get_be32(body);
+			height = get_be32(body + 4);
+			depth = body[8];
+			colour = body[9];
+			if (body[12] != 0) {
+				error = path + ": interlaced PNGs are not supported";
+				return false;
+			}
+			have_header = true;
+		} else if (!memcmp(type, "PLTE", 4)) {
+			palette.assign(body, body + len);
+		} else if (!memcmp(type, "IDAT", 4)) {
+			z.insert(z.end(), body, body + len);
+		} else if (!memcmp(type, "IEND", 4)) {
+			break;
+		}
+		pos += 12 + len;
+	}
+
+	static const unsigned channels_for_colour[7] = {1, 0, 3, 1, 2, 0, 4};
+	const unsigned channels = colour < 7 ? channels_for_colour[colour] : 0;
+	const bool depth_ok = depth == 8 || depth == 16 ||
+		((colour == 0 || colour == 3) && (depth == 1 || depth == 2 || depth == 4));
+	if (!have_header || !channels || !depth_ok || (colour == 3 && depth == 16) || !width || !height) {
+		error = path + ": unsupported PNG format";
+		return false;
+	}
+	if (z.size() < 6 || (z[0] & 0x0f) != 8 || (z[1] & 0x20) || ((z[0] << 8) | z[1]) % 31) {
+		error = path + ": bad zlib stream";
+		return false;
+	}
+
+	std::vector<uint8_t> raw;
+	if (!inflate(z.data() + 2, z.size() - 2, raw)) {
+		error = path + ": corrupt image data";
+		return false;
+	}
+	const size_t stride = ((size_t)width * channels * depth + 7) / 8;
+	const unsigned bpp = (channels * depth + 7) / 8;
+	if (raw.size() < (stride + 1) * height) {
+		error = path + ": image data too short";
+		return false;
+	}
+
+	// Undo the row filters in place
+	std::vector<uint8_t> zero(stride, 0);
+	for (unsigned y = 0; y < height; ++y) {
+		uint8_t *row = &raw[y * (stride + 1) + 1];
+		const uint8_t *prev = y ? row - (stride + 1) : zero.data();
+		const int filter = row[-1];
+		for (size_t i = 0; i < stride; ++i) {
+			const int a = i >= bpp ? row[i - bpp] : 0;
+			const int b = prev[i];
+			const int c = i >= bpp ? prev[i - bpp] : 0;
+			switch (filter) {
+			case 0: break;
+			case 1: row[i] += a; break;
+			case 2: row[i] += b; break;
+			case 3: row[i] += (a + b) / 2; break;
+			case 4: row[i] += paeth(a, b, c); break;
+			default:
+				error = path + ": bad row filter";
+				return false;
+			}
+		}
+	}
+
+	img.resize(width, height);
+	for (unsigned y = 0; y < height; ++y) {
+		const uint8_t *row = &raw[y * (stride + 1) + 1];
+		for (unsigned x = 0; x < width; ++x) {
+			// Top 8 bits of each sample; low depths are scaled up
+			unsigned s[4] = {0, 0, 0, 0};
+			for (unsigned c = 0; c < channels; ++c) {
+				const size_t bit = ((size_t)x * channels + c) * depth;
+				if (depth >= 8) {
+					s[c] = row[bit / 8];
+				} else {
+					const unsigned v = (row[bit / 8] >> (8 - depth - bit % 8)) & ((1u << depth) - 1);
+					s[c] = colour == 3 ? v : v * 255 / ((1u << depth) - 1);
+				}
+			}
+			uint8_t *px = img.pixel(x, y);
+			if (colour == 3) {
+				if ((size_t)s[0] * 3 + 2 >= palette.size()) {
+					error = path + ": palette index out of range";
+					return false;
+				}
+				memcpy(px, &palette[s[0] * 3], 3);
+			} else if (channels < 3) {
+				px[0] = px[1] = px[2] = s[0];
+			} else {
+				px[0] = s[0];
+				px[1] = s[1];
+				px[2] = s[2];
+			}
+		}
+	}
+	return true;
+}
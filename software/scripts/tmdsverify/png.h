@@ -0,0 +1,29 @@
+#ifndef PNG_H
+#define PNG_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Just enough PNG for reference images and decoded frames, so the tool has
+// no dependencies: any non-interlaced PNG is read (alpha is dropped), and
+// 8-bit RGB is written with stored deflate blocks.
+
+struct image {
+	unsigned width = 0;
+	unsigned height = 0;
+	std::vector<uint8_t> rgb;   // width * height * 3
+
+	void resize(unsigned w, unsigned h) {
+		width = w;
+		height = h;
+		rgb.assign((size_t)w * h * 3, 0);
+	}
+	uint8_t *pixel(unsigned x, unsigned y) { return &rgb[((size_t)y * width + x) * 3]; }
+	const uint8_t *pixel(unsigned x, unsigned y) const { return &rgb[((size_t)y * width + x) * 3]; }
+};
+
+bool png_write(const std::string &path, const image &img);
+bool png_read(const std::string &path, image &img, std::string &error);
+
+#endif
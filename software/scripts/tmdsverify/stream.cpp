@@ -0,0 +1,411 @@
+#include "stream.h"
+
+#include <cstdlib>
+#include <cstring>
+
+bool stream_timing::operator==(const stream_timing &o) const {
+	return h_sync_polarity == o.h_sync_polarity &&
+		h_front_porch == o.h_front_porch &&
+		h_sync_width == o.h_sync_width &&
+		h_back_porch == o.h_back_porch &&
+		h_active_pixels == o.h_active_pixels &&
+		v_sync_polarity == o.v_sync_polarity &&
+		v_front_porch == o.v_front_porch &&
+		v_sync_width == o.v_sync_width &&
+		v_back_porch == o.v_back_porch &&
+		v_active_lines == o.v_active_lines;
+}
+
+namespace {
+
+// Preamble CTL3:0 values, as carried on lanes 2 and 1
+#define CTL_VIDEO  0x1
+#define CTL_ISLAND 0x5
+#define W_PREAMBLE 8
+#define W_GUARDBAND 2
+#define W_PACKET 32
+
+struct line_info {
+	size_t start = 0;          // hsync leading edge
+	unsigned total = 0;
+	unsigned sync = 0;         // symbols with hsync active
+	bool vsync = false;        // vsync active at the hsync edge
+	long video_start = -1;     // first pixel, relative to start
+	unsigned video_len = 0;
+	size_t pixels = 0;         // offset of the first pixel in frame_rgb
+};
+
+class decoder {
+public:
+	decoder(const std::vector<uint16_t> (&lanes)[TMDS_LANES], stream_result &res);
+	void run();
+
+private:
+	const uint16_t *l0, *l1, *l2;
+	size_t n;
+	stream_result &res;
+	stream_stats &st;
+
+	bool h_polarity = false, v_polarity = false;
+	// Starting "active" means a dump that opens mid-pulse has no edge there
+	bool h_active = true, v_active = false;
+
+	bool in_line = false;
+	bool last_line_vsync = false;
+	line_info line;
+
+	bool in_frame = false;
+	size_t frame_start = 0;
+	unsigned frame_audio = 0;
+	std::vector<line_info> frame_lines;
+	std::vector<uint8_t> frame_rgb;
+
+	int disparity[TMDS_LANES];
+
+	bool all_ctrl(size_t i) const {
+		return tmds_ctrl_decode(l0[i]) >= 0 && tmds_ctrl_decode(l1[i]) >= 0 && tmds_ctrl_decode(l2[i]) >= 0;
+	}
+	bool is_island_guard(size_t i) const {
+		const int t0 = tmds_terc4_decode(l0[i]);
+		return l1[i] == TMDS_ISLAND_GUARD && l2[i] == TMDS_ISLAND_GUARD && t0 >= 0 && (t0 & 0xc) == 0xc;
+	}
+
+	void find_polarity();
+	void set_sync(int hv, size_t i);
+	void hsync_edge(size_t i, bool vsync);
+	void end_line();
+	void end_frame();
+
+	void begin_period();
+	void balance(size_t i);
+	void end_period(size_t start);
+
+	size_t video(size_t i, bool guarded);
+	size_t island(size_t i);
+	void packet(size_t i, bool first);
+};
+
+decoder::decoder(const std::vector<uint16_t> (&lanes)[TMDS_LANES], stream_result &res_)
+	: res(res_), st(res_.stats) {
+	l0 = lanes[0].data();
+	l1 = lanes[1].data();
+	l2 = lanes[2].data();
+	n = lanes[0].size();
+	for (int i = 1; i < TMDS_LANES; ++i)
+		if (lanes[i].size() < n)
+			n = lanes[i].size();
+	st.symbols = n;
+}
+
+// The sync levels in the control period just before active video are the
+// inactive ones. Take a majority vote, as the dump may start anywhere.
+void decoder::find_polarity() {
+	long h_high = 0, v_high = 0;
+	int run_ctl = -1;
+	int last_hv = 0;
+	for (size_t i = 0; i < n; ++i) {
+		if (all_ctrl(i)) {
+			last_hv = tmds_ctrl_decode(l0[i]);
+			run_ctl = tmds_ctrl_decode(l1[i]) | tmds_ctrl_decode(l2[i]) << 2;
+			continue;
+		}
+		if (run_ctl >= 0 && run_ctl != CTL_ISLAND) {
+			h_high += (last_hv & 1) ? 1 : -1;
+			v_high += (last_hv & 2) ? 1 : -1;
+		}
+		run_ctl = -1;
+	}
+	// Active level is the other one; without any video, assume active low
+	h_polarity = h_high < 0;
+	v_polarity = v_high < 0;
+}
+
+void decoder::set_sync(int hv, size_t i) {
+	const bool h = ((hv & 1) != 0) == h_polarity;
+	const bool v = ((hv & 2) != 0) == v_polarity;
+	if (h && !h_active)
+		hsync_edge(i, v);
+	h_active = h;
+	v_active = v;
+	if (h && in_line)
+		line.sync++;
+}
+
+void decoder::hsync_edge(size_t i, bool vsync) {
+	if (in_line) {
+		line.total = i - line.start;
+		end_line();
+	}
+	// A frame needs a whole line before it, to be sure vsync starts here
+	const bool had_line = in_line;
+	if (vsync && !last_line_vsync && had_line) {
+		if (in_frame)
+			end_frame();
+		in_frame = true;
+		frame_start = i;
+		frame_audio = 0;
+		frame_lines.clear();
+		frame_rgb.clear();
+	}
+	line = line_info();
+	line.start = i;
+	line.vsync = vsync;
+	last_line_vsync = vsync;
+	in_line = true;
+}
+
+void decoder::end_line() {
+	if (in_frame)
+		frame_lines.push_back(line);
+}
+
+void decoder::end_frame() {
+	const std::vector<line_info> &lines = frame_lines;
+	size_t first = lines.size(), last = 0;
+	for (size_t y = 0; y < lines.size(); ++y) {
+		if (lines[y].video_len) {
+			if (first == lines.size())
+				first = y;
+			last = y;
+		}
+	}
+	if (first == lines.size())
+		return; // no active video, nothing to check against
+
+	stream_frame f;
+	f.first_symbol = frame_start;
+	f.audio_samples = frame_audio;
+	stream_timing &t = f.timing;
+	const line_info &ref = lines[first];
+	t.h_sync_polarity = h_polarity;
+	t.h_sync_width = ref.sync;
+	t.h_back_porch = ref.video_start - ref.sync;
+	t.h_active_pixels = ref.video_len;
+	t.h_front_porch = ref.total - ref.video_start - ref.video_len;
+	t.v_sync_polarity = v_polarity;
+	while (t.v_sync_width < lines.size() && lines[t.v_sync_width].vsync)
+		t.v_sync_width++;
+	t.v_back_porch = first > t.v_sync_width ? first - t.v_sync_width : 0;
+	t.v_active_lines = last - first + 1;
+	t.v_front_porch = lines.size() - last - 1;
+
+	f.img.resize(t.h_active_pixels, t.v_active_lines);
+	for (size_t y = 0; y < lines.size(); ++y) {
+		const line_info &l = lines[y];
+		const bool active = y >= first && y <= last;
+		if (l.total != ref.total || l.sync != ref.sync ||
+			(active && (l.video_start != ref.video_start || l.video_len != ref.video_len))) {
+			st.line_length.add(l.start);
+		}
+		if (active && l.video_len) {
+			const unsigned w = l.video_len < t.h_active_pixels ? l.video_len : t.h_active_pixels;
+			memcpy(f.img.pixel(0, y - first), &frame_rgb[l.pixels], (size_t)w * 3);
+		}
+	}
+
+	if (!res.frames.empty() && res.frames[0].timing != t)
+		st.frame_timing.add(frame_start);
+	res.frames.push_back(std::move(f));
+}
+
+void decoder::begin_period() {
+	for (int l = 0; l < TMDS_LANES; ++l)
+		disparity[l] = 0;
+}
+
+void decoder::balance(size_t i) {
+	const uint16_t syms[TMDS_LANES] = {l0[i], l1[i], l2[i]};
+	for (int l = 0; l < TMDS_LANES; ++l) {
+		disparity[l] += tmds_disparity(syms[l]);
+		if (abs(disparity[l]) > st.max_disparity[l])
+			st.max_disparity[l] = abs(disparity[l]);
+	}
+}
+
+// libdvi only sends DC balanced symbol pairs, so every period should end
+// back at zero
+void decoder::end_period(size_t start) {
+	for (int l = 0; l < TMDS_LANES; ++l) {
+		if (disparity[l]) {
+			st.unbalanced.add(start);
+			break;
+		}
+	}
+}
+
+size_t decoder::video(size_t i, bool guarded) {
+	const size_t start = i;
+	begin_period();
+	if (guarded) {
+		for (int k = 0; k < W_GUARDBAND && i < n && !all_ctrl(i); ++k, ++i) {
+			if (l0[i] != TMDS_VIDEO_GUARD_0 || l1[i] != TMDS_VIDEO_GUARD_1 || l2[i] != TMDS_VIDEO_GUARD_2)
+				st.video_guard.add(i);
+			balance(i);
+		}
+	}
+	for (; i < n; ++i) {
+		const int c0 = tmds_ctrl_decode(l0[i]);
+		const int c1 = tmds_ctrl_decode(l1[i]);
+		const int c2 = tmds_ctrl_decode(l2[i]);
+		if (c0 >= 0 && c1 >= 0 && c2 >= 0)
+			break;
+		if (c0 >= 0 || c1 >= 0 || c2 >= 0)
+			st.mixed_control.add(i);
+		balance(i);
+		const uint16_t syms[TMDS_LANES] = {l0[i], l1[i], l2[i]};
+		for (int l = 0; l < TMDS_LANES; ++l)
+			if (!tmds_data_canonical(syms[l]))
+				st.non_canonical[l]++;
+		if (!in_line)
+			continue;
+		if (line.video_start < 0) {
+			line.video_start = i - line.start;
+			line.pixels = frame_rgb.size();
+		}
+		line.video_len++;
+		if (in_frame) {
+			frame_rgb.push_back(tmds_data_decode(l2[i]));
+			frame_rgb.push_back(tmds_data_decode(l1[i]));
+			frame_rgb.push_back(tmds_data_decode(l0[i]));
+		}
+	}
+	end_period(start);
+	st.video_symbols += i - start;
+	return i;
+}
+
+size_t decoder::island(size_t i) {
+	const size_t start = i;
+	begin_period();
+	for (int k = 0; k < W_GUARDBAND && i < n; ++k, ++i) {
+		if (is_island_guard(i))
+			set_sync(tmds_terc4_decode(l0[i]) & 3, i);
+		else
+			st.island_guard.add(i);
+		balance(i);
+	}
+	for (bool first = true; i < n; first = false) {
+		if (is_island_guard(i)) {
+			// Trailing guard band ends the island
+			for (int k = 0; k < W_GUARDBAND && i < n; ++k, ++i) {
+				if (is_island_guard(i))
+					set_sync(tmds_terc4_decode(l0[i]) & 3, i);
+				else
+					st.island_guard.add(i);
+				balance(i);
+			}
+			break;
+		}
+		if (all_ctrl(i)) {
+			st.island_guard.add(i);
+			break;
+		}
+		if (i + W_PACKET > n) {
+			i = n; // dump ends mid-packet
+			break;
+		}
+		packet(i, first);
+		i += W_PACKET;
+	}
+	end_period(start);
+	st.island_symbols += i - start;
+	return i;
+}
+
+void decoder::packet(size_t i, bool first) {
+	uint8_t header[4] = {0};
+	uint8_t sub[4][8] = {{0}};
+	for (int k = 0; k < W_PACKET; ++k) {
+		const size_t s = i + k;
+		const int t0 = tmds_terc4_decode(l0[s]);
+		const int t1 = tmds_terc4_decode(l1[s]);
+		const int t2 = tmds_terc4_decode(l2[s]);
+		if (t0 < 0 || t1 < 0 || t2 < 0)
+			st.terc4.add(s);
+		if (t0 >= 0) {
+			set_sync(t0 & 3, s);
+			header[k / 8] |= (t0 >> 2 & 1) << (k % 8);
+			// Bit 3 is clear only on the first symbol of the island
+			if (((t0 & 8) != 0) != (k || !first))
+				st.packet_start.add(s);
+		}
+		// Lane 1 carries the even bits of the four subpackets, lane 2 the odd
+		for (int j = 0; j < 4; ++j) {
+			if (t1 >= 0)
+				sub[j][k / 4] |= (t1 >> j & 1) << (2 * k % 8);
+			if (t2 >= 0)
+				sub[j][k / 4] |= (t2 >> j & 1) << (2 * k % 8 + 1);
+		}
+		balance(s);
+	}
+
+	if (tmds_bch_parity(header, 3) != header[3])
+		st.header_bch.add(i);
+	for (int j = 0; j < 4; ++j)
+		if (tmds_bch_parity(sub[j], 7) != sub[j][7])
+			st.subpacket_bch.add(i);
+
+	st.packets++;
+	st.packets_by_type[header[0]]++;
+	if (header[0] == 0x01) {
+		// Audio clock regeneration
+		st.acr_cts = (sub[0][1] & 0xf) << 16 | sub[0][2] << 8 | sub[0][3];
+		st.acr_n = (sub[0][4] & 0xf) << 16 | sub[0][5] << 8 | sub[0][6];
+	} else if (header[0] == 0x02 && !(header[1] & 0x10)) {
+		// Layout 0 audio samples: keep the top 16 of 24 bits
+		for (int j = 0; j < 4; ++j) {
+			if (!(header[1] >> j & 1))
+				continue;
+			res.audio.push_back((int16_t)(sub[j][1] | sub[j][2] << 8));
+			res.audio.push_back((int16_t)(sub[j][4] | sub[j][5] << 8));
+			frame_audio++;
+		}
+	}
+}
+
+void decoder::run() {
+	find_polarity();
+	int run_ctl = -1;
+	unsigned run_len = 0;
+	size_t i = 0;
+	while (i < n) {
+		if (all_ctrl(i)) {
+			st.control_symbols++;
+			set_sync(tmds_ctrl_decode(l0[i]), i);
+			const int ctl = tmds_ctrl_decode(l1[i]) | tmds_ctrl_decode(l2[i]) << 2;
+			if (ctl == run_ctl) {
+				run_len++;
+			} else {
+				run_ctl = ctl;
+				run_len = 1;
+			}
+			++i;
+			continue;
+		}
+		if (run_ctl == CTL_ISLAND) {
+			if (run_len != W_PREAMBLE)
+				st.preamble.add(i);
+			i = island(i);
+		} else if (run_ctl == CTL_VIDEO) {
+			if (run_len != W_PREAMBLE)
+				st.preamble.add(i);
+			st.hdmi = true;
+			i = video(i, true);
+		} else {
+			// DVI, or the dump started mid-period
+			i = video(i, false);
+		}
+		run_ctl = -1;
+		run_len = 0;
+	}
+	// Whatever follows the last vsync edge is an incomplete frame
+}
+
+} // namespace
+
+stream_result stream_decode(const std::vector<uint16_t> (&lanes)[TMDS_LANES]) {
+	stream_result res;
+	decoder d(lanes, res);
+	d.run();
+	return res;
+}
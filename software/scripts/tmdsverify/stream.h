@@ -0,0 +1,89 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "png.h"
+#include "tmds.h"
+
+// Measured timing in symbols/lines, in the terms of libdvi's struct
+// dvi_timing. Preambles and guard bands count as back porch.
+struct stream_timing {
+	bool h_sync_polarity = false;   // true = active high
+	unsigned h_front_porch = 0;
+	unsigned h_sync_width = 0;
+	unsigned h_back_porch = 0;
+	unsigned h_active_pixels = 0;
+
+	bool v_sync_polarity = false;
+	unsigned v_front_porch = 0;
+	unsigned v_sync_width = 0;
+	unsigned v_back_porch = 0;
+	unsigned v_active_lines = 0;
+
+	unsigned h_total() const { return h_front_porch + h_sync_width + h_back_porch + h_active_pixels; }
+	unsigned v_total() const { return v_front_porch + v_sync_width + v_back_porch + v_active_lines; }
+	bool operator==(const stream_timing &o) const;
+	bool operator!=(const stream_timing &o) const { return !(*this == o); }
+};
+
+struct stream_frame {
+	stream_timing timing;
+	image img;
+	size_t first_symbol = 0;       // hsync edge that opens the frame
+	unsigned audio_samples = 0;    // stereo samples in this frame's data islands
+};
+
+// Problems found in the stream. Each count comes with the first symbol
+// index it was seen at, so a dump can be inspected by hand.
+struct stream_error {
+	unsigned count = 0;
+	size_t first = 0;
+
+	void add(size_t at) {
+		if (!count++)
+			first = at;
+	}
+};
+
+struct stream_stats {
+	size_t symbols = 0;
+	size_t control_symbols = 0;
+	size_t video_symbols = 0;
+	size_t island_symbols = 0;
+	bool hdmi = false;              // video preambles and guard bands seen
+
+	unsigned packets = 0;
+	unsigned packets_by_type[256] = {0};
+	unsigned acr_n = 0;
+	unsigned acr_cts = 0;
+
+	int max_disparity[TMDS_LANES] = {0};   // worst running N1 - N0 within a period
+	size_t non_canonical[TMDS_LANES] = {0};
+
+	stream_error mixed_control;     // control symbols on some lanes only
+	stream_error preamble;          // preamble not exactly 8 symbols
+	stream_error video_guard;
+	stream_error island_guard;
+	stream_error terc4;             // non-TERC4 symbol inside an island
+	stream_error packet_start;      // lane 0 bit 3 wrong for the packet's first symbol
+	stream_error header_bch;
+	stream_error subpacket_bch;
+	stream_error unbalanced;        // a period (any lane) ending with non-zero disparity
+	stream_error line_length;       // line or active area differs from the frame's first
+	stream_error frame_timing;      // frame timing differs from the first frame's
+};
+
+struct stream_result {
+	std::vector<stream_frame> frames;   // complete frames only
+	std::vector<int16_t> audio;         // interleaved L/R
+	stream_stats stats;
+};
+
+// lanes[i] holds the symbols of TMDS channel i (0 = blue). Decoding runs to
+// the end of the shortest lane.
+stream_result stream_decode(const std::vector<uint16_t> (&lanes)[TMDS_LANES]);
+
+#endif
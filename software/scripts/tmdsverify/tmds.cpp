@@ -0,0 +1,96 @@
+#include "tmds.h"
+
+static const uint16_t ctrl_syms[4] = {
+	0b1101010100, // 0x354
+	0b0010101011, // 0x0ab
+	0b0101010100, // 0x154
+	0b1010101011  // 0x2ab
+};
+
+// Same table as libdvi/data_packet.c
+static const uint16_t terc4_syms[16] = {
+	0b1010011100,
+	0b1001100011,
+	0b1011100100,
+	0b1011100010,
+	0b0101110001,
+	0b0100011110,
+	0b0110001110,
+	0b0100111100,
+	0b1011001100,
+	0b0100111001,
+	0b0110011100,
+	0b1011000110,
+	0b1010001110,
+	0b1001110001,
+	0b0101100011,
+	0b1011000011,
+};
+
+// Reverse lookups for all 1024 symbols, built on first use
+struct sym_tables {
+	int8_t ctrl[1024];
+	int8_t terc4[1024];
+	sym_tables() {
+		for (int i = 0; i < 1024; ++i)
+			ctrl[i] = terc4[i] = -1;
+		for (int i = 0; i < 4; ++i)
+			ctrl[ctrl_syms[i]] = i;
+		for (int i = 0; i < 16; ++i)
+			terc4[terc4_syms[i]] = i;
+	}
+};
+
+static const sym_tables &tables() {
+	static const sym_tables t;
+	return t;
+}
+
+static int popcount(uint32_t x) {
+	int n = 0;
+	for (; x; x &= x - 1)
+		++n;
+	return n;
+}
+
+int tmds_ctrl_decode(uint16_t sym) {
+	return tables().ctrl[sym & 0x3ff];
+}
+
+int tmds_terc4_decode(uint16_t sym) {
+	return tables().terc4[sym & 0x3ff];
+}
+
+uint8_t tmds_data_decode(uint16_t sym) {
+	uint32_t q = sym & 0x3ff;
+	if (q & 0x200)
+		q ^= 0xff;
+	// D[0] = q[0], D[n] = q[n] ^ q[n - 1], inverted for XNOR (bit 8 clear)
+	uint8_t d = (q ^ (q << 1)) & 0xff;
+	return (q & 0x100) ? d : d ^ 0xfe;
+}
+
+bool tmds_data_canonical(uint16_t sym) {
+	const uint8_t d = tmds_data_decode(sym);
+	const int n1 = popcount(d);
+	const bool xnor = n1 > 4 || (n1 == 4 && !(d & 1));
+	return ((sym & 0x100) != 0) == !xnor;
+}
+
+int tmds_disparity(uint16_t sym) {
+	return 2 * popcount(sym & 0x3ff) - 10;
+}
+
+uint8_t tmds_bch_parity(const uint8_t *p, int n) {
+	// Generator 1 + x^6 + x^7 + x^8, bits taken LSB first
+	uint8_t v = 0;
+	for (int i = 0; i < n; ++i) {
+		for (int b = 0; b < 8; ++b) {
+			const bool fb = ((p[i] >> b) ^ v) & 1;
+			v >>= 1;
+			if (fb)
+				v ^= 0x83;
+		}
+	}
+	return v;
+}
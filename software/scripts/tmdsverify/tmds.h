@@ -0,0 +1,34 @@
+#ifndef TMDS_H
+#define TMDS_H
+
+#include <cstdint>
+
+// Symbol level helpers. Symbols are 10-bit values, bit 0 sent first, as
+// captured from the DVI_SERIAL_DEBUG UART and as held in libdvi's buffers.
+
+#define TMDS_LANES 3          // 0 = blue (carries sync), 1 = green, 2 = red
+#define TMDS_VIDEO_GUARD_0 0x2cc
+#define TMDS_VIDEO_GUARD_1 0x133
+#define TMDS_VIDEO_GUARD_2 0x2cc
+#define TMDS_ISLAND_GUARD  0x133  // lanes 1 and 2
+
+// Control period: C1:C0 (lane 0 is VSYNC:HSYNC), or -1 if not a control symbol
+int tmds_ctrl_decode(uint16_t sym);
+
+// TERC4 (data island) nibble, or -1 if not a TERC4 symbol
+int tmds_terc4_decode(uint16_t sym);
+
+// Video data byte. Every 10-bit value decodes to something.
+uint8_t tmds_data_decode(uint16_t sym);
+
+// True if the XOR/XNOR choice in bit 8 is the one the DVI encoder makes for
+// the decoded byte. Receivers accept either, so this is only a warning.
+bool tmds_data_canonical(uint16_t sym);
+
+// N1 - N0 over all 10 bits
+int tmds_disparity(uint16_t sym);
+
+// HDMI BCH parity of n bytes (3 for the packet header, 7 for a subpacket)
+uint8_t tmds_bch_parity(const uint8_t *p, int n);
+
+#endif
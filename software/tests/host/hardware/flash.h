@@ -0,0 +1,18 @@
+#ifndef HARDWARE_FLASH_H
+#define HARDWARE_FLASH_H
+
+// Host flash: host_flash[] stands in for the XIP window and the test supplies
+// the erase and program functions
+
+#include "pico.h"
+
+#define FLASH_PAGE_SIZE   (1u << 8)
+#define FLASH_SECTOR_SIZE (1u << 12)
+
+extern uint8_t host_flash[PICO_FLASH_SIZE_BYTES];
+#define XIP_BASE host_flash
+
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count);
+
+#endif
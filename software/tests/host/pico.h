@@ -0,0 +1,29 @@
+#ifndef PICO_H
+#define PICO_H
+
+// Just enough of the SDK's pico.h to build libdvi's pure computation, the
+// settings store and the smoothing scalers on the host: section attributes
+// become no-ops.
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef unsigned int uint;
+
+#define __not_in_flash_func(f) f
+#define __no_inline_not_in_flash_func(f) f
+#define __time_critical_func(f) f
+#define __scratch_x(s)
+#define __scratch_y(s)
+#define __not_in_flash(group)
+
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+#endif
@@ -0,0 +1 @@
+// Nothing from pico/multicore.h is needed on the host
@@ -0,0 +1 @@
+// Nothing from pico/stdio.h is needed on the host
@@ -0,0 +1,7 @@
+#ifndef PICO_STDLIB_H
+#define PICO_STDLIB_H
+
+// colors.h, for the generated tables, only needs the basic types
+#include "pico.h"
+
+#endif
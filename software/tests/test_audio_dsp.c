@@ -0,0 +1,175 @@
+// Fixed-point microphone DSP (audio_dsp.h) against a float model of the same
+// chain: DC tracker, gain and single-pole low-pass. The float model is what
+// emusound.c computed before the switch to integer math, plus the DC tracker.
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "audio_dsp.h"
+#include "test_util.h"
+
+#define RATE        32000
+#define N           (RATE * 2)          // two seconds per case
+#define SETTLE      (RATE / 2)          // let the DC trackers converge first
+
+typedef struct {
+	double dc;
+	double lp;
+} float_state_t;
+
+static double clamp_d(double v)
+{
+	if (v > INT16_MAX) return INT16_MAX;
+	if (v < INT16_MIN) return INT16_MIN;
+	return v;
+}
+
+static double float_sample(double x, double gain, double alpha, float_state_t *st)
+{
+	st->dc += (x - st->dc) / (double)(1 << DC_SHIFT);
+	x = clamp_d(x - st->dc);
+	double scaled = clamp_d(x * gain);
+	if (alpha >= 1.0)
+		return scaled;
+	st->lp += alpha * (scaled - st->lp);
+	return clamp_d(st->lp);
+}
+
+// Microphone-like input: a tone, some noise and an ADC mid-point error
+static void make_input(int16_t *x, double amplitude, double freq, int offset, unsigned seed)
+{
+	srand(seed);
+	for (int i = 0; i < N; i++) {
+		double noise = ((double)rand() / RAND_MAX - 0.5) * 64.0;
+		double v = amplitude * sin(2.0 * M_PI * freq * i / RATE) + noise + offset;
+		x[i] = (int16_t)clamp_d(floor(v + 0.5));
+	}
+}
+
+typedef struct {
+	double max_err;
+	double rms_err;
+	double rms_signal;
+} compare_t;
+
+static compare_t run_case(const int16_t *x, float gain, float cutoff)
+{
+	const int32_t gain_q12 = audio_dsp_gain_q12(gain);
+	const int32_t alpha_q15 = audio_dsp_lowpass_alpha_q15(cutoff, RATE);
+	const bool lowpass = alpha_q15 < (1 << LP_ALPHA_Q);
+	// The float model uses the exact float coefficient, so the comparison
+	// includes the coefficient quantisation
+	double alpha = 1.0;
+	if (cutoff > 0.0f) {
+		double dt = 1.0 / RATE, rc = 1.0 / (2.0 * M_PI * cutoff);
+		alpha = dt / (rc + dt);
+	}
+	int32_t dc = 0, lp = 0;
+	float_state_t fs = {0};
+	compare_t r = {0};
+	double sum_err = 0, sum_sig = 0;
+	for (int i = 0; i < N; i++) {
+		int32_t y = audio_dsp_sample(x[i], gain_q12, alpha_q15, lowpass, &dc, &lp);
+		double yf = float_sample(x[i], gain, alpha, &fs);
+		if (i < SETTLE)
+			continue;
+		double e = fabs((double)y - yf);
+		if (e > r.max_err)
+			r.max_err = e;
+		sum_err += e * e;
+		sum_sig += yf * yf;
+	}
+	r.rms_err = sqrt(sum_err / (N - SETTLE));
+	r.rms_signal = sqrt(sum_sig / (N - SETTLE));
+	return r;
+}
+
+static void test_accuracy(void)
+{
+	static int16_t x[N];
+	static const float gains[] = { 0.25f, 1.0f, 2.37f, 8.0f, 16.0f };
+	static const float cutoffs[] = { 0.0f, 1500.0f, 6000.0f, 12000.0f };
+	static const struct { double amp, freq; int offset; } inputs[] = {
+		{ 2000.0, 440.0, 0 },
+		{ 2000.0, 440.0, -700 },        // typical ADC mid-point error
+		{ 12000.0, 3000.0, 350 },
+		{ 30000.0, 100.0, 0 },          // clips at any gain above 1
+	};
+
+	printf("input            gain  cutoff  max err  rms err  (LSB)\n");
+	for (unsigned in = 0; in < sizeof(inputs) / sizeof(inputs[0]); in++) {
+		make_input(x, inputs[in].amp, inputs[in].freq, inputs[in].offset, 1 + in);
+		for (unsigned g = 0; g < sizeof(gains) / sizeof(gains[0]); g++) {
+			for (unsigned c = 0; c < sizeof(cutoffs) / sizeof(cutoffs[0]); c++) {
+				compare_t r = run_case(x, gains[g], cutoffs[c]);
+				printf("%5.0f@%4.0fHz%+5d %5.2f %7.0f %8.1f %8.2f\n",
+				       inputs[in].amp, inputs[in].freq, inputs[in].offset,
+				       gains[g], cutoffs[c], r.max_err, r.rms_err);
+				// Rounding before the gain is amplified by it, so the bound
+				// grows with the gain. The Q12 gain itself is off by up to
+				// 1/8192, which is another LSB or so near full scale.
+				const double max_bound = 2.0 + 0.6 * gains[g];
+				const double rms_bound = 0.6 + 0.3 * gains[g];
+				CHECK(r.max_err <= max_bound, "max error %.1f LSB > %.1f", r.max_err, max_bound);
+				CHECK(r.rms_err <= rms_bound, "rms error %.2f LSB > %.2f", r.rms_err, rms_bound);
+			}
+		}
+	}
+}
+
+static void test_dc_removal(void)
+{
+	// A pure offset must settle to (almost) nothing, whatever the gain
+	int32_t dc = 0, lp = 0, y = 0;
+	for (int i = 0; i < RATE; i++)
+		y = audio_dsp_sample(-1200, audio_dsp_gain_q12(16.0f), 1 << LP_ALPHA_Q, false, &dc, &lp);
+	CHECK(abs(y) <= 16, "DC residual %d after 1 s at gain 16", (int)y);
+}
+
+static void test_cost(void)
+{
+	static int16_t x[N];
+	make_input(x, 8000.0, 440.0, -500, 99);
+	const int32_t gain_q12 = audio_dsp_gain_q12(2.0f);
+	const int32_t alpha_q15 = audio_dsp_lowpass_alpha_q15(6000.0f, RATE);
+	const float gain = 2.0f;
+	const float alpha = (float)alpha_q15 / (1 << LP_ALPHA_Q);
+	const int reps = 20;
+	volatile int32_t sink = 0;
+
+	double t0 = test_now_ns();
+	for (int r = 0; r < reps; r++) {
+		int32_t dc = 0, lp = 0, acc = 0;
+		for (int i = 0; i < N; i++)
+			acc += audio_dsp_sample(x[i], gain_q12, alpha_q15, true, &dc, &lp);
+		sink += acc;
+	}
+	double t1 = test_now_ns();
+	for (int r = 0; r < reps; r++) {
+		// Single precision, as the firmware had it
+		float dcf = 0, lpf = 0;
+		int32_t acc = 0;
+		for (int i = 0; i < N; i++) {
+			dcf += (x[i] - dcf) * (1.0f / (1 << DC_SHIFT));
+			float v = x[i] - dcf;
+			float s = v * gain;
+			if (s > INT16_MAX) s = INT16_MAX;
+			if (s < INT16_MIN) s = INT16_MIN;
+			lpf += alpha * (s - lpf);
+			acc += (int32_t)lpf;
+		}
+		sink += acc;
+	}
+	double t2 = test_now_ns();
+	(void)sink;
+	printf("host cost per sample: fixed %.2f ns, float %.2f ns\n",
+	       (t1 - t0) / (reps * (double)N), (t2 - t1) / (reps * (double)N));
+}
+
+int main(void)
+{
+	test_accuracy();
+	test_dc_removal();
+	test_cost();
+	return test_result("audio_dsp");
+}
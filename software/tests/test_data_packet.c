@@ -0,0 +1,311 @@
+// Data island packet encoding (libdvi/data_packet.c) against:
+// - a bit-serial BCH and a symbol-by-symbol TERC4 encoder written straight
+//   from the HDMI 1.4 packet layout, for random packets
+// - digests of the streams the original (pre-table) encoder produced for the
+//   packets the firmware sends, so any change to their encoding shows up
+// - the pre-encoded null packet tables that libdvi's DMA lists point at
+// It also checks that audio clock regeneration gets an exact N/CTS pair for
+// every timing the firmware can run.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "data_packet.h"
+#include "test_util.h"
+
+// Internal tables, not in data_packet.h
+extern uint16_t TERC4Syms_[16];
+extern const uint32_t TERC4PairSyms_[256];
+extern uint32_t defaultDataPackets0_[4][N_DATA_ISLAND_WORDS];
+
+// HDMI 1.4 table 5-4, TERC4 codes for D[3:0] = 0..15, q_out[9:0]
+static const uint16_t spec_terc4[16] = {
+	0x29c, 0x263, 0x2e4, 0x2e2, 0x171, 0x11e, 0x18e, 0x13c,
+	0x2cc, 0x139, 0x19c, 0x2c6, 0x28e, 0x271, 0x163, 0x2c3,
+};
+#define SPEC_GUARD_BAND 0x133   // data island guard band on channels 1 and 2
+
+// ECC over n bytes, least significant bit first, with the generator
+// 1 + x^6 + x^7 + x^8 (HDMI 1.4 section 5.2.3.5)
+static uint8_t spec_bch(const uint8_t *p, int n)
+{
+	uint8_t ecc = 0;
+	for (int i = 0; i < n; i++) {
+		for (int k = 0; k < 8; k++) {
+			const int fb = ((p[i] >> k) ^ ecc) & 1;
+			ecc >>= 1;
+			if (fb)
+				ecc ^= 0x83;
+		}
+	}
+	return ecc;
+}
+
+// One island: leading guard band, 32 packet symbols, trailing guard band.
+// Channel 0 carries hsync, vsync and a header bit; bit 3 is clear only on
+// the first symbol. Channels 1 and 2 carry the even and odd bits of the
+// four subpackets.
+static void spec_encode(data_island_stream_t *dst, const data_packet_t *pk, bool vsync, bool hsync)
+{
+	const int hv = (vsync ? 2 : 0) | (hsync ? 1 : 0);
+	uint16_t sym[TMDS_CHANNELS][W_DATA_ISLAND];
+
+	for (int g = 0; g < W_GUARDBAND; g++) {
+		const int tail = W_DATA_ISLAND - W_GUARDBAND + g;
+		sym[0][g] = sym[0][tail] = spec_terc4[0xc | hv];
+		sym[1][g] = sym[1][tail] = SPEC_GUARD_BAND;
+		sym[2][g] = sym[2][tail] = SPEC_GUARD_BAND;
+	}
+	for (int j = 0; j < W_DATA_PACKET; j++) {
+		const int header_bit = (pk->header[j / 8] >> (j % 8)) & 1;
+		int d1 = 0, d2 = 0;
+		for (int k = 0; k < 4; k++) {
+			d1 |= ((pk->subpacket[k][(2 * j) / 8] >> ((2 * j) % 8)) & 1) << k;
+			d2 |= ((pk->subpacket[k][(2 * j + 1) / 8] >> ((2 * j + 1) % 8)) & 1) << k;
+		}
+		sym[0][W_GUARDBAND + j] = spec_terc4[hv | header_bit << 2 | (j ? 8 : 0)];
+		sym[1][W_GUARDBAND + j] = spec_terc4[d1];
+		sym[2][W_GUARDBAND + j] = spec_terc4[d2];
+	}
+	for (int c = 0; c < TMDS_CHANNELS; c++) {
+		for (int w = 0; w < N_DATA_ISLAND_WORDS; w++) {
+			uint32_t v = 0;
+			for (int s = 0; s < DVI_SYMBOLS_PER_WORD; s++)
+				v |= (uint32_t)sym[c][w * DVI_SYMBOLS_PER_WORD + s] << (10 * s);
+			dst->data[c][w] = v;
+		}
+	}
+}
+
+static uint32_t stream_digest(const data_island_stream_t *s)
+{
+	// FNV-1a over the words, least significant byte first
+	uint32_t h = 2166136261u;
+	for (int c = 0; c < TMDS_CHANNELS; c++) {
+		for (int w = 0; w < N_DATA_ISLAND_WORDS; w++) {
+			for (int b = 0; b < 4; b++) {
+				h ^= (s->data[c][w] >> (8 * b)) & 0xff;
+				h *= 16777619u;
+			}
+		}
+	}
+	return h;
+}
+
+static void random_packet(data_packet_t *pk)
+{
+	for (int i = 0; i < 3; i++)
+		pk->header[i] = rand();
+	for (int k = 0; k < 4; k++)
+		for (int i = 0; i < 7; i++)
+			pk->subpacket[k][i] = rand();
+	compute_parity(pk);
+}
+
+static void test_terc4_tables(void)
+{
+	for (int i = 0; i < 16; i++)
+		CHECK(TERC4Syms_[i] == spec_terc4[i], "TERC4Syms_[%d] = %03x", i, TERC4Syms_[i]);
+	for (int i = 0; i < 256; i++) {
+		const uint32_t want = spec_terc4[i & 15] | (uint32_t)spec_terc4[i >> 4] << 10;
+		CHECK(TERC4PairSyms_[i] == want, "TERC4PairSyms_[%d] = %05x, want %05x", i, TERC4PairSyms_[i], want);
+	}
+}
+
+static void test_bch(void)
+{
+	// Every single-byte message, then random full-length ones
+	for (int i = 0; i < 256; i++) {
+		data_packet_t pk = {0};
+		pk.header[0] = i;
+		pk.subpacket[0][0] = i;
+		pk.subpacket[1][6] = i;
+		compute_parity(&pk);
+		CHECK(pk.header[3] == spec_bch(pk.header, 3), "header ECC for %02x", i);
+		CHECK(pk.subpacket[0][7] == spec_bch(pk.subpacket[0], 7), "subpacket ECC for %02x", i);
+		CHECK(pk.subpacket[1][7] == spec_bch(pk.subpacket[1], 7), "subpacket ECC for %02x at byte 6", i);
+	}
+	srand(34);
+	for (int n = 0; n < 10000; n++) {
+		data_packet_t pk;
+		random_packet(&pk);
+		CHECK(pk.header[3] == spec_bch(pk.header, 3), "header ECC");
+		for (int k = 0; k < 4; k++)
+			CHECK(pk.subpacket[k][7] == spec_bch(pk.subpacket[k], 7), "subpacket %d ECC", k);
+	}
+}
+
+static void test_encode_matches_spec(void)
+{
+	srand(1234);
+	for (int n = 0; n < 10000; n++) {
+		data_packet_t pk;
+		random_packet(&pk);
+		const bool vsync = n & 2, hsync = n & 1;
+		data_island_stream_t got, want;
+		encode(&got, &pk, vsync, hsync);
+		spec_encode(&want, &pk, vsync, hsync);
+		CHECK(memcmp(&got, &want, sizeof(got)) == 0, "encode() differs from spec, packet %d", n);
+	}
+}
+
+static void test_golden(void)
+{
+	// Digests of the original encoder's output (before the table-driven
+	// TERC4/BCH), per hv = vsync << 1 | hsync
+	static const uint32_t null_digest[4] = { 0xc20b2315, 0x95b2a572, 0xf9e21b74, 0xb81599e9 };
+	static const uint32_t acr_digest[4]  = { 0x10851c45, 0xe516f871, 0x54f45eb6, 0x46e356c5 };
+	static const uint32_t aif_digest[4]  = { 0x2dbc1426, 0xab1d435a, 0xccb543a8, 0x00d5a2d0 };
+	static const uint32_t avi_digest[4]  = { 0x29f0048d, 0xc2e805aa, 0x48fec300, 0xf70cc379 };
+
+	for (int hv = 0; hv < 4; hv++) {
+		const bool vsync = hv >> 1, hsync = hv & 1;
+		data_packet_t pk;
+		data_island_stream_t s, ref;
+
+		set_null(&pk);
+		encode(&s, &pk, vsync, hsync);
+		CHECK(stream_digest(&s) == null_digest[hv], "null packet, hv %d", hv);
+		// The pre-encoded copies used for lines without a packet
+		CHECK(memcmp(s.data[0], defaultDataPackets0_[hv], sizeof(s.data[0])) == 0, "defaultDataPackets0_[%d]", hv);
+		CHECK(memcmp(s.data[1], defaultDataPacket12_, sizeof(s.data[1])) == 0, "defaultDataPacket12_, lane 1");
+		CHECK(memcmp(s.data[2], defaultDataPacket12_, sizeof(s.data[2])) == 0, "defaultDataPacket12_, lane 2");
+
+		set_audio_clock_regeneration(&pk, 25200, 4096);
+		CHECK(pk.header[3] == 0x4a && pk.subpacket[0][7] == 0x80, "ACR ECC %02x %02x", pk.header[3], pk.subpacket[0][7]);
+		encode(&s, &pk, vsync, hsync);
+		CHECK(stream_digest(&s) == acr_digest[hv], "ACR packet, hv %d", hv);
+		spec_encode(&ref, &pk, vsync, hsync);
+		CHECK(memcmp(&s, &ref, sizeof(s)) == 0, "ACR packet against spec, hv %d", hv);
+
+		set_audio_info_frame(&pk, 48000);
+		CHECK(pk.subpacket[0][0] == 0x53, "audio InfoFrame checksum %02x", pk.subpacket[0][0]);
+		CHECK(pk.header[3] == 0x4a && pk.subpacket[0][7] == 0xb9, "audio InfoFrame ECC %02x %02x", pk.header[3], pk.subpacket[0][7]);
+		encode(&s, &pk, vsync, hsync);
+		CHECK(stream_digest(&s) == aif_digest[hv], "audio InfoFrame, hv %d", hv);
+
+		set_AVI_info_frame(&pk, UNDERSCAN, RGB, ITU601, PIC_ASPECT_RATIO_4_3, SAME_AS_PAR, FULL, _640x480P60);
+		CHECK(pk.subpacket[0][0] == 0xfc, "AVI InfoFrame checksum %02x", pk.subpacket[0][0]);
+		CHECK(pk.header[3] == 0xe4 && pk.subpacket[0][7] == 0x37, "AVI InfoFrame ECC %02x %02x", pk.header[3], pk.subpacket[0][7]);
+		encode(&s, &pk, vsync, hsync);
+		CHECK(stream_digest(&s) == avi_digest[hv], "AVI InfoFrame, hv %d", hv);
+	}
+}
+
+static void test_audio_fast_path(void)
+{
+	uint8_t status[AUDIO_CHANNEL_STATUS_BYTES];
+	set_audio_channel_status(status, 48000);
+	srand(48000);
+	int fc_slow = 0, fc_fast = 0;
+	for (int n = 0; n < 5000; n++) {
+		audio_sample_t smp[4];
+		for (int i = 0; i < 4; i++) {
+			smp[i].channels[0] = rand();
+			smp[i].channels[1] = rand();
+		}
+		// Mostly full packets, which the header cache relies on
+		const int count = (n % 7) ? 4 : 1 + rand() % 3;
+		const bool vsync = (n % 11) == 0, hsync = (n % 5) != 0;
+
+		data_packet_t pk;
+		data_island_stream_t slow, fast, ref;
+		fc_slow = set_audio_sample(&pk, smp, count, fc_slow, status);
+		encode(&slow, &pk, vsync, hsync);
+		spec_encode(&ref, &pk, vsync, hsync);
+		fc_fast = encode_audio_sample_packet(&fast, smp, count, fc_fast, status, vsync, hsync);
+
+		CHECK(fc_fast == fc_slow, "frame count %d, want %d", fc_fast, fc_slow);
+		CHECK(memcmp(&fast, &slow, sizeof(fast)) == 0, "audio fast path differs, packet %d", n);
+		CHECK(memcmp(&slow, &ref, sizeof(slow)) == 0, "audio packet differs from spec, packet %d", n);
+		for (int k = 0; k < count; k++)
+			CHECK(pk.subpacket[k][7] == spec_bch(pk.subpacket[k], 7), "audio subpacket %d ECC", k);
+	}
+}
+
+static void test_n_cts(void)
+{
+	// bit_clk_khz of every timing in dvi_timing.c and of the dmg app's own
+	// (main.c); the pixel clock is a tenth of the bit clock
+	static const struct { const char *name; uint32_t bit_clk_khz; } timings[] = {
+		{ "640x480p_60hz", 252000 },
+		{ "800x600p_60hz", 400000 },
+		{ "800x480p_60hz", 295200 },
+		{ "800x600p_reduced_60hz", 354000 },
+		{ "960x540p_60hz", 372000 },
+		{ "1280x720p_30hz", 372000 },
+		{ "1280x720p_reduced_30hz", 319200 },
+		{ "1600x900p_reduced_30hz", 488000 },
+		{ "800x600p_60hz_280K (dmg)", 280000 },
+	};
+	static const int rates[] = { 32000, 44100, 48000 };
+
+	for (unsigned t = 0; t < sizeof(timings) / sizeof(timings[0]); t++) {
+		const uint32_t f_pixel = timings[t].bit_clk_khz * 100;
+		for (unsigned r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+			const uint32_t fs128 = 128u * rates[r];
+			int n = 0, cts = 0;
+			const bool exact = dvi_audio_compute_n_cts(f_pixel, rates[r], &n, &cts);
+			CHECK(exact, "%s at %d Hz: no exact CTS", timings[t].name, rates[r]);
+			CHECK((uint64_t)f_pixel * n == (uint64_t)fs128 * cts, "%s at %d Hz: N %d CTS %d",
+			      timings[t].name, rates[r], n, cts);
+			CHECK(n * 1500u >= fs128 && n * 300u <= fs128, "%s at %d Hz: N %d out of range",
+			      timings[t].name, rates[r], n);
+		}
+	}
+
+	// The dmg 800x600 timing (28 MHz) by hand: 32000 and 48000 take the
+	// recommended N, 44100 needs a multiple of 126
+	int n, cts;
+	dvi_audio_compute_n_cts(28000000, 44100, &n, &cts);
+	CHECK(n == 6300 && cts == 31250, "28 MHz 44.1 kHz: N %d CTS %d", n, cts);
+	dvi_audio_compute_n_cts(28000000, 48000, &n, &cts);
+	CHECK(n == 6144 && cts == 28000, "28 MHz 48 kHz: N %d CTS %d", n, cts);
+}
+
+static void test_cost(void)
+{
+	enum { N = 200000, RUNS = 5 };
+	data_packet_t pk;
+	data_island_stream_t s;
+	audio_sample_t smp[4] = { { { 1000, -1000 } }, { { 12345, -4321 } }, { { -32768, 32767 } }, { { 7, -7 } } };
+	volatile uint32_t sink = 0;
+	double best_encode = 1e30, best_audio = 1e30;
+
+	set_AVI_info_frame(&pk, UNDERSCAN, RGB, ITU601, PIC_ASPECT_RATIO_4_3, SAME_AS_PAR, FULL, _640x480P60);
+	for (int run = 0; run < RUNS; run++) {
+		double t0 = test_now_ns();
+		for (int i = 0; i < N; i++) {
+			pk.subpacket[1][i & 7] = i;
+			encode(&s, &pk, i & 1, true);
+			sink += s.data[1][3];
+		}
+		double t1 = test_now_ns();
+		int fc = 0;
+		for (int i = 0; i < N; i++) {
+			smp[0].channels[0] = i;
+			fc = encode_audio_sample_packet(&s, smp, 4, fc, NULL, false, true);
+			sink += s.data[2][5];
+		}
+		double t2 = test_now_ns();
+		if (t1 - t0 < best_encode)
+			best_encode = t1 - t0;
+		if (t2 - t1 < best_audio)
+			best_audio = t2 - t1;
+	}
+	(void)sink;
+	printf("host cost per packet (best of %d): encode() %.1f ns, 4-sample audio packet %.1f ns\n",
+	       RUNS, best_encode / N, best_audio / N);
+}
+
+int main(void)
+{
+	test_terc4_tables();
+	test_bch();
+	test_encode_matches_spec();
+	test_golden();
+	test_audio_fast_path();
+	test_n_cts();
+	test_cost();
+	return test_result("data_packet");
+}
@@ -0,0 +1,171 @@
+// The smoothing scalers (apps/dmg/scale2x.h) with the generated scale2x_lut,
+// run the way the 2X SMOOTH and 4X SMOOTH encoders run them, against a direct
+// Scale2x (EPX) on whole 160x144 frames with edge pixels repeated outwards.
+// Every output pixel is compared, so the edge columns and the top and bottom
+// rows are covered along with the interior. Scale4x runs several frames in a
+// row through one cache, as it does on core1, some of them cut short.
+
+#include <stdlib.h>
+#include <string.h>
+
+// As in video_defs.h, which needs libdvi
+#define DMG_PIXELS_X 160
+#define DMG_PIXELS_Y 144
+#include "scale2x.h"
+#include "dmg_tables.h"
+#include "test_util.h"
+
+#define W DMG_PIXELS_X
+#define H DMG_PIXELS_Y
+
+static uint8_t frame[H][W];
+static uint8_t ref2[2 * H][2 * W];
+static uint8_t ref4[4 * H][4 * W];
+static uint8_t packed_fb[H * W / 4];
+
+static void epx(int w, int h, const uint8_t *img, uint8_t *out)
+{
+	for (int y = 0; y < h; y++) {
+		for (int x = 0; x < w; x++) {
+			const int p = img[y * w + x];
+			const int a = img[(y > 0 ? y - 1 : 0) * w + x];
+			const int d = img[(y < h - 1 ? y + 1 : h - 1) * w + x];
+			const int c = img[y * w + (x > 0 ? x - 1 : 0)];
+			const int b = img[y * w + (x < w - 1 ? x + 1 : w - 1)];
+			uint8_t *o = out + 2 * y * 2 * w + 2 * x;
+			o[0] = (c == a && c != d && a != b) ? a : p;
+			o[1] = (a == b && a != c && b != d) ? b : p;
+			o[2 * w] = (d == c && d != b && c != a) ? c : p;
+			o[2 * w + 1] = (b == d && b != a && d != c) ? d : p;
+		}
+	}
+}
+
+// Identity "palette": each lane's split word is the pixel pair itself, tagged
+// by lane, so the symbol buffers read back as output pixels
+static uint32_t split_r[16], split_g[16], split_b[16];
+
+static void make_splits(void)
+{
+	for (uint32_t pair = 0; pair < 16; pair++) {
+		split_r[pair] = pair;
+		split_g[pair] = pair | 0x100;
+		split_b[pair] = pair | 0x200;
+	}
+}
+
+// Compares one output row of symbol pairs with a reference row
+static int check_row(const char *name, int n, int row, const uint32_t *r, const uint32_t *g, const uint32_t *b,
+                     const uint8_t *ref, int width)
+{
+	for (int x = 0; x < width / 2; x++) {
+		const uint32_t want = ((uint32_t)ref[2 * x] << 2) | ref[2 * x + 1];
+		if (r[x] != want || g[x] != (want | 0x100) || b[x] != (want | 0x200)) {
+			CHECK(0, "%s image %d: row %d, pixels %d-%d: got %x/%x/%x, want %x", name, n, row,
+			      2 * x, 2 * x + 1, (unsigned)r[x], (unsigned)g[x], (unsigned)b[x], (unsigned)want);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// Image n: a few random images with 1-4 colours, then shapes that make EPX
+// round corners right up against the frame edges
+static void make_image(int n)
+{
+	int colours[4] = {0, 1, 2, 3};
+	const int ncolours = 1 + n % 4;
+	for (int i = 3; i > 0; i--) {
+		const int j = rand() % (i + 1);
+		const int t = colours[i];
+		colours[i] = colours[j];
+		colours[j] = t;
+	}
+	for (int y = 0; y < H; y++) {
+		for (int x = 0; x < W; x++) {
+			switch (n % 3) {
+			case 0:
+				frame[y][x] = colours[rand() % ncolours];
+				break;
+			case 1:
+				// Diagonals, offset so they meet every edge
+				frame[y][x] = colours[((x + y + n) / 2 + (x - y + W) / 3) % ncolours];
+				break;
+			default:
+				// Checker of 1-3 pixel cells
+				frame[y][x] = colours[(x / (1 + n % 3) + y / (1 + (n / 3) % 3)) % ncolours];
+				break;
+			}
+		}
+	}
+	for (int y = 0; y < H; y++)
+		for (int x = 0; x < W; x += 4)
+			packed_fb[y * (W / 4) + x / 4] = (uint8_t)((frame[y][x] << 6) | (frame[y][x + 1] << 4) |
+			                                            (frame[y][x + 2] << 2) | frame[y][x + 3]);
+	epx(W, H, &frame[0][0], &ref2[0][0]);
+	epx(2 * W, 2 * H, &ref2[0][0], &ref4[0][0]);
+}
+
+#define IMAGES 24
+
+int main(void)
+{
+	static smooth_job_t jobs[8];
+	static scale4x_cache_t cache;
+	uint32_t sym_r[2 * W], sym_g[2 * W], sym_b[2 * W];
+	double scale2x_ns = 0, scale4x_ns = 0;
+
+	srand(1989);
+	make_splits();
+	scale4x_cache_reset(&cache);
+
+	for (int n = 0; n < IMAGES; n++) {
+		make_image(n);
+
+		// 2X SMOOTH: one job per line, two output rows each
+		double t0 = test_now_ns();
+		int bad = 0;
+		for (int line = 0; line < H && !bad; line++) {
+			smooth_job_t *job = &jobs[line % 8];
+			smooth_job_fill(job, packed_fb, line);
+			for (unsigned half = 0; half < 2 && !bad; half++) {
+				scale2x_row(job->rows[1], job->rows[2], job->rows[3], W / 4, scale2x_lut[half], NULL,
+				            sym_r, sym_g, sym_b, split_r, split_g, split_b);
+				bad = check_row("scale2x", n, 2 * line + half, sym_r, sym_g, sym_b, ref2[2 * line + half], 2 * W);
+			}
+		}
+		scale2x_ns += test_now_ns() - t0;
+
+		// 4X SMOOTH: four output rows per job, 2x rows through the cache,
+		// which carries over from the previous image's frame
+		t0 = test_now_ns();
+		bad = 0;
+		for (int line = 0; line < H && !bad; line++) {
+			smooth_job_t *job = &jobs[line % 8];
+			smooth_job_fill(job, packed_fb, line);
+			for (unsigned sub_row = 0; sub_row < 4 && !bad; sub_row++) {
+				const uint8_t *rows[3];
+				scale4x_source_rows(&cache, job, sub_row, scale2x_lut, rows);
+				scale2x_row(rows[0], rows[1], rows[2], W / 2, scale2x_lut[sub_row & 1], NULL,
+				            sym_r, sym_g, sym_b, split_r, split_g, split_b);
+				bad = check_row("scale4x", n, 4 * line + sub_row, sym_r, sym_g, sym_b, ref4[4 * line + sub_row], 4 * W);
+			}
+		}
+		scale4x_ns += test_now_ns() - t0;
+
+		// A frame cut short after two lines leaves this image's first 2x
+		// rows cached when the next image's frame starts
+		for (int line = 0; line < 2; line++) {
+			smooth_job_fill(&jobs[line], packed_fb, line);
+			for (unsigned sub_row = 0; sub_row < 4; sub_row++) {
+				const uint8_t *rows[3];
+				scale4x_source_rows(&cache, &jobs[line], sub_row, scale2x_lut, rows);
+			}
+		}
+	}
+
+	// Host time, including the checks; only a relative figure
+	printf("host: scale2x %.0f ns/line, scale4x %.0f ns/line\n",
+	       scale2x_ns / (IMAGES * 2 * H), scale4x_ns / (IMAGES * 4 * H));
+	return test_result("scalers");
+}
@@ -0,0 +1,233 @@
+// Settings journal (eeprom.c) against a RAM-backed flash that can lose power
+// part way through any erase or program. After every simulated reboot the
+// settings must read back as either the last committed set or the one being
+// committed, never a mix and never lost. Also covers migration from the old
+// single-page store, the flash hook and how erases are spread over sectors.
+// Also built with PICO_COPY_TO_RAM, where main.c registers no hook and every
+// erase and program runs with video live.
+
+#include <setjmp.h>
+#include <stdlib.h>
+
+#include "hardware/flash.h"
+#include "test_util.h"
+
+// Built into this file so a reboot can be simulated by resetting its statics
+#include "eeprom.c"
+
+#define SAVES       20000
+#define EXPECT_HOOK (!PICO_COPY_TO_RAM)
+
+uint8_t host_flash[PICO_FLASH_SIZE_BYTES];
+
+static uint32_t erase_count[JOURNAL_SECTORS];
+static uint32_t program_count;
+static uint32_t erase_cuts;
+
+// Power is cut during operation number cut_at (counting from 1), 0 for never
+static uint32_t op_count;
+static uint32_t cut_at;
+static jmp_buf power_cut;
+
+static int hook_depth;
+static uint32_t hook_calls[2];          // page programs, erases
+static bool hook_erase;
+
+static void flash_offline(uint32_t offset, size_t count)
+{
+	CHECK(hook_depth == EXPECT_HOOK, "flash operation at %#x outside the hook", (unsigned)offset);
+	CHECK(offset >= JOURNAL_OFFSET && offset + count <= PICO_FLASH_SIZE_BYTES,
+	      "flash operation at %#x outside the journal", (unsigned)offset);
+}
+
+void flash_range_erase(uint32_t flash_offs, size_t count)
+{
+	CHECK(flash_offs % FLASH_SECTOR_SIZE == 0 && count == FLASH_SECTOR_SIZE, "erase %#x+%zu", (unsigned)flash_offs, count);
+#if EXPECT_HOOK
+	CHECK(hook_erase, "erase with the hook told it was a program");
+#endif
+	flash_offline(flash_offs, count);
+	erase_count[(flash_offs - JOURNAL_OFFSET) / FLASH_SECTOR_SIZE]++;
+
+	uint8_t *p = host_flash + flash_offs;
+	if (++op_count == cut_at) {
+		// Erased up to some point, then a stretch left in an unknown state
+		const size_t done = rand() % count;
+		const size_t garbage = MIN((size_t)(rand() % 64), count - done);
+		erase_cuts++;
+		memset(p, 0xff, done);
+		for (size_t i = 0; i < garbage; i++)
+			p[done + i] = (uint8_t)rand();
+		longjmp(power_cut, 1);
+	}
+	memset(p, 0xff, count);
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count)
+{
+	CHECK(flash_offs % FLASH_PAGE_SIZE == 0 && count == FLASH_PAGE_SIZE, "program %#x+%zu", (unsigned)flash_offs, count);
+#if EXPECT_HOOK
+	CHECK(!hook_erase, "program with the hook told it was an erase");
+#endif
+	flash_offline(flash_offs, count);
+	program_count++;
+
+	// Programming can only clear bits
+	uint8_t *p = host_flash + flash_offs;
+	size_t n = count;
+	if (++op_count == cut_at) {
+		n = rand() % count;
+		p[n] &= data[n] | (uint8_t)rand();
+	}
+	for (size_t i = 0; i < n; i++)
+		p[i] &= data[i];
+	if (n != count)
+		longjmp(power_cut, 1);
+}
+
+static void __attribute__((unused)) test_hook(bool begin, bool erase)
+{
+	if (begin) {
+		CHECK(hook_depth == 0, "nested hook");
+		hook_depth++;
+		hook_erase = erase;
+		hook_calls[erase]++;
+	} else {
+		CHECK(hook_depth == 1 && hook_erase == erase, "unbalanced hook");
+		hook_depth--;
+	}
+}
+
+static void reboot(void)
+{
+	init = false;
+	_dirty = false;
+	_flash_hook = NULL;
+	hook_depth = 0;
+#if EXPECT_HOOK
+	EEPROM_set_flash_hook(test_hook);
+#endif
+}
+
+static void read_all(uint8_t *data)
+{
+	for (int i = 0; i < EEPROM_SIZE; i++)
+		CHECK(EEPROM_read(i, &data[i]) == EEPROM_SUCCESS, "read %d", i);
+}
+
+static void write_all(const uint8_t *data)
+{
+	for (int i = 0; i < EEPROM_SIZE; i++)
+		CHECK(EEPROM_write(i, data[i]) == EEPROM_SUCCESS, "write %d", i);
+}
+
+static void test_blank_and_migration(void)
+{
+	uint8_t data[EEPROM_SIZE];
+
+	memset(host_flash, 0xff, sizeof(host_flash));
+	reboot();
+	read_all(data);
+	for (int i = 0; i < EEPROM_SIZE; i++)
+		CHECK(data[i] == 0, "blank flash reads %#x at %d", data[i], i);
+
+	// The old store: settings at the start of the last page, flag at the end
+	uint8_t *legacy = host_flash + LEGACY_OFFSET_PAGE;
+	for (int i = 0; i < EEPROM_SIZE; i++)
+		legacy[i] = (uint8_t)(i * 7 + 3);
+	legacy[FLASH_PAGE_SIZE - 1] = FLAG_VALID_EEPROM;
+	reboot();
+	read_all(data);
+	for (int i = 0; i < EEPROM_SIZE; i++)
+		CHECK(data[i] == (uint8_t)(i * 7 + 3), "legacy setting %d reads %#x", i, data[i]);
+
+	// Written to the journal by the next commit, even with nothing changed
+	CHECK(EEPROM_commit() == EEPROM_SUCCESS, "migration commit");
+	memset(legacy, 0xff, FLASH_PAGE_SIZE);
+	reboot();
+	read_all(data);
+	for (int i = 0; i < EEPROM_SIZE; i++)
+		CHECK(data[i] == (uint8_t)(i * 7 + 3), "migrated setting %d reads %#x", i, data[i]);
+}
+
+static void test_power_loss(void)
+{
+	uint8_t committed[EEPROM_SIZE], next[EEPROM_SIZE], now[EEPROM_SIZE];
+	uint32_t cuts = 0, kept_old = 0, commits = 0;
+
+	reboot();
+	read_all(committed);
+	memset(erase_count, 0, sizeof(erase_count));
+	program_count = 0;
+	erase_cuts = 0;
+
+	for (int save = 0; save < SAVES; save++) {
+		memcpy(next, committed, sizeof(next));
+		for (int n = 1 + rand() % 4; n > 0; n--)
+			next[rand() % EEPROM_SIZE] = (uint8_t)rand();
+		const bool changed = memcmp(next, committed, sizeof(next)) != 0;
+
+		// Cut the power on about one save in eight, in its program or in an
+		// erase when there is one
+		op_count = 0;
+		cut_at = rand() % 8 == 0 ? 1 + rand() % 2 : 0;
+		if (setjmp(power_cut) == 0) {
+			write_all(next);
+			CHECK(EEPROM_commit() == EEPROM_SUCCESS, "commit %d", save);
+			cut_at = 0;
+			memcpy(committed, next, sizeof(committed));
+			commits += changed;
+			if (rand() % 4 != 0)
+				continue;
+			reboot();
+			read_all(now);
+			CHECK(memcmp(now, committed, sizeof(now)) == 0, "save %d lost after a clean reboot", save);
+			continue;
+		}
+
+		cuts++;
+		cut_at = 0;
+		reboot();
+		read_all(now);
+		const bool is_old = memcmp(now, committed, sizeof(now)) == 0;
+		const bool is_new = memcmp(now, next, sizeof(now)) == 0;
+		CHECK(is_old || is_new, "save %d torn by a power cut", save);
+		if (is_new) {
+			memcpy(committed, next, sizeof(committed));
+			commits++;
+		} else {
+			kept_old++;
+		}
+	}
+
+	reboot();
+	read_all(now);
+	CHECK(memcmp(now, committed, sizeof(now)) == 0, "final settings");
+
+	// One erase per RECORDS_PER_SECTOR records, rotating over the sectors,
+	// plus a retry for each erase that lost power
+	uint32_t min_erases = UINT32_MAX, max_erases = 0, total_erases = 0;
+	for (int i = 0; i < JOURNAL_SECTORS; i++) {
+		min_erases = MIN(min_erases, erase_count[i]);
+		max_erases = MAX(max_erases, erase_count[i]);
+		total_erases += erase_count[i];
+	}
+	CHECK(max_erases - min_erases <= 2, "erases per sector range %u - %u", (unsigned)min_erases, (unsigned)max_erases);
+	CHECK(total_erases <= program_count / RECORDS_PER_SECTOR + erase_cuts + JOURNAL_SECTORS,
+	      "%u erases for %u page programs", (unsigned)total_erases, (unsigned)program_count);
+	CHECK(hook_depth == 0, "hook left open");
+
+	printf("%d saves, %u committed, %u power cuts (%u kept the previous settings)\n",
+	       SAVES, (unsigned)commits, (unsigned)cuts, (unsigned)kept_old);
+	printf("%u page programs, %u erases (%u - %u per sector, %u cut short)\n",
+	       (unsigned)program_count, (unsigned)total_erases, (unsigned)min_erases, (unsigned)max_erases,
+	       (unsigned)erase_cuts);
+}
+
+int main(void)
+{
+	srand(38);
+	test_blank_and_migration();
+	test_power_loss();
+	return test_result("settings_store");
+}
@@ -0,0 +1,38 @@
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+// Minimal helpers shared by the host tests: a non-fatal CHECK that counts
+// failures, and a monotonic clock for the timing figures.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+static int test_failures;
+
+#define CHECK(cond, ...) do { \
+	if (!(cond)) { \
+		test_failures++; \
+		printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+		printf(__VA_ARGS__); \
+		printf("\n"); \
+	} \
+} while (0)
+
+static inline double test_now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static inline int test_result(const char *name)
+{
+	if (test_failures)
+		printf("%s: %d check(s) failed\n", name, test_failures);
+	else
+		printf("%s: ok\n", name);
+	return test_failures ? 1 : 0;
+}
+
+#endif